@@ -0,0 +1,1571 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include "rk.h"
+#include "pendulo.h"
+#include "ensemble.h"
+#include "timing.h"
+#include "scheduler.h"
+#include "sink.h"
+#include "rk_spec.h"
+#include "bench_harness.h"
+#include "taylor.h"
+#include "chain.h"
+#include "rk_par.h"
+#include "period_cache.h"
+#include "server.h"
+#include "driven.h"
+#include "shard.h"
+#include "parareal.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+Compara o caminho escalar (detect_period_constant, um theta0 por vez) com o
+kernel em lote (detect_period_constant_batch) numa varredura de muitos ângulos.
+**/
+void bench_ensemble_constant() {
+    int n = 4096;
+    double h = 0.001;
+    int num_periods = 1;
+
+    double *theta0 = malloc(n * sizeof(double));
+    double *T_scalar = malloc(n * sizeof(double));
+    double *T_batch = malloc(n * sizeof(double));
+    int *steps_scalar = malloc(n * sizeof(int));
+    int *steps_batch = malloc(n * sizeof(int));
+
+    for (int i = 0; i < n; ++i) {
+        theta0[i] = 0.05 + (3.0 - 0.05) * i / (double)(n - 1);
+    }
+
+    double t0 = timing_now();
+    for (int i = 0; i < n; ++i) {
+        T_scalar[i] = detect_period_constant(theta0[i], h, num_periods, &steps_scalar[i], NULL, NULL);
+    }
+    double t1 = timing_now();
+    detect_period_constant_batch(theta0, n, h, num_periods, T_batch, steps_batch, NULL);
+    double t2 = timing_now();
+
+    double max_dT = 0.0;
+    int step_mismatch = 0;
+    for (int i = 0; i < n; ++i) {
+        double d = fabs(T_scalar[i] - T_batch[i]);
+        if (d > max_dT) max_dT = d;
+        if (steps_scalar[i] != steps_batch[i]) step_mismatch++;
+    }
+
+    printf("--- Ensemble RK4 (n = %d, h = %.4f, %d periodo) ---\n", n, h, num_periods);
+    printf("method,time_s\n");
+    printf("scalar,%.6f\n", t1 - t0);
+    printf("batch,%.6f\n", t2 - t1);
+    printf("speedup = %.2fx, max |dT| = %.3e, passos divergentes = %d\n",
+           (t1 - t0) / (t2 - t1), max_dT, step_mismatch);
+
+    free(theta0); free(T_scalar); free(T_batch);
+    free(steps_scalar); free(steps_batch);
+}
+
+/**
+Mesma comparação para o integrador adaptativo: as lanes aposentadas são recarregadas
+com o próximo ângulo, então ângulos baratos e caros dividem o mesmo lote.
+**/
+void bench_ensemble_adaptive() {
+    int n = 4096;
+    double tol = 1e-7;
+    double h0 = 0.01;
+    int num_periods = 1;
+
+    double *theta0 = malloc(n * sizeof(double));
+    double *T_scalar = malloc(n * sizeof(double));
+    double *T_batch = malloc(n * sizeof(double));
+    int *steps_scalar = malloc(n * sizeof(int));
+    int *steps_batch = malloc(n * sizeof(int));
+
+    // Ângulos embaralhados entre 0.1 e 3.0 rad para misturar custos baixos e altos
+    for (int i = 0; i < n; ++i) {
+        int k = (int)((i * 2654435761u) % (unsigned)n);
+        theta0[i] = 0.1 + (3.0 - 0.1) * k / (double)(n - 1);
+    }
+
+    double t0 = timing_now();
+    for (int i = 0; i < n; ++i) {
+        detect_period_adaptive(theta0[i], tol, h0, num_periods, &T_scalar[i], &steps_scalar[i], NULL, NULL);
+    }
+    double t1 = timing_now();
+    double utilization;
+    detect_period_adaptive_batch(theta0, n, tol, h0, num_periods, T_batch, steps_batch, &utilization, NULL);
+    double t2 = timing_now();
+
+    double max_dT = 0.0;
+    int step_mismatch = 0;
+    for (int i = 0; i < n; ++i) {
+        double d = fabs(T_scalar[i] - T_batch[i]);
+        if (d > max_dT) max_dT = d;
+        if (steps_scalar[i] != steps_batch[i]) step_mismatch++;
+    }
+
+    printf("--- Ensemble adaptativo (n = %d, tol = %.1e, %d lanes) ---\n", n, tol, ENS_LANES);
+    printf("method,time_s\n");
+    printf("scalar,%.6f\n", t1 - t0);
+    printf("batch,%.6f\n", t2 - t1);
+    printf("speedup = %.2fx, ocupacao das lanes = %.1f%%, max |dT| = %.3e, passos divergentes = %d\n",
+           (t1 - t0) / (t2 - t1), 100.0 * utilization, max_dT, step_mismatch);
+
+    free(theta0); free(T_scalar); free(T_batch);
+    free(steps_scalar); free(steps_batch);
+}
+
+/**
+Compara os métodos adaptativos (passo dobrado x pares embutidos com FSAL) nas
+tolerâncias usadas em main.c: avaliações de f, tempo e erro do período.
+**/
+void bench_adaptive_methods() {
+    double theta0_vals[] = {0.1, 0.5, 1.0, 2.0, 3.0};
+    int n_thetas = sizeof(theta0_vals) / sizeof(theta0_vals[0]);
+    double tol_vals[] = {1e-6, 1e-7, 1e-8};
+    int n_tol = sizeof(tol_vals) / sizeof(tol_vals[0]);
+    double h0 = 0.01;
+    int reps = 200;
+
+    printf("--- Metodos adaptativos (1 periodo, theta0 = 0.1 ... 3.0) ---\n");
+    printf("method,tol,steps,rejected,rhs_evals,time_s,max_period_error\n");
+    for (int m = 0; m < RK_METHOD_COUNT; ++m) {
+        rk_set_adaptive_method((rk_method)m);
+        for (int k = 0; k < n_tol; ++k) {
+            double tol = tol_vals[k];
+            rk_stats total, stats;
+            double max_err = 0.0;
+            rk_stats_reset(&total);
+            for (int i = 0; i < n_thetas; ++i) {
+                int steps;
+                double T;
+                detect_period_adaptive(theta0_vals[i], tol, h0, 1, &T, &steps, NULL, &stats);
+                double err = fabs(T - exact_period(theta0_vals[i]));
+                if (err > max_err) max_err = err;
+                rk_stats_merge(&total, &stats);
+            }
+
+            double t0 = timing_now();
+            for (int r = 0; r < reps; ++r) {
+                for (int i = 0; i < n_thetas; ++i) {
+                    double T;
+                    int steps;
+                    detect_period_adaptive(theta0_vals[i], tol, h0, 1, &T, &steps, NULL, NULL);
+                }
+            }
+            double elapsed = (timing_now() - t0) / reps;
+
+            printf("%s,%.1e,%ld,%ld,%ld,%.6f,%.3e\n", rk_method_name((rk_method)m), tol,
+                   total.accepted_steps, total.rejected_steps, total.rhs_evals, elapsed, max_err);
+        }
+    }
+    rk_set_adaptive_method(RK_METHOD_RK4_DOUBLING);
+}
+
+typedef struct {
+    const double *theta0;
+    int n;
+    double T[2][1024];
+} sweep_jobs;
+
+// Tarefa = bloco de ENS_LANES ângulos; índices pares adaptativo, ímpares passo constante.
+static void sweep_task(void *arg, int index) {
+    sweep_jobs *jobs = (sweep_jobs *)arg;
+    int row = index % 2;
+    int first = (index / 2) * ENS_LANES;
+    int count = (jobs->n - first < ENS_LANES) ? jobs->n - first : ENS_LANES;
+    if (row == 0) {
+        detect_period_adaptive_batch(jobs->theta0 + first, count, 1e-8, 0.01, 1,
+                                     jobs->T[0] + first, NULL, NULL, NULL);
+    } else {
+        detect_period_constant_batch(jobs->theta0 + first, count, 1e-3, 1,
+                                     jobs->T[1] + first, NULL, NULL);
+    }
+}
+
+/**
+Escalabilidade do escalonador com roubo de trabalho: a mesma varredura
+(1024 ângulos, adaptativo + passo constante) com 1 a N threads.
+**/
+void bench_scheduler_scaling() {
+    static double theta0[1024];
+    static sweep_jobs jobs;
+    int n = 1024;
+    for (int i = 0; i < n; ++i) {
+        theta0[i] = 0.1 + (3.0 - 0.1) * i / (double)(n - 1);
+    }
+    jobs.theta0 = theta0;
+    jobs.n = n;
+    int n_tasks = 2 * ((n + ENS_LANES - 1) / ENS_LANES);
+
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpus < 1) n_cpus = 1;
+
+    printf("--- Escalonador: varredura de %d angulos, %d tarefas, %ld nucleos ---\n", n, n_tasks, n_cpus);
+    printf("threads,time_s,speedup\n");
+    double t_serial = 0.0;
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > n_cpus) threads = (int)n_cpus;
+        sched_pool *pool = sched_create(threads);
+        double t0 = timing_now();
+        sched_parallel_for(pool, n_tasks, sweep_task, &jobs);
+        double elapsed = timing_now() - t0;
+        sched_destroy(pool);
+        if (threads == 1) t_serial = elapsed;
+        printf("%d,%.6f,%.2f\n", threads, elapsed, t_serial / elapsed);
+        if (threads == n_cpus) break;
+    }
+}
+
+/**
+Oráculo do período exato: AGM direto x tabela pré-calculada.
+**/
+void bench_exact_period() {
+    int n = 1000000;
+    int table_points = 4096;
+    double sink = 0.0, max_rel = 0.0;
+
+    double t0 = timing_now();
+    exact_period_table_init(table_points);
+    double t_init = timing_now() - t0;
+
+    t0 = timing_now();
+    for (int i = 0; i < n; ++i) sink += exact_period(3.0 * i / (double)n);
+    double t_agm = timing_now() - t0;
+
+    t0 = timing_now();
+    for (int i = 0; i < n; ++i) sink += exact_period_lookup(3.0 * i / (double)n);
+    double t_table = timing_now() - t0;
+
+    for (int i = 0; i < n; ++i) {
+        double x = 3.0 * i / (double)n;
+        double rel = fabs(exact_period_lookup(x) - exact_period(x)) / exact_period(x);
+        if (rel > max_rel) max_rel = rel;
+    }
+
+    printf("--- Periodo exato (%d consultas em [0, 3]) ---\n", n);
+    printf("method,ns_per_query\n");
+    printf("agm,%.2f\n", 1e9 * t_agm / n);
+    printf("table,%.2f\n", 1e9 * t_table / n);
+    printf("tabela de %d pontos em %.3f ms, erro relativo max = %.3e (checksum %.3f)\n",
+           table_points, 1e3 * t_init, max_rel, sink);
+}
+
+/**
+Custo de gravar a trajetória: 10 períodos com h = 1e-4 em cada backend de sink.
+**/
+void bench_sinks() {
+    double theta0 = 1.0, h = 1e-4;
+    int num_periods = 10, steps;
+    const char *bin_path = "/tmp/pendulo_bench_sink.bin";
+    static const char *const names[] = { "t", "theta" };
+
+    printf("--- Sinks de trajetoria (theta0 = %.1f, h = %.0e, %d periodos) ---\n", theta0, h, num_periods);
+    printf("sink,time_s,ns_per_sample\n");
+    for (int kind = 0; kind < 4; ++kind) {
+        FILE *fp = NULL;
+        traj_sink *sink = NULL;
+        const char *name = "none";
+        if (kind == 1) { fp = tmpfile(); sink = sink_csv_create(fp, 2, "%.8f", ','); name = "csv"; }
+        if (kind == 2) { sink = sink_arena_create(2); name = "arena"; }
+        if (kind == 3) { sink = sink_binary_create(bin_path, 2, names); name = "binary"; }
+
+        double t0 = timing_now();
+        detect_period_constant(theta0, h, num_periods, &steps, sink, NULL);
+        sink_close(sink);
+        if (fp) fclose(fp);
+        double elapsed = timing_now() - t0;
+        printf("%s,%.6f,%.1f\n", name, elapsed, 1e9 * elapsed / (steps + 1));
+    }
+    remove(bin_path);
+}
+
+/**
+Escrita CSV síncrona x assíncrona (thread de escrita com anel de blocos) numa
+trajetória longa, com o tempo em que o integrador ficou bloqueado esperando o escritor.
+**/
+void bench_async_sink() {
+    double theta0 = 1.0, h = 1e-5;
+    int num_periods = 10, steps;
+    size_t block_rows_vals[] = {1024, 16384};
+    int n_blocks_vals[] = {2, 8};
+
+    printf("--- Escrita assincrona (CSV, theta0 = %.1f, h = %.0e, %d periodos) ---\n", theta0, h, num_periods);
+    printf("mode,block_rows,n_blocks,time_s,integration_s,stalls,stall_s\n");
+
+    FILE *fp = tmpfile();
+    traj_sink *csv = sink_csv_create(fp, 2, "%.8f", ',');
+    double t0 = timing_now();
+    detect_period_constant(theta0, h, num_periods, &steps, csv, NULL);
+    sink_close(csv);
+    fflush(fp);
+    double t_sync = timing_now() - t0;
+    printf("sync,0,0,%.6f,%.6f,0,0\n", t_sync, t_sync);
+    fclose(fp);
+
+    for (int b = 0; b < 2; ++b) {
+        for (int k = 0; k < 2; ++k) {
+            sink_async_stats stats;
+            fp = tmpfile();
+            t0 = timing_now();
+            traj_sink *async = sink_async_create(sink_csv_create(fp, 2, "%.8f", ','),
+                                                 block_rows_vals[b], n_blocks_vals[k], &stats);
+            detect_period_constant(theta0, h, num_periods, &steps, async, NULL);
+            double t_integration = timing_now() - t0;
+            sink_close(async);
+            fflush(fp);
+            printf("async,%zu,%d,%.6f,%.6f,%zu,%.6f\n", block_rows_vals[b], n_blocks_vals[k],
+                   timing_now() - t0, t_integration, stats.stalls, stats.stall_seconds);
+            fclose(fp);
+        }
+    }
+}
+
+RK_DEFINE_RK4_STEPPER(bench_rk4_pendulo, N_EQ, f_pendulo_inline)
+RK_DEFINE_DOUBLING_STEPPER(bench_doubling_pendulo, bench_rk4_pendulo, N_EQ)
+
+/**
+Micro-benchmark: ns por passo do caminho genérico (ponteiro de função + VLAs)
+contra o stepper especializado por macro para o pêndulo.
+**/
+void bench_specialized_steppers() {
+    int n_steps = 5000000;
+    double h = 1e-3, tol = 1e-8;
+    double y[2], y_next[2];
+
+    printf("--- Steppers especializados (%d passos) ---\n", n_steps);
+    printf("stepper,ns_per_step,checksum\n");
+
+    y[0] = 1.0; y[1] = 0.0;
+    double t0 = timing_now();
+    for (int i = 0; i < n_steps; ++i) {
+        rk4_single_step_system(i * h, y, h, N_EQ, f_pendulo, y_next);
+        y[0] = y_next[0]; y[1] = y_next[1];
+    }
+    double t_generic = timing_now() - t0;
+    double check_generic = y[0];
+    printf("rk4_generic,%.2f,%.15f\n", 1e9 * t_generic / n_steps, check_generic);
+
+    y[0] = 1.0; y[1] = 0.0;
+    t0 = timing_now();
+    for (int i = 0; i < n_steps; ++i) {
+        bench_rk4_pendulo(i * h, y, h, y_next);
+        y[0] = y_next[0]; y[1] = y_next[1];
+    }
+    double t_spec = timing_now() - t0;
+    printf("rk4_specialized,%.2f,%.15f\n", 1e9 * t_spec / n_steps, y[0]);
+
+    double t = 0.0, hh = 1e-3;
+    int attempts = n_steps / 4;
+    y[0] = 1.0; y[1] = 0.0;
+    t0 = timing_now();
+    for (int i = 0; i < attempts; ++i) {
+        rk_adaptive_one_step(&t, y, &hh, N_EQ, f_pendulo, tol, tol * 0.1, 0.5);
+    }
+    t_generic = timing_now() - t0;
+    printf("doubling_generic,%.2f,%.15f\n", 1e9 * t_generic / attempts, y[0]);
+
+    t = 0.0; hh = 1e-3;
+    y[0] = 1.0; y[1] = 0.0;
+    rk_control_state ctl;
+    rk_control_state_reset(&ctl);
+    t0 = timing_now();
+    for (int i = 0; i < attempts; ++i) {
+        bench_doubling_pendulo(&t, y, &hh, tol, tol * 0.1, 0.5, &ctl);
+    }
+    t_spec = timing_now() - t0;
+    printf("doubling_specialized,%.2f,%.15f\n", 1e9 * t_spec / attempts, y[0]);
+}
+
+/**
+Estatísticas do integrador adaptativo num caso difícil (theta0 = 3.0) e o custo da
+coleta: a mesma integração com stats = NULL e com stats. Para o custo com a coleta
+removida na compilação, compare com "make bench STATS=0".
+**/
+void bench_solver_stats() {
+    double theta0 = 3.0, tol = 1e-8, h0 = 0.01;
+    int num_periods = 10, reps = 200, steps;
+    double T;
+    rk_stats stats;
+
+    printf("--- Estatisticas do integrador (theta0 = %.1f, tol = %.0e, %d periodos, RK_STATS_ENABLED = %d) ---\n",
+           theta0, tol, num_periods, RK_STATS_ENABLED);
+    detect_period_adaptive(theta0, tol, h0, num_periods, &T, &steps, NULL, &stats);
+    rk_stats_print(stdout, "adaptive", &stats);
+
+    printf("stats,time_s\n");
+    for (int with_stats = 0; with_stats < 2; ++with_stats) {
+        double t0 = timing_now();
+        for (int r = 0; r < reps; ++r) {
+            detect_period_adaptive(theta0, tol, h0, num_periods, &T, &steps, NULL, with_stats ? &stats : NULL);
+        }
+        printf("%s,%.6f\n", with_stats ? "on" : "null", (timing_now() - t0) / reps);
+    }
+}
+
+// Sink que só acompanha o maior desvio de energia |E - E0| das amostras (t, theta, omega).
+typedef struct {
+    traj_sink base;
+    double e0;
+    double max_dE;
+    int started;
+} energy_sink;
+
+static void energy_sink_write(traj_sink *sink, double t, const double y[]) {
+    energy_sink *es = (energy_sink *)sink;
+    double e = pendulo_energy(y);
+    if (!es->started) {
+        es->e0 = e;
+        es->started = 1;
+    }
+    double d = fabs(e - es->e0);
+    if (d > es->max_dE) es->max_dE = d;
+}
+
+static int energy_sink_close(traj_sink *sink) {
+    (void)sink;
+    return 1;
+}
+
+/**
+Integradores de passo fixo em horizontes longos (theta0 = 1.0): RK4 x simpléticos.
+Para cada método e passo h, o erro relativo máximo de energia ao longo da trajetória,
+o erro do período médio em relação ao exato, as avaliações de f e o tempo.
+O RK4 acumula erro de energia proporcional ao número de períodos; nos simpléticos
+ele fica limitado, então passos grandes continuam utilizáveis em 10^6 períodos.
+**/
+void bench_symplectic() {
+    double theta0 = 1.0;
+    double T_exact = exact_period(theta0);
+    double E0;
+    double h_vals[] = {0.2, 0.1, 0.05};
+    int n_h = sizeof(h_vals) / sizeof(h_vals[0]);
+    int period_vals[] = {10, 1000, 1000000};
+    int n_periods = sizeof(period_vals) / sizeof(period_vals[0]);
+    double y0[2] = { theta0, 0.0 };
+    E0 = pendulo_energy(y0);
+
+    printf("--- Passo fixo: RK4 x simpleticos (theta0 = %.1f, T = %.4f) ---\n", theta0, T_exact);
+    printf("method,h,periods,steps,rhs_evals,max_rel_energy_error,period_error,time_s\n");
+    for (int k = 0; k < n_periods; ++k) {
+        for (int j = 0; j < n_h; ++j) {
+            // 10^6 períodos só com o passo intermediário, para manter o tempo do bench razoável
+            if (period_vals[k] >= 1000000 && j != 1) continue;
+            for (int m = 0; m < PENDULO_FIXED_COUNT; ++m) {
+                energy_sink es = { { 3, energy_sink_write, energy_sink_close }, 0.0, 0.0, 0 };
+                rk_stats stats;
+                int steps;
+                double t0 = timing_now();
+                double T = detect_period_fixed((pendulo_fixed_method)m, theta0, h_vals[j], period_vals[k],
+                                               &steps, &es.base, &stats);
+                double elapsed = timing_now() - t0;
+                printf("%s,%.2f,%d,%d,%ld,%.3e,%.3e,%.6f\n", pendulo_fixed_method_name((pendulo_fixed_method)m),
+                       h_vals[j], period_vals[k], steps, stats.rhs_evals, es.max_dE / E0,
+                       fabs(T - T_exact), elapsed);
+            }
+        }
+    }
+}
+
+typedef struct {
+    int method; // -1 = Taylor, senão rk_method
+    double theta0;
+    double tol;
+    int order;
+    int periods;
+} taylor_case;
+
+static void taylor_case_call(void *arg) {
+    taylor_case *c = (taylor_case *)arg;
+    double T;
+    int steps;
+    if (c->method < 0) {
+        detect_period_taylor(c->theta0, c->tol, c->order, c->periods, &T, &steps, NULL, NULL);
+    } else {
+        detect_period_adaptive(c->theta0, c->tol, 0.01, c->periods, &T, &steps, NULL, NULL);
+    }
+}
+
+/**
+Integrador de Taylor x adaptativos RK em tolerâncias apertadas (10 períodos):
+passos por período, erro do período e tempo (mediana do harness), com o Taylor em
+ordem variável. Depois, o efeito de uma ordem fixa com tolerância fixa.
+**/
+void bench_taylor() {
+    double theta0_vals[] = {1.0, 3.0};
+    double tol_vals[] = {1e-8, 1e-11, 1e-14};
+    int periods = 10;
+    int methods[] = {-1, RK_METHOD_RK4_DOUBLING, RK_METHOD_DP54};
+
+    printf("--- Taylor x RK adaptativo (%d periodos) ---\n", periods);
+    printf("method,order,theta0,tol,steps_per_period,rhs_evals,period_error,time_s\n");
+    for (int i = 0; i < 2; ++i) {
+        double T_exact = exact_period(theta0_vals[i]);
+        for (int k = 0; k < 3; ++k) {
+            for (int m = 0; m < 3; ++m) {
+                taylor_case c = { methods[m], theta0_vals[i], tol_vals[k], 0, periods };
+                rk_stats stats;
+                bench_timing timing;
+                double T;
+                int steps;
+                if (c.method < 0) {
+                    detect_period_taylor(c.theta0, c.tol, 0, periods, &T, &steps, NULL, &stats);
+                } else {
+                    rk_set_adaptive_method((rk_method)c.method);
+                    detect_period_adaptive(c.theta0, c.tol, 0.01, periods, &T, &steps, NULL, &stats);
+                }
+                bench_measure(NULL, taylor_case_call, &c, &timing);
+                printf("%s,%s,%.1f,%.0e,%.1f,%ld,%.3e,%.6f\n",
+                       c.method < 0 ? "taylor" : rk_method_name((rk_method)c.method),
+                       c.method < 0 ? "auto" : "-", c.theta0, c.tol,
+                       steps / (double)periods, stats.rhs_evals, fabs(T - T_exact), timing.median_s);
+            }
+        }
+    }
+    rk_set_adaptive_method(RK_METHOD_RK4_DOUBLING);
+
+    printf("order,steps_per_period,period_error,time_s (theta0 = 3.0, tol = 1e-14)\n");
+    for (int order = 10; order <= 30; order += 5) {
+        taylor_case c = { -1, 3.0, 1e-14, order, periods };
+        bench_timing timing;
+        double T;
+        int steps;
+        detect_period_taylor(c.theta0, c.tol, order, periods, &T, &steps, NULL, NULL);
+        bench_measure(NULL, taylor_case_call, &c, &timing);
+        printf("%d,%.1f,%.3e,%.6f\n", order, steps / (double)periods, fabs(T - exact_period(3.0)), timing.median_s);
+    }
+}
+
+// Muitos pêndulos independentes como um único sistema: y = [theta_0..theta_{n-1}, omega_0..omega_{n-1}].
+static int many_n;
+
+static void f_many_pendulums(double t, double y[], double dydt[]) {
+    f_pendulo_batch(many_n, y, y + many_n, dydt, dydt + many_n);
+}
+
+static double large_event(double t, const double y[], void *ctx) {
+    return y[0] - *(const double *)ctx;
+}
+
+/**
+Sistema grande (2^20 equações, 8 MB por vetor) com o integrador genérico. Com os
+vetores temporários na pilha (VLAs) esse caso estourava a pilha; agora eles ficam no
+workspace. Compara o workspace implícito da thread com um workspace explícito e localiza
+um evento na saída densa do intervalo inteiro (o estado interpolado também fica no workspace).
+**/
+void bench_large_system() {
+    int n_pend = 1 << 19;
+    int n_eq = 2 * n_pend;
+    double t_final = 0.2, tol = 1e-8;
+    double *y0 = malloc(n_eq * sizeof(double));
+    double *y_implicit = malloc(n_eq * sizeof(double));
+    double *y_explicit = malloc(n_eq * sizeof(double));
+    rk_stats stats;
+
+    many_n = n_pend;
+    for (int i = 0; i < n_pend; ++i) {
+        y0[i] = 0.1 + 2.9 * i / (double)(n_pend - 1);
+        y0[n_pend + i] = 0.0;
+    }
+
+    printf("--- Sistema grande (n_eq = %d, t_final = %.1f, tol = %.0e) ---\n", n_eq, t_final, tol);
+    printf("workspace,steps,rhs_evals,time_s\n");
+
+    double t0 = timing_now();
+    int steps = RungeKutta_system_adaptive_h(0.0, t_final, y0, n_eq, f_many_pendulums, tol, 0.01,
+                                             NULL, y_implicit, &stats);
+    printf("thread,%d,%ld,%.3f\n", steps, stats.rhs_evals, timing_now() - t0);
+    rk_thread_workspace_release();
+
+    rk_workspace *ws = rk_workspace_create(n_eq);
+    t0 = timing_now();
+    steps = RungeKutta_system_adaptive_h_ws(ws, 0.0, t_final, y0, n_eq, f_many_pendulums, tol, 0.01,
+                                            NULL, y_explicit, &stats);
+    printf("explicit,%d,%ld,%.3f\n", steps, stats.rhs_evals, timing_now() - t0);
+    rk_workspace_destroy(ws);
+
+    int mismatch = memcmp(y_implicit, y_explicit, n_eq * sizeof(double)) != 0;
+    printf("estados finais %s\n", mismatch ? "DIFERENTES" : "identicos");
+
+    // Evento: o 1º pêndulo passa pelo ponto médio entre theta(0) e theta(t_final)
+    double *f0 = malloc(n_eq * sizeof(double));
+    double *f1 = malloc(n_eq * sizeof(double));
+    double theta_mid = 0.5 * (y0[0] + y_explicit[0]), t_event;
+    f_many_pendulums(0.0, y0, f0);
+    f_many_pendulums(t_final, y_explicit, f1);
+    rk_dense_step step = { 0.0, t_final, n_eq, y0, f0, y_explicit, f1 };
+    t0 = timing_now();
+    int found = rk_locate_event(&step, large_event, &theta_mid, 1e-12, &t_event);
+    printf("evento no sistema grande: %s, t = %.6f (%.3f s)\n", found ? "encontrado" : "NAO encontrado", t_event,
+           timing_now() - t0);
+    free(f0); free(f1);
+    free(y0); free(y_implicit); free(y_explicit);
+}
+
+typedef struct {
+    void (*f)(double, double[], double[]);
+    rk_workspace *ws;
+    int n_eq;
+    double *y;
+    double *out;
+} chain_case;
+
+static void chain_rhs_call(void *arg) {
+    chain_case *c = (chain_case *)arg;
+    c->f(0.0, c->y, c->out);
+}
+
+static void chain_rk4_call(void *arg) {
+    chain_case *c = (chain_case *)arg;
+    rk4_single_step_system_ws(c->ws, 0.0, c->y, 1e-3, c->n_eq, c->f, c->out);
+}
+
+/**
+Cadeia de pêndulos acoplados: vazão em atualizações de sítio por segundo da derivada
+(vetorizada x referência escalar com a sin da libm) e de um passo RK4 completo, com N
+crescendo além da L2 e da L3. Depois, conservação de energia numa integração adaptativa.
+**/
+void bench_chain() {
+    printf("--- Cadeia acoplada: vazao (sitios/s) ---\n");
+    printf("n_sites,rhs_bytes,rhs_reference,rhs_simd,speedup,rk4_step\n");
+    for (int n = 1 << 10; n <= 1 << 22; n <<= 2) {
+        chain_params p = { n, 1.0, G / L, 1 };
+        chain_set_params(&p);
+        double *y = malloc(2 * (size_t)n * sizeof(double));
+        double *out = malloc(2 * (size_t)n * sizeof(double));
+        for (int i = 0; i < n; ++i) {
+            y[i] = 0.5 * sin(2.0 * M_PI * i / 64.0);
+            y[n + i] = 0.0;
+        }
+        chain_case c = { f_chain_reference, rk_workspace_create(2 * n), 2 * n, y, out };
+        bench_timing t_ref, t_simd, t_rk4;
+        bench_measure(NULL, chain_rhs_call, &c, &t_ref);
+        c.f = f_chain;
+        bench_measure(NULL, chain_rhs_call, &c, &t_simd);
+        bench_measure(NULL, chain_rk4_call, &c, &t_rk4);
+        printf("%d,%zu,%.3e,%.3e,%.2f,%.3e\n", n, 4 * (size_t)n * sizeof(double),
+               n / t_ref.median_s, n / t_simd.median_s, t_ref.median_s / t_simd.median_s, n / t_rk4.median_s);
+        rk_workspace_destroy(c.ws);
+        free(y); free(out);
+    }
+
+    int n = 4096;
+    chain_params p = { n, 4.0, G / L, 0 };
+    chain_set_params(&p);
+    double *y0 = malloc(2 * n * sizeof(double));
+    double *y1 = malloc(2 * n * sizeof(double));
+    for (int i = 0; i < n; ++i) {
+        // Kink do sine-Gordon: theta vai de 0 a 2 pi ao longo da cadeia
+        y0[i] = 4.0 * atan(exp((i - n / 2) / sqrt(p.coupling / p.omega0_sq)));
+        y0[n + i] = 0.01 * sin(0.05 * i);
+    }
+    rk_workspace *ws = rk_workspace_create(2 * n);
+    rk_stats stats;
+    double t0 = timing_now();
+    RungeKutta_system_adaptive_h_ws(ws, 0.0, 10.0, y0, 2 * n, f_chain, 1e-9, 0.01, NULL, y1, &stats);
+    double elapsed = timing_now() - t0;
+    printf("cadeia N = %d, t = 10: %ld passos, %.3f s, erro relativo de energia = %.3e\n",
+           n, stats.accepted_steps, elapsed, fabs(chain_energy(y1) - chain_energy(y0)) / chain_energy(y0));
+    rk_workspace_destroy(ws);
+    free(y0); free(y1);
+}
+
+typedef struct {
+    rk_par_team *team;
+    const chain_params *params;
+    double *y;
+    double *out;
+} par_case;
+
+static void par_rk4_call(void *arg) {
+    par_case *c = (par_case *)arg;
+    rk_par_rk4_step(c->team, 0.0, c->y, 1e-3, f_chain_range, (void *)c->params, c->out);
+}
+
+/**
+Passo RK4 da cadeia com o vetor de estado dividido entre as threads de um time
+persistente (rk_par) x o passo serial. O resultado tem de ser bit a bit igual ao serial
+para qualquer número de threads; o ganho depende dos núcleos livres (nproc abaixo).
+Depois, a integração adaptativa com a redução paralela do erro, nos dois controles de erro,
+contra a integração serial (RungeKutta_system_adaptive_h): no legado o resultado é bit a
+bit igual; no PI a soma da norma muda de ordem, então a comparação é pela diferença máxima.
+**/
+void bench_rk_par() {
+    int thread_vals[] = {1, 2, 4};
+    int n_threads = sizeof(thread_vals) / sizeof(thread_vals[0]);
+
+    printf("--- RK4 paralelo dentro do passo (cadeia, nproc = %ld) ---\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("n_sites,threads,step_s,speedup,identical\n");
+    for (int n = 1 << 12; n <= 1 << 20; n <<= 8) {
+        chain_params p = { n, 1.0, G / L, 1 };
+        chain_set_params(&p);
+        double *y = malloc(2 * (size_t)n * sizeof(double));
+        double *out_serial = malloc(2 * (size_t)n * sizeof(double));
+        double *out_par = malloc(2 * (size_t)n * sizeof(double));
+        for (int i = 0; i < n; ++i) {
+            y[i] = 0.5 * sin(2.0 * M_PI * i / 64.0);
+            y[n + i] = 0.0;
+        }
+
+        chain_case serial = { f_chain, rk_workspace_create(2 * n), 2 * n, y, out_serial };
+        bench_timing t_serial;
+        bench_measure(NULL, chain_rk4_call, &serial, &t_serial);
+        printf("%d,serial,%.3e,1.00,-\n", n, t_serial.median_s);
+        rk_workspace_destroy(serial.ws);
+
+        for (int k = 0; k < n_threads; ++k) {
+            par_case c = { rk_par_create(thread_vals[k], n, 2), &p, y, out_par };
+            bench_timing t_par;
+            bench_measure(NULL, par_rk4_call, &c, &t_par);
+            int identical = memcmp(out_serial, out_par, 2 * (size_t)n * sizeof(double)) == 0;
+            printf("%d,%d,%.3e,%.2f,%s\n", n, thread_vals[k], t_par.median_s,
+                   t_serial.median_s / t_par.median_s, identical ? "sim" : "NAO");
+            rk_par_destroy(c.team);
+        }
+        free(y); free(out_serial); free(out_par);
+    }
+
+    int n = 1 << 16;
+    chain_params p = { n, 4.0, G / L, 0 };
+    chain_set_params(&p);
+    double *y0 = malloc(2 * (size_t)n * sizeof(double));
+    double *y_ref = malloc(2 * (size_t)n * sizeof(double));
+    double *y1 = malloc(2 * (size_t)n * sizeof(double));
+    for (int i = 0; i < n; ++i) {
+        y0[i] = 4.0 * atan(exp((i - n / 2) / sqrt(p.coupling / p.omega0_sq)));
+        y0[n + i] = 0.01 * sin(0.05 * i);
+    }
+    rk_error_control legacy = RK_ERROR_CONTROL_DEFAULT, pi = RK_ERROR_CONTROL_DEFAULT;
+    pi.mode = RK_CONTROL_PI;
+    printf("adaptativo (N = %d, t = 1, tol = 1e-9): control,threads,steps,rejected,time_s,max_diff_serial,identical\n", n);
+    for (int c = 0; c < 2; ++c) {
+        const char *name = c == 0 ? "legacy" : "pi";
+        rk_stats stats;
+        rk_set_error_control(c == 0 ? &legacy : &pi);
+        double t0 = timing_now();
+        RungeKutta_system_adaptive_h(0.0, 1.0, y0, 2 * n, f_chain, 1e-9, 0.01, NULL, y_ref, &stats);
+        printf("%s,serial,%ld,%ld,%.3f,-,-\n", name, stats.accepted_steps, stats.rejected_steps, timing_now() - t0);
+        rk_thread_workspace_release();
+        for (int k = 0; k < n_threads; ++k) {
+            rk_par_team *team = rk_par_create(thread_vals[k], n, 2);
+            t0 = timing_now();
+            rk_par_integrate(team, 0.0, 1.0, y0, f_chain_range, &p, 1e-9, 0.01, NULL, y1, &stats);
+            double elapsed = timing_now() - t0;
+            double max_diff = 0.0;
+            for (int i = 0; i < 2 * n; ++i) max_diff = fmax(max_diff, fabs(y1[i] - y_ref[i]));
+            int identical = memcmp(y_ref, y1, 2 * (size_t)n * sizeof(double)) == 0;
+            printf("%s,%d,%ld,%ld,%.3f,%.3e,%s\n", name, thread_vals[k], stats.accepted_steps, stats.rejected_steps,
+                   elapsed, max_diff, identical ? "sim" : "NAO");
+            rk_par_destroy(team);
+        }
+    }
+    rk_set_error_control(&legacy);
+    free(y0); free(y_ref); free(y1);
+}
+
+#define SIN_BENCH_N 4096
+
+typedef struct {
+    double theta[SIN_BENCH_N];
+    double omega[SIN_BENCH_N];
+    double dtheta[SIN_BENCH_N];
+    double domega[SIN_BENCH_N];
+} sin_case;
+
+// Derivada escalar, como o integrador genérico chama f_pendulo (um estado por chamada)
+static void sin_scalar_call(void *arg) {
+    sin_case *c = (sin_case *)arg;
+    for (int i = 0; i < SIN_BENCH_N; ++i) {
+        double y[2] = { c->theta[i], c->omega[i] }, dydt[2];
+        f_pendulo(0.0, y, dydt);
+        c->domega[i] = dydt[1];
+    }
+}
+
+static void sin_batch_call(void *arg) {
+    sin_case *c = (sin_case *)arg;
+    f_pendulo_batch(SIN_BENCH_N, c->theta, c->omega, c->dtheta, c->domega);
+}
+
+static double ulp_of(long double x) {
+    double d = fabs((double)x);
+    return d < DBL_MIN ? DBL_TRUE_MIN : ldexp(1.0, ilogb(d) - 52);
+}
+
+/**
+Níveis de precisão do seno (vecmath.h) nas derivadas do pêndulo: erro contra a sinl de
+precisão estendida, vazão da derivada escalar (f_pendulo) e em lote (f_pendulo_batch,
+vetorizada) e o efeito no período calculado para os theta0 de main.c.
+**/
+void bench_sin_kernels() {
+    vm_accuracy saved = pendulo_get_sin_accuracy();
+    double theta0_vals[] = {0.1, 0.5, 1.0, 2.0, 3.0};
+    int n_thetas = sizeof(theta0_vals) / sizeof(theta0_vals[0]);
+    double tol = 1e-7, h = 1e-3;
+    int num_periods = 10;
+    double T_libm[2][5];
+    static sin_case c;
+
+    for (int i = 0; i < SIN_BENCH_N; ++i) {
+        c.theta[i] = -3.0 + 6.0 * i / (SIN_BENCH_N - 1);
+        c.omega[i] = 0.0;
+    }
+
+    printf("--- Seno com precisao selecionavel (erro em [-pi, pi] e [-100, 100]) ---\n");
+    printf("accuracy,max_ulp_pi,max_abs_pi,max_abs_100,scalar_evals_s,batch_evals_s\n");
+    for (int acc = 0; acc < VM_ACC_COUNT; ++acc) {
+        double max_ulp = 0.0, max_abs = 0.0, max_abs_wide = 0.0;
+        for (int i = 0; i <= 1000000; ++i) {
+            double x = -M_PI + 2.0 * M_PI * i / 1000000.0;
+            long double ref = sinl(x);
+            double err = (double)fabsl((long double)vm_sin_acc(acc, x) - ref);
+            max_abs = fmax(max_abs, err);
+            max_ulp = fmax(max_ulp, err / ulp_of(ref));
+            x = -100.0 + 200.0 * i / 1000000.0;
+            max_abs_wide = fmax(max_abs_wide, (double)fabsl((long double)vm_sin_acc(acc, x) - sinl(x)));
+        }
+
+        pendulo_set_sin_accuracy(acc);
+        bench_timing t_scalar, t_batch;
+        bench_measure(NULL, sin_scalar_call, &c, &t_scalar);
+        printf("%s,%.2f,%.2e,%.2e,%.3e,", vm_accuracy_name(acc), max_ulp, max_abs, max_abs_wide,
+               SIN_BENCH_N / t_scalar.median_s);
+        if (acc == VM_ACC_LIBM) {
+            printf("-\n"); // f_pendulo_batch não usa a libm
+        } else {
+            bench_measure(NULL, sin_batch_call, &c, &t_batch);
+            printf("%.3e\n", SIN_BENCH_N / t_batch.median_s);
+        }
+    }
+
+    printf("Efeito no periodo (%d periodos; adaptativo tol = %.0e e RK4 h = %.0e), diferenca contra a libm:\n",
+           num_periods, tol, h);
+    printf("accuracy,theta0,period_adaptive,delta_adaptive,period_rk4,delta_rk4,rk4_error_vs_exact\n");
+    for (int acc = 0; acc < VM_ACC_COUNT; ++acc) {
+        pendulo_set_sin_accuracy(acc);
+        for (int i = 0; i < n_thetas; ++i) {
+            int steps;
+            double T_adapt, T_rk4;
+            detect_period_adaptive(theta0_vals[i], tol, 0.01, num_periods, &T_adapt, &steps, NULL, NULL);
+            T_rk4 = detect_period_constant(theta0_vals[i], h, num_periods, &steps, NULL, NULL);
+            if (acc == VM_ACC_LIBM) {
+                T_libm[0][i] = T_adapt;
+                T_libm[1][i] = T_rk4;
+            }
+            printf("%s,%.1f,%.15f,%.2e,%.15f,%.2e,%.2e\n", vm_accuracy_name(acc), theta0_vals[i],
+                   T_adapt, T_adapt - T_libm[0][i], T_rk4, T_rk4 - T_libm[1][i],
+                   fabs(T_rk4 - exact_period(theta0_vals[i])));
+        }
+    }
+    pendulo_set_sin_accuracy(saved);
+}
+
+// Totais de uma configuração de controle de erro sobre os ângulos de um cenário.
+static void error_control_row(const char *scenario, const char *control, int batch, const double theta0_vals[],
+                              int n_thetas, double tol, double h0, int num_periods) {
+    rk_stats total, stats[8];
+    double T[8], max_err = 0.0;
+    int steps[8];
+
+    rk_stats_reset(&total);
+    if (batch) {
+        detect_period_adaptive_batch(theta0_vals, n_thetas, tol, h0, num_periods, T, steps, NULL, stats);
+    } else {
+        for (int i = 0; i < n_thetas; ++i)
+            detect_period_adaptive(theta0_vals[i], tol, h0, num_periods, &T[i], &steps[i], NULL, &stats[i]);
+    }
+    for (int i = 0; i < n_thetas; ++i) {
+        rk_stats_merge(&total, &stats[i]);
+        max_err = fmax(max_err, fabs(T[i] - exact_period(theta0_vals[i])));
+    }
+    printf("%s,%s,%ld,%ld,%ld,%.3e\n", scenario, control, total.accepted_steps, total.rejected_steps,
+           total.rhs_evals, max_err);
+}
+
+/**
+Controle de erro legado (padrão: só theta, controlador I, h0 = 0.01 fixo) x o opcional (norma
+RMS ponderada em theta e omega, controlador PI, h0 estimado) nos cenários de main.c: a
+varredura de analise_completa (lote, tol = 1e-7), a análise de 10 períodos
+(theta0 = 1.0, tol = 1e-6) e, para cada método adaptativo, uma varredura de tolerâncias
+com os ângulos de main.c.
+**/
+void bench_error_control() {
+    double theta0_vals[] = {0.1, 0.5, 1.0, 2.0, 3.0};
+    int n_thetas = sizeof(theta0_vals) / sizeof(theta0_vals[0]);
+    double theta_one[] = {1.0};
+    rk_error_control legacy = RK_ERROR_CONTROL_DEFAULT, pi = RK_ERROR_CONTROL_DEFAULT;
+    pi.mode = RK_CONTROL_PI;
+
+    printf("--- Controle de erro: legado x PI com norma ponderada ---\n");
+    printf("scenario,control,steps,rejected,rhs_evals,max_period_error\n");
+    for (int c = 0; c < 2; ++c) {
+        rk_set_error_control(c == 0 ? &legacy : &pi);
+        const char *name = c == 0 ? "legacy" : "pi";
+        double h0 = c == 0 ? 0.01 : 0.0;
+        error_control_row("analise_completa_lote", name, 1, theta0_vals, n_thetas, 1e-7, h0, 1);
+        error_control_row("10_periodos", name, 0, theta_one, 1, 1e-6, h0, 10);
+    }
+
+    // Trabalho x precisão: as tolerâncias não significam o mesmo nos dois controles, então a
+    // comparação justa é rhs_evals para o mesmo max_period_error
+    printf("method,control,tol,steps,rejected,rhs_evals,max_period_error (10 periodos)\n");
+    for (int m = 0; m < RK_METHOD_COUNT; ++m) {
+        rk_set_adaptive_method((rk_method)m);
+        for (int c = 0; c < 2; ++c) {
+            rk_set_error_control(c == 0 ? &legacy : &pi);
+            for (double tol = 1e-6; tol > 1e-10; tol /= 10.0) {
+                char label[32];
+                snprintf(label, sizeof(label), "%s,%.0e", c == 0 ? "legacy" : "pi", tol);
+                error_control_row(rk_method_name((rk_method)m), label, 0, theta0_vals, n_thetas,
+                                  tol, c == 0 ? 0.01 : 0.0, 10);
+            }
+        }
+    }
+    rk_set_adaptive_method(RK_METHOD_RK4_DOUBLING);
+    rk_set_error_control(&legacy);
+}
+
+/**
+Consultas de um relatório como o de main.c: 1 período para cada ângulo (adaptativo e os
+três passos constantes) e depois 10 períodos de theta0 = 1.0. Com batch, as consultas de
+1 período vão em lote (period_cache_*_batch), como na análise comparativa. Devolve quantas
+consultas divergem da detecção direta (período, passos ou avaliações de f).
+**/
+#define CACHE_REPORT_QUERIES 24
+
+static int cache_report(period_cache *cache, int batch, double T_out[], int steps_out[], long evals_out[]) {
+    double theta0_vals[] = {0.1, 0.5, 1.0, 2.0, 3.0};
+    double h_vals[] = {0.01, 0.001, 0.0001};
+    int q = 0;
+    rk_stats stats, batch_stats[5];
+    if (batch) {
+        double T[5];
+        int steps[5];
+        for (int m = 0; m < 4; ++m) {
+            if (m == 0)
+                period_cache_adaptive_batch(cache, theta0_vals, 5, 1e-7, 0.0, 1, T, steps, batch_stats);
+            else
+                period_cache_fixed_batch(cache, theta0_vals, 5, h_vals[m - 1], 1, T, steps, batch_stats);
+            for (int i = 0; i < 5; ++i) {
+                T_out[4 * i + m] = T[i];
+                steps_out[4 * i + m] = steps[i];
+                evals_out[4 * i + m] = batch_stats[i].rhs_evals;
+            }
+        }
+        q = 20;
+    } else {
+        for (int i = 0; i < 5; ++i) {
+            period_cache_adaptive(cache, theta0_vals[i], 1e-7, 0.0, 1, &T_out[q], &steps_out[q], &stats);
+            evals_out[q++] = stats.rhs_evals;
+            for (int j = 0; j < 3; ++j) {
+                period_cache_fixed(cache, PENDULO_FIXED_RK4, theta0_vals[i], h_vals[j], 1, &T_out[q], &steps_out[q], &stats);
+                evals_out[q++] = stats.rhs_evals;
+            }
+        }
+    }
+    for (int j = 0; j < 3; ++j) {
+        period_cache_fixed(cache, PENDULO_FIXED_RK4, 1.0, h_vals[j], 10, &T_out[q], &steps_out[q], &stats);
+        evals_out[q++] = stats.rhs_evals;
+    }
+    period_cache_adaptive(cache, 1.0, 1e-6, 0.0, 10, &T_out[q], &steps_out[q], &stats);
+    evals_out[q++] = stats.rhs_evals;
+    return q;
+}
+
+static int cache_mismatches(int n, const double T[], const int steps[], const long evals[],
+                            const double T_ref[], const int steps_ref[], const long evals_ref[]) {
+    int mismatches = 0;
+    for (int k = 0; k < n; ++k)
+        if (T[k] != T_ref[k] || steps[k] != steps_ref[k] || evals[k] != evals_ref[k])
+            mismatches++;
+    return mismatches;
+}
+
+/**
+Cache de períodos: o mesmo relatório sem cache, com o cache vazio, com o cache cheio e
+com o cache lido do disco; depois, continuar de 1 para 10 períodos em cada método contra
+a integração direta de 10 períodos.
+**/
+void bench_period_cache() {
+    const char *path = "output/bench_period_cache.bin";
+    double T_ref[CACHE_REPORT_QUERIES], T[CACHE_REPORT_QUERIES];
+    int steps_ref[CACHE_REPORT_QUERIES], steps[CACHE_REPORT_QUERIES];
+    long evals_ref[CACHE_REPORT_QUERIES], evals[CACHE_REPORT_QUERIES];
+
+    printf("--- Cache de periodos (%d consultas do relatorio de main.c) ---\n", CACHE_REPORT_QUERIES);
+    printf("mode,time_s,hits,resumes,misses,mismatches\n");
+
+    double t0 = timing_now();
+    int n = cache_report(NULL, 0, T_ref, steps_ref, evals_ref);
+    double t1 = timing_now();
+    printf("direct,%.6f,0,0,%d,0\n", t1 - t0, n);
+
+    period_cache *cache = period_cache_create();
+    period_cache_counters c;
+    for (int pass = 0; pass < 2; ++pass) {
+        t0 = timing_now();
+        cache_report(cache, 0, T, steps, evals);
+        t1 = timing_now();
+        period_cache_counters before = c;
+        period_cache_get_counters(cache, &c);
+        if (pass == 0)
+            memset(&before, 0, sizeof(before));
+        printf("%s,%.6f,%ld,%ld,%ld,%d\n", pass == 0 ? "cold" : "warm", t1 - t0, c.hits - before.hits,
+               c.resumes - before.resumes, c.misses - before.misses,
+               cache_mismatches(n, T, steps, evals, T_ref, steps_ref, evals_ref));
+    }
+    period_cache_save(cache, path);
+    period_cache_destroy(cache);
+
+    // Leitura do arquivo incluída no tempo, como numa nova execução do relatório
+    t0 = timing_now();
+    cache = period_cache_create();
+    int loaded = period_cache_load(cache, path);
+    cache_report(cache, 0, T, steps, evals);
+    t1 = timing_now();
+    period_cache_get_counters(cache, &c);
+    printf("disk (%d entradas),%.6f,%ld,%ld,%ld,%d\n", loaded, t1 - t0, c.hits, c.resumes, c.misses,
+           cache_mismatches(n, T, steps, evals, T_ref, steps_ref, evals_ref));
+    period_cache_destroy(cache);
+    remove(path);
+
+    // Em lote: as faltas vão para os kernels em lote, e os 10 períodos de theta0 = 1.0
+    // continuam dos checkpoints gravados por eles
+    t0 = timing_now();
+    cache_report(NULL, 1, T, steps, evals);
+    t1 = timing_now();
+    printf("batch_direct,%.6f,0,0,%d,%d\n", t1 - t0, n, cache_mismatches(n, T, steps, evals, T_ref, steps_ref, evals_ref));
+    cache = period_cache_create();
+    t0 = timing_now();
+    cache_report(cache, 1, T, steps, evals);
+    t1 = timing_now();
+    period_cache_get_counters(cache, &c);
+    printf("batch_cold,%.6f,%ld,%ld,%ld,%d\n", t1 - t0, c.hits, c.resumes, c.misses,
+           cache_mismatches(n, T, steps, evals, T_ref, steps_ref, evals_ref));
+    period_cache_destroy(cache);
+
+    // Continuar de 1 para 10 períodos: igual à integração direta (os pares com FSAL
+    // reavaliam f uma vez ao retomar)
+    printf("method,theta0,period_resumed,period_direct,steps_resumed,steps_direct,evals_resumed,evals_direct\n");
+    cache = period_cache_create();
+    for (int m = 0; m < RK_METHOD_COUNT + 2; ++m) {
+        double theta0 = 2.0, T1, T10, T_direct;
+        int s10, s_direct;
+        rk_stats st10, st_direct;
+        const char *name;
+        if (m < RK_METHOD_COUNT) {
+            rk_set_adaptive_method((rk_method)m);
+            name = rk_method_name((rk_method)m);
+            period_cache_adaptive(cache, theta0, 1e-8, 0.0, 1, &T1, NULL, NULL);
+            period_cache_adaptive(cache, theta0, 1e-8, 0.0, 10, &T10, &s10, &st10);
+            detect_period_adaptive(theta0, 1e-8, 0.0, 10, &T_direct, &s_direct, NULL, &st_direct);
+        } else {
+            pendulo_fixed_method fm = m == RK_METHOD_COUNT ? PENDULO_FIXED_RK4 : PENDULO_FIXED_YOSHIDA4;
+            name = pendulo_fixed_method_name(fm);
+            period_cache_fixed(cache, fm, theta0, 0.001, 1, &T1, NULL, NULL);
+            period_cache_fixed(cache, fm, theta0, 0.001, 10, &T10, &s10, &st10);
+            T_direct = detect_period_fixed(fm, theta0, 0.001, 10, &s_direct, NULL, &st_direct);
+        }
+        printf("%s,%.2f,%.15f,%.15f,%d,%d,%ld,%ld\n", name, theta0, T10, T_direct, s10, s_direct,
+               st10.rhs_evals, st_direct.rhs_evals);
+    }
+    rk_set_adaptive_method(RK_METHOD_RK4_DOUBLING);
+    period_cache_destroy(cache);
+}
+
+/**
+Modo servidor: um fluxo de consultas como o de um pipeline (50 ângulos x 2 métodos,
+repetidos 20 vezes) atendido por server_run_stream sem cache, com o cache vazio e com o
+cache já cheio. A latência inclui a espera na fila, já que o fluxo chega todo de uma vez.
+**/
+void bench_server() {
+    int n_angles = 50, repeats = 20;
+    FILE *in = tmpfile();
+    FILE *out = tmpfile();
+    if (!in || !out) {
+        return;
+    }
+    for (int r = 0; r < repeats; ++r) {
+        for (int i = 0; i < n_angles; ++i) {
+            double theta0 = 0.1 + (3.0 - 0.1) * i / (double)(n_angles - 1);
+            fprintf(in, "id=%d theta0=%.6f method=rk4 h=0.01\n", 2 * (r * n_angles + i), theta0);
+            fprintf(in, "{\"id\": %d, \"theta0\": %.6f, \"tol\": 1e-7}\n", 2 * (r * n_angles + i) + 1, theta0);
+        }
+    }
+
+    printf("--- Modo servidor (%d consultas por fluxo) ---\n", 2 * n_angles * repeats);
+    printf("mode,queries,errors,queries_per_s,p50_us,p90_us,p99_us,max_us\n");
+    period_cache *cache = period_cache_create();
+    for (int mode = 0; mode < 3; ++mode) {
+        server_config cfg = SERVER_CONFIG_DEFAULT;
+        server_summary sum;
+        cfg.cache = mode == 0 ? NULL : cache;
+        cfg.quiet = 1;
+        rewind(in);
+        rewind(out);
+        server_run_stream(&cfg, in, out, &sum);
+        printf("%s,%ld,%ld,%.0f,%.1f,%.1f,%.1f,%.1f\n", mode == 0 ? "no_cache" : mode == 1 ? "cold_cache" : "warm_cache",
+               sum.queries, sum.errors, sum.elapsed_s > 0.0 ? sum.queries / sum.elapsed_s : 0.0,
+               sum.p50_us, sum.p90_us, sum.p99_us, sum.max_us);
+    }
+    period_cache_destroy(cache);
+    fclose(in);
+    fclose(out);
+}
+
+// Pontos distintos (a menos de 1e-3) entre n amostras de Poincaré: 1 = órbita de período 1, ...
+static int poincare_distinct(const float theta[], const float omega[], int n) {
+    int distinct = 0;
+    for (int i = 0; i < n; ++i) {
+        int seen = 0;
+        for (int j = 0; j < i && !seen; ++j)
+            seen = fabsf(theta[i] - theta[j]) < 1e-3f && fabsf(omega[i] - omega[j]) < 1e-3f;
+        distinct += !seen;
+    }
+    return distinct;
+}
+
+/**
+Pêndulo amortecido e forçado: as amplitudes clássicas de Baker e Gollub (período 1, 2 e
+caos), a varredura em paralelo contra driven_poincare ponto a ponto e o custo por ponto
+da grade com o passo dobrado e com o DP54.
+**/
+void bench_driven() {
+    double amps[] = {0.9, 1.07, 1.15, 1.35, 1.45, 1.5};
+    int n_amps = sizeof(amps) / sizeof(amps[0]);
+    int samples = 64;
+    float theta[64], omega[64];
+    double y0[2] = {0.2, 0.0};
+
+    printf("--- Pendulo amortecido e forcado (gamma = 0.5, w_d = 2/3, 300 periodos de transiente) ---\n");
+    printf("amplitude,distinct_points,steps_per_period\n");
+    for (int a = 0; a < n_amps; ++a) {
+        driven_params p = {0.5, 1.0, amps[a], 2.0 / 3.0};
+        driven_set_params(&p);
+        long steps = driven_poincare(y0, 1e-8, 300, samples, theta, omega, NULL);
+        printf("%.2f,%d,%.1f\n", amps[a], poincare_distinct(theta, omega, samples), steps / (300.0 + samples));
+    }
+
+    driven_sweep_config cfg = {0.5, 1.0, 0.9, 1.5, 24, 0.6, 0.7, 2, 0.2, 0.0, 100, 32, 1e-8};
+    int n_cells = cfg.n_amp * cfg.n_freq;
+    sched_pool *pool = sched_create(0);
+    printf("method,cells,samples_bytes,steps,rhs_evals,time_s,cells_per_s,mismatches\n");
+    for (int m = 0; m < 2; ++m) {
+        rk_set_adaptive_method(m == 0 ? RK_METHOD_RK4_DOUBLING : RK_METHOD_DP54);
+        double t0 = timing_now();
+        driven_bifurcation *bif = driven_sweep(pool, &cfg);
+        double t1 = timing_now();
+        if (!bif) {
+            break;
+        }
+
+        // Cada ponto da varredura deve ser igual à integração isolada com os mesmos parâmetros
+        int mismatches = 0;
+        for (int cell = 0; cell < n_cells; ++cell) {
+            driven_params p = {cfg.gamma, cfg.omega0_sq, driven_grid_amplitude(&cfg, cell / cfg.n_freq),
+                               driven_grid_frequency(&cfg, cell % cfg.n_freq)};
+            float th[32], om[32];
+            driven_set_params(&p);
+            driven_poincare(y0, cfg.tol, cfg.transient_periods, cfg.samples, th, om, NULL);
+            mismatches += memcmp(th, bif->theta + cell * cfg.samples, sizeof(th)) != 0 ||
+                          memcmp(om, bif->omega + cell * cfg.samples, sizeof(om)) != 0;
+        }
+        printf("%s,%d,%zu,%ld,%ld,%.4f,%.1f,%d\n", rk_method_name(rk_get_adaptive_method()), n_cells,
+               (size_t)n_cells * cfg.samples * 2 * sizeof(float), bif->steps, bif->rhs_evals, t1 - t0,
+               n_cells / (t1 - t0), mismatches);
+        driven_bifurcation_free(bif);
+    }
+    rk_set_adaptive_method(RK_METHOD_RK4_DOUBLING);
+    sched_destroy(pool);
+}
+
+/**
+Varredura em shards (shard.h): cada shard roda num processo filho (fork), integra os seus
+ângulos e grava o arquivo parcial; o pai junta os parciais e confere, bit a bit, contra a
+varredura feita num só processo. busiest_cpu_s é o tempo de CPU do shard mais carregado (enviado
+ao pai por um pipe): é o tempo total esperado com um núcleo por shard.
+**/
+void bench_shards() {
+    int n = 48;
+    int num_periods = 10;
+    double tol = 1e-10;
+    double theta0[48], T_direct[48];
+    long steps_direct[48];
+    int counts[] = {1, 2, 4, 8};
+    int n_counts = sizeof(counts) / sizeof(counts[0]);
+    char dir[] = "/tmp/pendulo_shardsXXXXXX";
+
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return;
+    }
+    double t0 = timing_now();
+    for (int i = 0; i < n; ++i) {
+        int steps;
+        theta0[i] = 0.05 + (3.0 - 0.05) * i / (double)(n - 1);
+        detect_period_adaptive(theta0[i], tol, 0.0, num_periods, &T_direct[i], &steps, NULL, NULL);
+        steps_direct[i] = steps;
+    }
+    double direct_s = timing_now() - t0;
+
+    uint64_t config = shard_hash(shard_hash(SHARD_HASH_INIT, theta0, sizeof(theta0)), &tol, sizeof(tol));
+    printf("--- Varredura em shards (%d angulos, %d periodos, adaptativo tol = %.0e, um processo por shard) ---\n",
+           n, num_periods, tol);
+    printf("shards,direct_s,total_s,busiest_cpu_s,merge_s,mismatches\n");
+    for (int c = 0; c < n_counts; ++c) {
+        int count = counts[c];
+        char paths[8][512];
+        const char *path_ptrs[8];
+        pid_t pids[8];
+        int times[2];
+
+        if (pipe(times) != 0) {
+            perror("pipe");
+            break;
+        }
+        t0 = timing_now();
+        for (int s = 0; s < count; ++s) {
+            snprintf(paths[s], sizeof(paths[s]), "%s/part-%d-of-%d", dir, s, count);
+            path_ptrs[s] = paths[s];
+            pids[s] = fork();
+            if (pids[s] == 0) {
+                shard_spec spec = {s, count};
+                shard_part part;
+                close(times[0]);
+                if (!shard_part_open(&part, paths[s], "bench", config, &spec, n, 2, "period,steps")) {
+                    _exit(1);
+                }
+                clock_t ts = clock();
+                for (long job = s; job < n; job += count) {
+                    int steps;
+                    double values[2];
+                    detect_period_adaptive(theta0[job], tol, 0.0, num_periods, &values[0], &steps, NULL, NULL);
+                    values[1] = steps;
+                    shard_part_write(&part, job, values);
+                }
+                double elapsed = (double)(clock() - ts) / CLOCKS_PER_SEC;
+                int ok = shard_part_close(&part) && write(times[1], &elapsed, sizeof(elapsed)) == sizeof(elapsed);
+                _exit(ok ? 0 : 1);
+            }
+        }
+        close(times[1]);
+        double busiest = 0.0, elapsed;
+        int failed = 0;
+        for (int s = 0; s < count; ++s) {
+            int status;
+            waitpid(pids[s], &status, 0);
+            failed |= pids[s] < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        double t1 = timing_now();
+        while (read(times[0], &elapsed, sizeof(elapsed)) == sizeof(elapsed)) {
+            busiest = fmax(busiest, elapsed);
+        }
+        close(times[0]);
+
+        shard_merged merged;
+        int ok = !failed && shard_merge(path_ptrs, count, "bench", config, n, 2, &merged);
+        double t2 = timing_now();
+        int mismatches = 0;
+        for (int i = 0; ok && i < n; ++i) {
+            mismatches += merged.values[2 * i] != T_direct[i] || merged.values[2 * i + 1] != steps_direct[i];
+        }
+        printf("%d,%.4f,%.4f,%.4f,%.6f,%s\n", count, direct_s, t1 - t0, busiest, t2 - t1,
+               ok ? (mismatches ? "DIFERENTE" : "0") : "FALHOU");
+        if (ok) {
+            shard_merged_free(&merged);
+        }
+        for (int s = 0; s < count; ++s) {
+            remove(paths[s]);
+        }
+    }
+    rmdir(dir);
+}
+
+typedef struct {
+    sched_pool *pool; // NULL: solução fina serial
+    double t_final;
+    const double *y0;
+    const parareal_config *cfg;
+    double y[2];
+    parareal_result result;
+} parareal_call;
+
+static void parareal_bench_call(void *arg) {
+    parareal_call *c = (parareal_call *)arg;
+    if (c->pool) {
+        parareal_solve(c->pool, 0.0, c->t_final, c->y0, N_EQ, f_pendulo, c->cfg, c->y, &c->result);
+    } else {
+        parareal_serial_fine(0.0, c->t_final, c->y0, N_EQ, f_pendulo, c->cfg, c->y, NULL);
+    }
+}
+
+/**
+Parareal (parareal.h) numa trajetória longa do pêndulo (theta0 = 2, 100 períodos). Primeiro a
+convergência: o erro contra a solução fina serial nas mesmas fatias, limitando o número de
+iterações a k. Depois o tempo com 1, 2, 4 e 8 threads: measured é a mediana medida nesta
+máquina; projected é o tempo esperado com um núcleo por thread, montado com os tempos
+medidos de G e do tempo de CPU de cada fatia de F (as fatias de cada iteração divididas
+entre as threads). Por fim, 1000 períodos com fatias do mesmo tamanho (N = 320): o número de
+iterações quase não cresce, então o ganho possível (N / k) cresce com o horizonte.
+**/
+void bench_parareal() {
+    double y0[2] = {2.0, 0.0};
+    double T = exact_period(y0[0]);
+    parareal_config cfg = {32, 400, 1e-12, 1e-9, 0};
+    double t_final = 100 * T;
+    bench_config bcfg = {1, 7, 0.0};
+    bench_timing serial_timing;
+
+    // Referência: a solução fina serial nas mesmas fatias e uma integração adaptativa única
+    parareal_call serial = {NULL, t_final, y0, &cfg};
+    bench_measure(&bcfg, parareal_bench_call, &serial, &serial_timing);
+    double y_single[2];
+    RungeKutta_system_adaptive_h(0.0, t_final, y0, N_EQ, f_pendulo, cfg.fine_tol, 0.0, NULL, y_single, NULL);
+
+    printf("--- Parareal (theta0 = 2, 100 periodos, N = %d fatias, G = RK4 com %d passos/fatia, F tol = %.0e) ---\n",
+           cfg.n_slices, cfg.coarse_steps, cfg.fine_tol);
+    printf("serial_fine_s = %.4f; |fatias - integracao unica| = %.2e\n", serial_timing.median_s,
+           fmax(fabs(serial.y[0] - y_single[0]), fabs(serial.y[1] - y_single[1])));
+
+    sched_pool *pool = sched_create(1);
+    printf("max_iter,update,error_vs_serial_fine\n");
+    for (int k = 1; k <= 4; ++k) {
+        parareal_config limited = cfg;
+        parareal_result r;
+        double y[2];
+        limited.max_iter = k;
+        parareal_solve(pool, 0.0, t_final, y0, N_EQ, f_pendulo, &limited, y, &r);
+        printf("%d,%.3e,%.3e\n", k, r.update[r.iterations - 1], fmax(fabs(y[0] - serial.y[0]), fabs(y[1] - serial.y[1])));
+        if (r.converged) {
+            break;
+        }
+    }
+    sched_destroy(pool);
+
+    int threads[] = {1, 2, 4, 8};
+    int n_threads = sizeof(threads) / sizeof(threads[0]);
+    printf("(%ld nucleo(s) nesta maquina)\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("threads,iterations,fine_slices,coarse_s,measured_s,speedup_measured,projected_s,speedup_projected\n");
+    for (int p = 0; p < n_threads; ++p) {
+        parareal_call call = {sched_create(threads[p]), t_final, y0, &cfg};
+        bench_timing timing;
+        if (!call.pool) {
+            break;
+        }
+        bench_measure(&bcfg, parareal_bench_call, &call, &timing);
+        sched_destroy(call.pool);
+
+        const parareal_result *r = &call.result;
+        double t_slice = r->fine_work_s / r->fine_slices;
+        double projected = r->coarse_s;
+        for (int k = 1; k <= r->iterations; ++k) {
+            int slices = cfg.n_slices - (k - 1);
+            projected += (slices + threads[p] - 1) / threads[p] * t_slice;
+        }
+        printf("%d,%d,%ld,%.4f,%.4f,%.2f,%.4f,%.2f\n", threads[p], r->iterations, r->fine_slices, r->coarse_s,
+               timing.median_s, serial_timing.median_s / timing.median_s, projected,
+               serial_timing.median_s / projected);
+    }
+
+    // Horizonte 10x maior, com fatias e passo grosso do mesmo tamanho
+    parareal_config longer = cfg;
+    parareal_result r;
+    double y_long[2], y_long_serial[2];
+    longer.n_slices = 320;
+    pool = sched_create(1);
+    parareal_solve(pool, 0.0, 10 * t_final, y0, N_EQ, f_pendulo, &longer, y_long, &r);
+    sched_destroy(pool);
+    parareal_serial_fine(0.0, 10 * t_final, y0, N_EQ, f_pendulo, &longer, y_long_serial, NULL);
+    printf("1000 periodos, N = %d: %d iteracoes (update na 1a = %.2e), erro vs fina serial = %.2e\n",
+           longer.n_slices, r.iterations, r.update[0],
+           fmax(fabs(y_long[0] - y_long_serial[0]), fabs(y_long[1] - y_long_serial[1])));
+}
+
+typedef struct {
+    int adaptive;
+    double param; // h ou tol
+    double theta0;
+    int periods;
+} suite_case;
+
+static void suite_call(void *arg) {
+    suite_case *c = (suite_case *)arg;
+    int steps;
+    double T;
+    if (c->adaptive) {
+        detect_period_adaptive(c->theta0, c->param, 0.01, c->periods, &T, &steps, NULL, NULL);
+    } else {
+        detect_period_constant(c->theta0, c->param, c->periods, &steps, NULL, NULL);
+    }
+}
+
+/**
+Suíte de regressão: cada (método, theta0, número de períodos) é medido com o harness
+(aquecimento, 21 amostras, mediana e percentis). Os resultados vão para json_path e,
+se houver baseline, cada caso é comparado com ele. A suíte falha se o número de passos
+ou de avaliações de f aumentar: esses contadores são determinísticos e valem em qualquer
+máquina. Uma mediana mais que tolerance (fração) acima da do baseline só gera um aviso,
+porque o baseline guarda tempos absolutos da máquina onde foi gravado; com gate_time = 1
+(mesma máquina) ela também conta como regressão.
+@return 1 se não houve regressão, 0 caso contrário.
+**/
+int bench_period_suite(const char *json_path, const char *baseline_path, double tolerance, int gate_time) {
+    double h_vals[] = {1e-2, 1e-3};
+    int n_h = sizeof(h_vals) / sizeof(h_vals[0]);
+    double tol = 1e-8;
+    double theta0_vals[] = {0.5, 2.0, 3.0};
+    int n_thetas = sizeof(theta0_vals) / sizeof(theta0_vals[0]);
+    int period_vals[] = {1, 10};
+    int n_periods = sizeof(period_vals) / sizeof(period_vals[0]);
+
+    FILE *json = json_path ? fopen(json_path, "w") : NULL;
+    FILE *baseline = baseline_path ? fopen(baseline_path, "r") : NULL;
+    if (json_path && !json) {
+        perror(json_path);
+        return 0;
+    }
+    if (baseline_path && !baseline) {
+        printf("(baseline %s nao encontrado; rode 'make bench-baseline' para criar)\n", baseline_path);
+    }
+
+    int n_methods = n_h + RK_METHOD_COUNT;
+    int n_cases = n_methods * n_thetas * n_periods;
+    int regressions = 0, warnings = 0, case_index = 0;
+
+    printf("--- Suite de regressao (%d casos, tolerancia %.0f%%) ---\n", n_cases, 100.0 * tolerance);
+    printf("name,steps,rhs_evals,median_ns,p10_ns,p90_ns,ns_per_step,rhs_evals_per_s,baseline_ns,ratio,status\n");
+    if (json) bench_json_begin(json, "pendulo_periodo");
+
+    for (int m = 0; m < n_methods; ++m) {
+        int adaptive = (m >= n_h);
+        if (adaptive) rk_set_adaptive_method((rk_method)(m - n_h));
+        for (int i = 0; i < n_thetas; ++i) {
+            for (int k = 0; k < n_periods; ++k) {
+                suite_case c = { adaptive, adaptive ? tol : h_vals[m], theta0_vals[i], period_vals[k] };
+                bench_record rec;
+                rk_stats stats;
+                int steps;
+                double T;
+
+                memset(&rec, 0, sizeof(rec));
+                snprintf(rec.method, sizeof(rec.method), "%s",
+                         adaptive ? rk_method_name((rk_method)(m - n_h)) : "constant");
+                snprintf(rec.name, sizeof(rec.name), "%s/%.1e/theta0=%.2f/periods=%d",
+                         rec.method, c.param, c.theta0, c.periods);
+                rec.param = c.param;
+                rec.theta0 = c.theta0;
+                rec.periods = c.periods;
+
+                // Contadores numa execução à parte; as medidas usam stats = NULL
+                if (adaptive)
+                    detect_period_adaptive(c.theta0, c.param, 0.01, c.periods, &T, &steps, NULL, &stats);
+                else
+                    detect_period_constant(c.theta0, c.param, c.periods, &steps, NULL, &stats);
+                rec.steps = steps;
+                rec.rhs_evals = stats.rhs_evals;
+                bench_measure(NULL, suite_call, &c, &rec.timing);
+
+                double median_ns = 1e9 * rec.timing.median_s;
+                double base_ns = 0.0, ratio = 0.0;
+                long base_steps = 0, base_evals = 0;
+                const char *status = "new";
+                if (baseline && bench_baseline_lookup(baseline, rec.name, &base_ns, &base_steps, &base_evals)) {
+                    ratio = median_ns / base_ns;
+                    status = "ok";
+                    if (rec.steps > base_steps) {
+                        status = "REGRESSION(steps)";
+                        regressions++;
+                    } else if (base_evals > 0 && rec.rhs_evals > base_evals) {
+                        status = "REGRESSION(rhs_evals)";
+                        regressions++;
+                    } else if (ratio > 1.0 + tolerance) {
+                        if (gate_time) {
+                            status = "REGRESSION(time)";
+                            regressions++;
+                        } else {
+                            status = "AVISO(time)";
+                            warnings++;
+                        }
+                    }
+                }
+                printf("%s,%ld,%ld,%.0f,%.0f,%.0f,%.2f,%.3e,%.0f,%.3f,%s\n", rec.name, rec.steps, rec.rhs_evals,
+                       median_ns, 1e9 * rec.timing.p10_s, 1e9 * rec.timing.p90_s,
+                       median_ns / (double)rec.steps, rec.rhs_evals / rec.timing.median_s,
+                       base_ns, ratio, status);
+                case_index++;
+                if (json) bench_json_record(json, &rec, case_index == n_cases);
+            }
+        }
+    }
+    rk_set_adaptive_method(RK_METHOD_RK4_DOUBLING);
+
+    if (json) {
+        bench_json_end(json);
+        fclose(json);
+        printf("resultados gravados em %s\n", json_path);
+    }
+    if (baseline) fclose(baseline);
+    if (warnings) printf("%d caso(s) mais lento(s) que o baseline (aviso; o baseline pode ser de outra maquina)\n", warnings);
+    if (regressions) printf("%d regressao(oes) em relacao ao baseline\n", regressions);
+    return regressions == 0;
+}
+
+/**
+Sem argumentos roda as seções exploratórias acima. Com --suite roda só a suíte de
+regressão: --json grava os resultados, --baseline compara com um JSON anterior
+(--tolerance ajusta a folga de tempo, 0.25 por padrão) e o código de saída é 1 se
+houver regressão nos contadores. --gate-time faz o tempo também contar como regressão
+(só faz sentido com um baseline gravado na mesma máquina).
+**/
+int main(int argc, char *argv[]) {
+    const char *json_path = NULL, *baseline_path = NULL;
+    double tolerance = 0.25;
+    int suite = 0, gate_time = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--suite") == 0) {
+            suite = 1;
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--gate-time") == 0) {
+            gate_time = 1;
+        } else {
+            fprintf(stderr, "Uso: %s [--suite [--json arquivo] [--baseline arquivo] [--tolerance fracao] [--gate-time]]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (suite) {
+        return bench_period_suite(json_path, baseline_path, tolerance, gate_time) ? 0 : 1;
+    }
+
+    bench_ensemble_constant();
+    bench_ensemble_adaptive();
+    bench_adaptive_methods();
+    bench_scheduler_scaling();
+    bench_exact_period();
+    bench_sinks();
+    bench_async_sink();
+    bench_specialized_steppers();
+    bench_solver_stats();
+    bench_symplectic();
+    bench_taylor();
+    bench_large_system();
+    bench_chain();
+    bench_rk_par();
+    bench_sin_kernels();
+    bench_error_control();
+    bench_period_cache();
+    bench_server();
+    bench_driven();
+    bench_shards();
+    bench_parareal();
+    return 0;
+}
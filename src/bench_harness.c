@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_harness.h"
+#include "timing.h"
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double bench_percentile(const double sorted[], int n, double p)
+{
+    if (n <= 0)
+        return 0.0;
+    double pos = (p / 100.0) * (n - 1);
+    int i = (int)pos;
+    if (i >= n - 1)
+        return sorted[n - 1];
+    double frac = pos - i;
+    return sorted[i] + frac * (sorted[i + 1] - sorted[i]);
+}
+
+int bench_measure(const bench_config *cfg, bench_fn fn, void *arg, bench_timing *out)
+{
+    static const bench_config default_cfg = BENCH_DEFAULT_CONFIG;
+    if (cfg == NULL)
+        cfg = &default_cfg;
+    if (cfg->samples <= 0)
+        return 0;
+
+    double *samples = malloc(cfg->samples * sizeof(double));
+    if (!samples)
+        return 0;
+
+    // Aquecimento; a última execução também estima quantas chamadas cabem numa amostra
+    double t_call = 0.0;
+    for (int i = 0; i < (cfg->warmup > 0 ? cfg->warmup : 1); ++i)
+    {
+        double t0 = timing_now();
+        fn(arg);
+        t_call = timing_now() - t0;
+    }
+    long calls = 1;
+    if (cfg->min_sample_s > 0.0 && t_call < cfg->min_sample_s)
+        calls = (t_call > 0.0) ? (long)(cfg->min_sample_s / t_call) + 1 : 1000;
+
+    for (int s = 0; s < cfg->samples; ++s)
+    {
+        double t0 = timing_now();
+        for (long c = 0; c < calls; ++c)
+            fn(arg);
+        samples[s] = (timing_now() - t0) / (double)calls;
+    }
+
+    qsort(samples, cfg->samples, sizeof(double), compare_double);
+    out->samples = cfg->samples;
+    out->calls_per_sample = calls;
+    out->median_s = bench_percentile(samples, cfg->samples, 50.0);
+    out->p10_s = bench_percentile(samples, cfg->samples, 10.0);
+    out->p90_s = bench_percentile(samples, cfg->samples, 90.0);
+    out->min_s = samples[0];
+    out->max_s = samples[cfg->samples - 1];
+    free(samples);
+    return 1;
+}
+
+void bench_json_begin(FILE *fp, const char *suite)
+{
+    fprintf(fp, "{\"suite\": \"%s\", \"records\": [\n", suite);
+}
+
+void bench_json_record(FILE *fp, const bench_record *rec, int last)
+{
+    double median_ns = 1e9 * rec->timing.median_s;
+    fprintf(fp,
+            "{\"name\": \"%s\", \"method\": \"%s\", \"param\": %.3e, \"theta0\": %.4f, \"periods\": %d, "
+            "\"steps\": %ld, \"rhs_evals\": %ld, \"median_ns\": %.1f, \"p10_ns\": %.1f, \"p90_ns\": %.1f, "
+            "\"min_ns\": %.1f, \"max_ns\": %.1f, \"samples\": %d, \"calls_per_sample\": %ld, "
+            "\"ns_per_step\": %.3f, \"rhs_evals_per_s\": %.4e, \"steps_per_period\": %.2f}%s\n",
+            rec->name, rec->method, rec->param, rec->theta0, rec->periods,
+            rec->steps, rec->rhs_evals, median_ns, 1e9 * rec->timing.p10_s, 1e9 * rec->timing.p90_s,
+            1e9 * rec->timing.min_s, 1e9 * rec->timing.max_s, rec->timing.samples, rec->timing.calls_per_sample,
+            rec->steps ? median_ns / (double)rec->steps : 0.0,
+            rec->timing.median_s > 0.0 ? (double)rec->rhs_evals / rec->timing.median_s : 0.0,
+            rec->periods ? (double)rec->steps / rec->periods : 0.0,
+            last ? "" : ",");
+}
+
+void bench_json_end(FILE *fp)
+{
+    fprintf(fp, "]}\n");
+}
+
+// Lê o número que segue "key": numa linha de registro.
+static int json_field(const char *line, const char *key, double *value)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    if (!p)
+        return 0;
+    return sscanf(p + strlen(pattern), "%lf", value) == 1;
+}
+
+int bench_baseline_lookup(FILE *fp, const char *name, double *median_ns_out, long *steps_out, long *rhs_evals_out)
+{
+    char line[1024], pattern[128];
+    snprintf(pattern, sizeof(pattern), "{\"name\": \"%s\",", name);
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (strncmp(line, pattern, strlen(pattern)) != 0)
+            continue;
+        double median_ns, steps, rhs_evals;
+        if (!json_field(line, "median_ns", &median_ns) || !json_field(line, "steps", &steps) ||
+            !json_field(line, "rhs_evals", &rhs_evals))
+            return 0;
+        *median_ns_out = median_ns;
+        *steps_out = (long)steps;
+        *rhs_evals_out = (long)rhs_evals;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stdio.h>
+
+/*
+ * Medição de tempo repetida: aquecimento, várias amostras com o relógio monotônico
+ * (timing_now) e estatísticas de ordem (mediana e percentis), que não se deixam levar
+ * por uma amostra isolada interrompida pelo sistema.
+ *
+ * Trabalhos de poucos microssegundos são repetidos dentro de cada amostra até ela durar
+ * pelo menos min_sample_s, para que a resolução do relógio não domine a medida.
+ */
+
+typedef struct
+{
+    int warmup;          // Execuções descartadas antes de medir
+    int samples;         // Amostras cronometradas
+    double min_sample_s; // Duração mínima de cada amostra (<= 0: uma chamada por amostra)
+} bench_config;
+
+// Configuração usada por bench_measure quando cfg == NULL.
+#define BENCH_DEFAULT_CONFIG {3, 21, 2e-3}
+
+// Resultado de uma medição, em segundos por chamada.
+typedef struct
+{
+    int samples;
+    long calls_per_sample;
+    double median_s;
+    double p10_s;
+    double p90_s;
+    double min_s;
+    double max_s;
+} bench_timing;
+
+typedef void (*bench_fn)(void *arg);
+
+/**
+ * @brief Mede o tempo de fn(arg) por chamada.
+ * @param cfg Configuração (NULL = BENCH_DEFAULT_CONFIG).
+ * @param out Estatísticas da medição.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int bench_measure(const bench_config *cfg, bench_fn fn, void *arg, bench_timing *out);
+
+/**
+ * @brief Percentil p (0 a 100) de n valores já ordenados, com interpolação linear.
+ */
+double bench_percentile(const double sorted[], int n, double p);
+
+/*
+ * Resultados em JSON, um registro por linha:
+ *   {"suite": "...", "records": [
+ *   {"name": "...", "steps": ..., "rhs_evals": ..., "median_ns": ..., ...},
+ *   ...
+ *   ]}
+ * O formato de uma linha por registro permite comparar com um baseline sem um
+ * parser de JSON completo (bench_baseline_lookup).
+ */
+
+// Registro de um caso da suíte.
+typedef struct
+{
+    char name[96];   // Identificador único, usado na comparação com o baseline
+    char method[32];
+    double param;    // h (passo constante) ou tol (adaptativo)
+    double theta0;
+    int periods;
+    long steps;
+    long rhs_evals;
+    bench_timing timing;
+} bench_record;
+
+void bench_json_begin(FILE *fp, const char *suite);
+void bench_json_record(FILE *fp, const bench_record *rec, int last);
+void bench_json_end(FILE *fp);
+
+/**
+ * @brief Procura o registro name num arquivo JSON gravado por bench_json_*.
+ * @param median_ns_out Mediana do baseline, em ns por chamada.
+ * @param steps_out Passos aceitos do baseline.
+ * @param rhs_evals_out Avaliações de f do baseline.
+ * @return 1 se o registro foi encontrado, 0 caso contrário.
+ */
+int bench_baseline_lookup(FILE *fp, const char *name, double *median_ns_out, long *steps_out, long *rhs_evals_out);
+
+#endif
@@ -0,0 +1,106 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "chain.h"
+#include "vecmath.h"
+
+static chain_params params = {2, 1.0, 1.0, 0};
+
+int chain_set_params(const chain_params *p)
+{
+    if (p->n_sites < 2)
+        return 0;
+    params = *p;
+    return 1;
+}
+
+const chain_params *chain_get_params(void)
+{
+    return &params;
+}
+
+// Vizinhos de i, com a condição de contorno da cadeia.
+static inline double left_of(const double th[], int i, int n, int periodic)
+{
+    if (i > 0)
+        return th[i - 1];
+    return periodic ? th[n - 1] : th[0];
+}
+
+static inline double right_of(const double th[], int i, int n, int periodic)
+{
+    if (i < n - 1)
+        return th[i + 1];
+    return periodic ? th[0] : th[n - 1];
+}
+
+void f_chain_range(double t, const double y[], double dydt[], int begin, int end, void *ctx)
+{
+    const chain_params *p = ctx ? (const chain_params *)ctx : &params;
+    const int n = p->n_sites;
+    const int periodic = p->periodic;
+    const double k = p->coupling;
+    const double w2 = p->omega0_sq;
+    const double *restrict th = y;
+    const double *restrict om = y + n;
+    double *restrict dth = dydt;
+    double *restrict dom = dydt + n;
+    int lo = begin > 1 ? begin : 1;
+    int hi = end < n - 1 ? end : n - 1;
+
+    // Faixa vazia (mais threads que blocos de unidades): o sítio 0 é de outra thread
+    if (begin >= end)
+        return;
+
+    // Extremidades fora do laço vetorizado, para que ele não tenha desvios
+    if (begin == 0)
+    {
+        dth[0] = om[0];
+        dom[0] = k * (right_of(th, 0, n, periodic) - 2.0 * th[0] + left_of(th, 0, n, periodic)) - w2 * vm_sin(th[0]);
+    }
+    if (end == n)
+    {
+        dth[n - 1] = om[n - 1];
+        dom[n - 1] = k * (right_of(th, n - 1, n, periodic) - 2.0 * th[n - 1] + left_of(th, n - 1, n, periodic))
+                     - w2 * vm_sin(th[n - 1]);
+    }
+
+    // Uma única passada por y: cada sítio é lido e escrito uma vez, sem temporários
+    #pragma omp simd
+    for (int i = lo; i < hi; ++i)
+    {
+        dth[i] = om[i];
+        dom[i] = k * (th[i + 1] - 2.0 * th[i] + th[i - 1]) - w2 * vm_sin(th[i]);
+    }
+}
+
+void f_chain(double t, double y[], double dydt[])
+{
+    f_chain_range(t, y, dydt, 0, params.n_sites, NULL);
+}
+
+void f_chain_reference(double t, double y[], double dydt[])
+{
+    const int n = params.n_sites;
+    for (int i = 0; i < n; ++i)
+    {
+        double lap = right_of(y, i, n, params.periodic) - 2.0 * y[i] + left_of(y, i, n, params.periodic);
+        dydt[i] = y[n + i];
+        dydt[n + i] = params.coupling * lap - params.omega0_sq * sin(y[i]);
+    }
+}
+
+double chain_energy(const double y[])
+{
+    const int n = params.n_sites;
+    const int bonds = params.periodic ? n : n - 1;
+    double e = 0.0;
+    for (int i = 0; i < n; ++i)
+        e += 0.5 * y[n + i] * y[n + i] + params.omega0_sq * (1.0 - cos(y[i]));
+    for (int i = 0; i < bonds; ++i)
+    {
+        double d = right_of(y, i, n, params.periodic) - y[i];
+        e += 0.5 * params.coupling * d * d;
+    }
+    return e;
+}
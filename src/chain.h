@@ -0,0 +1,55 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+/*
+ * Cadeia de pêndulos acoplados (modelo de Frenkel-Kontorova / sine-Gordon discreto):
+ *   theta_i'' = k (theta_{i+1} - 2 theta_i + theta_{i-1}) - w0^2 sin(theta_i)
+ *
+ * O estado usa structure-of-arrays, como o integrador em lote:
+ *   y = [theta_0, ..., theta_{N-1}, omega_0, ..., omega_{N-1}]  (n_eq = 2N)
+ * e f_chain tem a assinatura das derivadas de rk.h, então a cadeia pode ser integrada
+ * diretamente com RungeKutta_system_adaptive_h (ou a versão _ws, recomendada para N grande).
+ *
+ * Como a assinatura de f não carrega contexto, os parâmetros de f_chain são globais e definidos
+ * com chain_set_params antes da integração (não alterar durante integrações concorrentes).
+ * No caminho de rk_par, f_chain_range recebe os parâmetros pelo ctx e não depende do global.
+ */
+
+typedef struct
+{
+    int n_sites;      // N
+    double coupling;  // k: constante de acoplamento entre vizinhos
+    double omega0_sq; // w0^2 = g/L de cada pêndulo
+    int periodic;     // 1: anel (theta_N = theta_0); 0: extremidades livres
+} chain_params;
+
+/**
+ * @brief Define os parâmetros usados por f_chain e chain_energy.
+ * @return 1 em caso de sucesso, 0 se os parâmetros forem inválidos (N < 2).
+ */
+int chain_set_params(const chain_params *params);
+const chain_params *chain_get_params(void);
+
+/**
+ * @brief Derivadas da cadeia (vetorizada com vm_sin).
+ */
+void f_chain(double t, double y[], double dydt[]);
+
+/**
+ * @brief Derivadas só dos sítios [begin, end) (theta e omega), lendo qualquer posição de y.
+ *        Tem a assinatura rk_par_rhs (unidade = sítio, 2 campos).
+ * @param ctx const chain_params * da cadeia; NULL usa os de chain_set_params.
+ */
+void f_chain_range(double t, const double y[], double dydt[], int begin, int end, void *ctx);
+
+/**
+ * @brief Mesma derivada, escalar e com a sin da libm (referência para validação e medidas).
+ */
+void f_chain_reference(double t, double y[], double dydt[]);
+
+/**
+ * @brief Energia total: sum omega_i^2/2 + w0^2 (1 - cos theta_i) + k/2 (theta_{i+1} - theta_i)^2.
+ */
+double chain_energy(const double y[]);
+
+#endif
@@ -0,0 +1,189 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driven.h"
+#include "pendulo.h"
+#include "rk.h"
+
+static _Thread_local driven_params params = DRIVEN_PARAMS_DEFAULT;
+
+int driven_set_params(const driven_params *p)
+{
+    if (!(p->omega_d > 0.0) || p->gamma < 0.0)
+        return 0;
+    params = *p;
+    return 1;
+}
+
+const driven_params *driven_get_params(void)
+{
+    return &params;
+}
+
+void f_driven(double t, double y[], double dydt[])
+{
+    dydt[0] = y[1];
+    dydt[1] = -params.gamma * y[1] - params.omega0_sq * vm_sin_acc(pendulo_sin_acc, y[0]) +
+              params.amplitude * cos(params.omega_d * t);
+}
+
+// Ângulo reduzido a [-pi, pi).
+static double wrap_angle(double theta)
+{
+    double r = fmod(theta + M_PI, 2.0 * M_PI);
+    if (r < 0.0)
+        r += 2.0 * M_PI;
+    return r - M_PI;
+}
+
+long driven_poincare(const double y0[], double tol, int transient_periods, int samples,
+                     float theta_out[], float omega_out[], rk_stats *stats)
+{
+    const double T_d = 2.0 * M_PI / params.omega_d;
+    double y[2] = { y0[0], y0[1] };
+    double h = 0.0; // O primeiro período estima o passo inicial
+    long steps = 0;
+    rk_stats period_stats;
+
+    if (stats)
+        rk_stats_reset(stats);
+
+    for (int k = 0; k < transient_periods + samples; ++k)
+    {
+        // t_k = k T_d calculado a cada período, sem acumular arredondamento
+        int n = RungeKutta_system_adaptive_h(k * T_d, (k + 1) * T_d, y, N_EQ, f_driven, tol, h, NULL, y,
+                                             stats ? &period_stats : NULL);
+        if (stats)
+            rk_stats_merge(stats, &period_stats);
+        steps += n;
+        // O próximo período começa com o passo médio deste (o controlador recomeça a cada chamada)
+        h = n > 0 ? T_d / n : 0.0;
+
+        if (k >= transient_periods)
+        {
+            theta_out[k - transient_periods] = (float)wrap_angle(y[0]);
+            omega_out[k - transient_periods] = (float)y[1];
+        }
+    }
+    return steps;
+}
+
+double driven_grid_amplitude(const driven_sweep_config *cfg, int i)
+{
+    return cfg->n_amp > 1 ? cfg->amp_min + (cfg->amp_max - cfg->amp_min) * i / (double)(cfg->n_amp - 1)
+                          : cfg->amp_min;
+}
+
+double driven_grid_frequency(const driven_sweep_config *cfg, int j)
+{
+    return cfg->n_freq > 1 ? cfg->freq_min + (cfg->freq_max - cfg->freq_min) * j / (double)(cfg->n_freq - 1)
+                           : cfg->freq_min;
+}
+
+typedef struct
+{
+    driven_bifurcation *bif;
+    int n_cells;
+    long *steps;     // [n_tasks]
+    long *rhs_evals; // [n_tasks]
+} sweep_jobs;
+
+static void sweep_task(void *arg, int index)
+{
+    sweep_jobs *jobs = (sweep_jobs *)arg;
+    driven_bifurcation *bif = jobs->bif;
+    const driven_sweep_config *cfg = &bif->cfg;
+    int first = index * DRIVEN_CELLS_PER_TASK;
+    int last = first + DRIVEN_CELLS_PER_TASK < jobs->n_cells ? first + DRIVEN_CELLS_PER_TASK : jobs->n_cells;
+    double y0[2] = { cfg->theta0, cfg->omega0 };
+    long steps = 0, evals = 0;
+
+    for (int cell = first; cell < last; ++cell)
+    {
+        driven_params p = { cfg->gamma, cfg->omega0_sq, driven_grid_amplitude(cfg, cell / cfg->n_freq),
+                            driven_grid_frequency(cfg, cell % cfg->n_freq) };
+        rk_stats stats;
+        driven_set_params(&p);
+        size_t offset = (size_t)cell * cfg->samples;
+        steps += driven_poincare(y0, cfg->tol, cfg->transient_periods, cfg->samples, bif->theta + offset,
+                                 bif->omega + offset, RK_STATS_ENABLED ? &stats : NULL);
+        if (RK_STATS_ENABLED)
+            evals += stats.rhs_evals;
+    }
+    jobs->steps[index] = steps;
+    jobs->rhs_evals[index] = evals;
+}
+
+driven_bifurcation *driven_sweep(sched_pool *pool, const driven_sweep_config *cfg)
+{
+    if (cfg->n_amp < 1 || cfg->n_freq < 1 || cfg->samples < 1 || cfg->transient_periods < 0 ||
+        !(cfg->tol > 0.0) || !(cfg->freq_min > 0.0) || !(cfg->freq_max > 0.0) || cfg->gamma < 0.0)
+        return NULL;
+
+    int n_cells = cfg->n_amp * cfg->n_freq;
+    int n_tasks = (n_cells + DRIVEN_CELLS_PER_TASK - 1) / DRIVEN_CELLS_PER_TASK;
+    size_t n_samples = (size_t)n_cells * cfg->samples;
+    driven_bifurcation *bif = calloc(1, sizeof(driven_bifurcation));
+    long *counters = malloc(2 * n_tasks * sizeof(long));
+    if (!bif || !counters)
+    {
+        free(bif);
+        free(counters);
+        return NULL;
+    }
+    bif->cfg = *cfg;
+    bif->theta = malloc(n_samples * sizeof(float));
+    bif->omega = malloc(n_samples * sizeof(float));
+    if (!bif->theta || !bif->omega)
+    {
+        driven_bifurcation_free(bif);
+        free(counters);
+        return NULL;
+    }
+
+    sweep_jobs jobs = { bif, n_cells, counters, counters + n_tasks };
+    sched_parallel_for(pool, n_tasks, sweep_task, &jobs);
+    for (int t = 0; t < n_tasks; ++t)
+    {
+        bif->steps += jobs.steps[t];
+        bif->rhs_evals += jobs.rhs_evals[t];
+    }
+    free(counters);
+    return bif;
+}
+
+void driven_bifurcation_free(driven_bifurcation *bif)
+{
+    if (!bif)
+        return;
+    free(bif->theta);
+    free(bif->omega);
+    free(bif);
+}
+
+int driven_bifurcation_write(const driven_bifurcation *bif, const char *path)
+{
+    const driven_sweep_config *cfg = &bif->cfg;
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return 0;
+
+    char magic[8] = DRIVEN_BIF_MAGIC;
+    uint32_t header[6] = { DRIVEN_BIF_VERSION, (uint32_t)cfg->n_amp, (uint32_t)cfg->n_freq,
+                           (uint32_t)cfg->samples, (uint32_t)cfg->transient_periods, 0 };
+    double values[7] = { cfg->gamma, cfg->omega0_sq, cfg->amp_min, cfg->amp_max,
+                         cfg->freq_min, cfg->freq_max, cfg->tol };
+    size_t n_samples = (size_t)cfg->n_amp * cfg->n_freq * cfg->samples;
+
+    int ok = fwrite(magic, 1, 8, fp) == 8 &&
+             fwrite(header, sizeof(uint32_t), 6, fp) == 6 &&
+             fwrite(values, sizeof(double), 7, fp) == 7 &&
+             fwrite(bif->theta, sizeof(float), n_samples, fp) == n_samples &&
+             fwrite(bif->omega, sizeof(float), n_samples, fp) == n_samples;
+    if (fclose(fp) != 0)
+        ok = 0;
+    return ok;
+}
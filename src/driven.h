@@ -0,0 +1,120 @@
+#ifndef DRIVEN_H
+#define DRIVEN_H
+
+#include "rk_stats.h"
+#include "scheduler.h"
+
+/*
+ * Pêndulo amortecido e forçado:
+ *   theta'' = -gamma theta' - w0^2 sin(theta) + A cos(w_d t)
+ * com y = [theta, omega] e a assinatura das derivadas de rk.h (f_driven).
+ *
+ * Como f não recebe contexto, os parâmetros ficam numa variável por thread
+ * (driven_set_params vale só para a thread que chama). Assim cada tarefa de uma varredura
+ * integra o seu ponto da grade sem interferir nas outras.
+ *
+ * A seção de Poincaré é estroboscópica: o estado é amostrado a cada período do forçamento,
+ * T_d = 2 pi / w_d, nos instantes t_k = k T_d (cada período é uma chamada de
+ * RungeKutta_system_adaptive_h que termina exatamente em t_k).
+ */
+
+typedef struct
+{
+    double gamma;     // Amortecimento
+    double omega0_sq; // w0^2 (G/L para o pêndulo de pendulo.h)
+    double amplitude; // A
+    double omega_d;   // Frequência do forçamento
+} driven_params;
+
+// Parâmetros iniciais de cada thread (regime caótico clássico de Baker e Gollub).
+#define DRIVEN_PARAMS_DEFAULT {0.5, 1.0, 1.15, 2.0 / 3.0}
+
+/**
+ * @brief Define os parâmetros de f_driven para a thread atual.
+ * @return 1 em caso de sucesso, 0 se os parâmetros forem inválidos (w_d <= 0 ou gamma < 0).
+ */
+int driven_set_params(const driven_params *params);
+const driven_params *driven_get_params(void);
+
+void f_driven(double t, double y[], double dydt[]);
+
+/**
+ * @brief Seção de Poincaré de um ponto da grade, com os parâmetros da thread atual.
+ *        Os transient_periods primeiros períodos são integrados sem guardar nada.
+ * @param y0 Estado inicial (theta, omega) em t = 0.
+ * @param theta_out Ângulo em cada amostra, reduzido a [-pi, pi) (samples valores).
+ * @param omega_out Velocidade em cada amostra (samples valores).
+ * @param stats Estatísticas acumuladas de todos os períodos (pode ser NULL).
+ * @return Número de passos aceitos.
+ */
+long driven_poincare(const double y0[], double tol, int transient_periods, int samples,
+                     float theta_out[], float omega_out[], rk_stats *stats);
+
+// Varredura de uma grade (amplitude x frequência) com amortecimento e w0 fixos.
+typedef struct
+{
+    double gamma;
+    double omega0_sq;
+    double amp_min, amp_max;
+    int n_amp;
+    double freq_min, freq_max;
+    int n_freq;
+    double theta0, omega0; // Condição inicial, a mesma em todos os pontos
+    int transient_periods; // Períodos descartados antes da primeira amostra
+    int samples;           // Amostras de Poincaré por ponto
+    double tol;
+} driven_sweep_config;
+
+/*
+ * Resultado da varredura: amostras em float32 (8 bytes por amostra), contíguas por ponto
+ * da grade, com o ponto (i, j) = (amplitude i, frequência j) no índice i * n_freq + j.
+ */
+typedef struct
+{
+    driven_sweep_config cfg;
+    float *theta; // [n_amp * n_freq * samples]
+    float *omega;
+    long steps;
+    long rhs_evals;
+} driven_bifurcation;
+
+// Pontos da grade por tarefa do escalonador.
+#define DRIVEN_CELLS_PER_TASK 4
+
+// Amplitude e frequência do ponto i (ou j) da grade.
+double driven_grid_amplitude(const driven_sweep_config *cfg, int i);
+double driven_grid_frequency(const driven_sweep_config *cfg, int j);
+
+/**
+ * @brief Integra todos os pontos da grade em paralelo no pool.
+ * @return O resultado, ou NULL em caso de falha (configuração inválida ou sem memória).
+ */
+driven_bifurcation *driven_sweep(sched_pool *pool, const driven_sweep_config *cfg);
+void driven_bifurcation_free(driven_bifurcation *bif);
+
+/*
+ * Formato binário do diagrama de bifurcação (little-endian):
+ *   0  char[8]   magic "PENDBIF\0"
+ *   8  uint32    versão (DRIVEN_BIF_VERSION)
+ *   12 uint32    n_amp
+ *   16 uint32    n_freq
+ *   20 uint32    samples
+ *   24 uint32    transient_periods
+ *   28 uint32    (zero)
+ *   32 float64   gamma, omega0_sq, amp_min, amp_max, freq_min, freq_max, tol
+ *   88 float32   theta[n_amp][n_freq][samples], depois omega com a mesma forma
+ *
+ * Leitura em Python:
+ *   hdr = np.fromfile(path, dtype='<u4', count=7); n_amp, n_freq, s = hdr[3], hdr[4], hdr[5]
+ *   theta = np.fromfile(path, dtype='<f4', offset=88, count=n_amp*n_freq*s).reshape(n_amp, n_freq, s)
+ */
+#define DRIVEN_BIF_MAGIC "PENDBIF"
+#define DRIVEN_BIF_VERSION 1
+
+/**
+ * @brief Grava o diagrama de bifurcação em path, no formato acima.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int driven_bifurcation_write(const driven_bifurcation *bif, const char *path);
+
+#endif
@@ -0,0 +1,513 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ensemble.h"
+#include "pendulo.h"
+#include "rk.h"
+
+#define ENS_ALIGN __attribute__((aligned(64)))
+
+// Derivada em lote: f_pendulo_batch, ou f_pendulo_batch_exact para repetir o caminho escalar.
+typedef void (*ens_rhs)(int n, const double theta[], const double omega[],
+                        double dtheta[], double domega[]);
+
+/**
+ * @brief Passo RK4 para no máximo ENS_BLOCK pêndulos.
+ *        As operações seguem a mesma ordem de rk4_single_step_system, então
+ *        o resultado difere do caminho escalar apenas pelo seno de rhs.
+ */
+static void rk4_block(ens_rhs rhs, double h, int n,
+                      const double th_in[], const double om_in[],
+                      double th_out[], double om_out[])
+{
+    double k1t[ENS_BLOCK] ENS_ALIGN, k1w[ENS_BLOCK] ENS_ALIGN;
+    double k2t[ENS_BLOCK] ENS_ALIGN, k2w[ENS_BLOCK] ENS_ALIGN;
+    double k3t[ENS_BLOCK] ENS_ALIGN, k3w[ENS_BLOCK] ENS_ALIGN;
+    double k4t[ENS_BLOCK] ENS_ALIGN, k4w[ENS_BLOCK] ENS_ALIGN;
+    double yt[ENS_BLOCK] ENS_ALIGN, yw[ENS_BLOCK] ENS_ALIGN;
+    int i;
+
+    // k1 = f(y_in)
+    rhs(n, th_in, om_in, k1t, k1w);
+
+    // k2 = f(y_in + h/2 * k1)
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        yt[i] = th_in[i] + (h / 2.0) * k1t[i];
+        yw[i] = om_in[i] + (h / 2.0) * k1w[i];
+    }
+    rhs(n, yt, yw, k2t, k2w);
+
+    // k3 = f(y_in + h/2 * k2)
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        yt[i] = th_in[i] + (h / 2.0) * k2t[i];
+        yw[i] = om_in[i] + (h / 2.0) * k2w[i];
+    }
+    rhs(n, yt, yw, k3t, k3w);
+
+    // k4 = f(y_in + h * k3)
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        yt[i] = th_in[i] + h * k3t[i];
+        yw[i] = om_in[i] + h * k3w[i];
+    }
+    rhs(n, yt, yw, k4t, k4w);
+
+    // Combinar para o resultado final
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        th_out[i] = th_in[i] + (h / 6.0) * (k1t[i] + 2.0 * k2t[i] + 2.0 * k3t[i] + k4t[i]);
+        om_out[i] = om_in[i] + (h / 6.0) * (k1w[i] + 2.0 * k2w[i] + 2.0 * k3w[i] + k4w[i]);
+    }
+}
+
+void rk4_ensemble_step(double h, int n,
+                       const double theta_in[], const double omega_in[],
+                       double theta_out[], double omega_out[])
+{
+    for (int b = 0; b < n; b += ENS_BLOCK)
+    {
+        int m = (n - b < ENS_BLOCK) ? n - b : ENS_BLOCK;
+        rk4_block(f_pendulo_batch, h, m, theta_in + b, omega_in + b, theta_out + b, omega_out + b);
+    }
+}
+
+// Estatísticas do pêndulo job: as do run, se houver, ou as de stats_out (NULL: sem coleta).
+static rk_stats *job_stats(rk_stats stats_out[], pendulo_period_run runs[], int job)
+{
+    if (runs)
+        return &runs[job].stats;
+    return stats_out ? &stats_out[job] : NULL;
+}
+
+/**
+ * @brief Núcleo de detect_period_constant_batch e de detect_period_constant_batch_runs. Com
+ *        runs, cada cruzamento e o checkpoint no fim do último passo são gravados no run.
+ * @return 1 em caso de sucesso, 0 em caso de falha (sem memória para os cruzamentos).
+ */
+static int constant_batch_core(ens_rhs rhs, const double theta0[], int n, double h, int num_periods,
+                               double periods_out[], int steps_out[], rk_stats stats_out[],
+                               pendulo_period_run runs[])
+{
+    if (n <= 0 || h <= 0.0 || num_periods <= 0)
+        return 0;
+
+    const int target = 2 * num_periods;
+    int ok = 1;
+
+    if (stats_out && !runs)
+    {
+        for (int j = 0; j < n; ++j)
+            rk_stats_reset(&stats_out[j]);
+    }
+
+    for (int b = 0; b < n; b += ENS_BLOCK)
+    {
+        int m = (n - b < ENS_BLOCK) ? n - b : ENS_BLOCK;
+        double bufs[4][ENS_BLOCK] ENS_ALIGN;
+        double *th = bufs[0], *om = bufs[1];
+        double *th_next = bufs[2], *om_next = bufs[3];
+        double prev_omega[ENS_BLOCK], total_time[ENS_BLOCK];
+        int zero_crossings[ENS_BLOCK], steps[ENS_BLOCK];
+        int i;
+
+        for (i = 0; i < m; ++i)
+        {
+            th[i] = theta0[b + i];
+            om[i] = 0.0;
+            prev_omega[i] = 0.0;
+            total_time[i] = 0.0;
+            zero_crossings[i] = 0;
+            steps[i] = 0;
+        }
+
+        // Todos os pêndulos do bloco compartilham t, então o tempo é acumulado
+        // exatamente como em detect_period_constant.
+        double t = 0.0;
+        int step = 0;
+        int remaining = m;
+
+        while (remaining > 0)
+        {
+            rk4_block(rhs, h, m, th, om, th_next, om_next);
+            step++;
+            double curr_t = t + h;
+
+            // Detecção de cruzamento por zero de omega, independente em cada pêndulo
+            for (i = 0; i < m; ++i)
+            {
+                if (zero_crossings[i] >= target)
+                    continue;
+
+                rk_stats *st = job_stats(stats_out, runs, b + i);
+                (void)st;
+                RK_STATS_EVALS(st, 4);
+                RK_STATS_ACCEPT(st, h);
+
+                double curr_omega = om_next[i];
+                if (prev_omega[i] * curr_omega <= 0 && t > 0)
+                {
+                    // Todo cruzamento é localizado, como no caminho escalar
+                    double y_prev[2] = { th[i], om[i] };
+                    double y_curr[2] = { th_next[i], om_next[i] };
+                    double t_cross = pendulo_crossing_time(t, y_prev, curr_t, y_curr);
+                    RK_STATS_EVALS(st, PENDULO_CROSSING_EVALS);
+                    zero_crossings[i]++;
+                    if (runs && !pendulo_period_run_add_crossing(&runs[b + i], t_cross, step, st))
+                        ok = 0;
+                    if (zero_crossings[i] == target)
+                    {
+                        total_time[i] = t_cross;
+                        steps[i] = step;
+                        remaining--;
+                        if (runs)
+                        { // Checkpoint: o estado no fim do passo do último cruzamento
+                            pendulo_period_run *run = &runs[b + i];
+                            run->t = curr_t;
+                            run->y[0] = th_next[i];
+                            run->y[1] = om_next[i];
+                            run->steps = step;
+                            run->started = 1;
+                        }
+                    }
+                }
+                prev_omega[i] = curr_omega;
+            }
+
+            t = curr_t;
+            double *tmp;
+            tmp = th; th = th_next; th_next = tmp;
+            tmp = om; om = om_next; om_next = tmp;
+        }
+
+        for (i = 0; i < m; ++i)
+        {
+            if (periods_out)
+                periods_out[b + i] = (2.0 * total_time[i]) / (double)target;
+            if (steps_out)
+                steps_out[b + i] = steps[i];
+        }
+    }
+    return ok;
+}
+
+int detect_period_constant_batch(const double theta0[], int n, double h, int num_periods,
+                                 double periods_out[], int steps_out[], rk_stats stats_out[])
+{
+    return constant_batch_core(f_pendulo_batch, theta0, n, h, num_periods, periods_out, steps_out,
+                               stats_out, NULL);
+}
+
+int detect_period_constant_batch_runs(pendulo_period_run runs[], int n, double h, int num_periods)
+{
+    double theta0[ENS_BLOCK];
+    if (n <= 0)
+        return 0;
+    for (int b = 0; b < n; b += ENS_BLOCK)
+    {
+        int m = (n - b < ENS_BLOCK) ? n - b : ENS_BLOCK;
+        for (int i = 0; i < m; ++i)
+            theta0[i] = runs[b + i].theta0;
+        if (!constant_batch_core(f_pendulo_batch_exact, theta0, m, h, num_periods, NULL, NULL, NULL, runs + b))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Passo RK4 em que cada pêndulo usa seu próprio h[i] (n <= ENS_LANES).
+ */
+static void rk4_lanes(ens_rhs rhs, const double h[], int n,
+                      const double th_in[], const double om_in[],
+                      double th_out[], double om_out[])
+{
+    double k1t[ENS_LANES] ENS_ALIGN, k1w[ENS_LANES] ENS_ALIGN;
+    double k2t[ENS_LANES] ENS_ALIGN, k2w[ENS_LANES] ENS_ALIGN;
+    double k3t[ENS_LANES] ENS_ALIGN, k3w[ENS_LANES] ENS_ALIGN;
+    double k4t[ENS_LANES] ENS_ALIGN, k4w[ENS_LANES] ENS_ALIGN;
+    double yt[ENS_LANES] ENS_ALIGN, yw[ENS_LANES] ENS_ALIGN;
+    int i;
+
+    rhs(n, th_in, om_in, k1t, k1w);
+
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        yt[i] = th_in[i] + (h[i] / 2.0) * k1t[i];
+        yw[i] = om_in[i] + (h[i] / 2.0) * k1w[i];
+    }
+    rhs(n, yt, yw, k2t, k2w);
+
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        yt[i] = th_in[i] + (h[i] / 2.0) * k2t[i];
+        yw[i] = om_in[i] + (h[i] / 2.0) * k2w[i];
+    }
+    rhs(n, yt, yw, k3t, k3w);
+
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        yt[i] = th_in[i] + h[i] * k3t[i];
+        yw[i] = om_in[i] + h[i] * k3w[i];
+    }
+    rhs(n, yt, yw, k4t, k4w);
+
+    #pragma omp simd
+    for (i = 0; i < n; ++i)
+    {
+        th_out[i] = th_in[i] + (h[i] / 6.0) * (k1t[i] + 2.0 * k2t[i] + 2.0 * k3t[i] + k4t[i]);
+        om_out[i] = om_in[i] + (h[i] / 6.0) * (k1w[i] + 2.0 * k2w[i] + 2.0 * k3w[i] + k4w[i]);
+    }
+}
+
+// Estado de uma lane do integrador adaptativo em lote (structure-of-arrays).
+typedef struct
+{
+    double th[ENS_LANES] ENS_ALIGN;
+    double om[ENS_LANES] ENS_ALIGN;
+    double t[ENS_LANES];
+    double h[ENS_LANES];
+    double prev_omega[ENS_LANES];
+    double prev_t[ENS_LANES];
+    int zero_crossings[ENS_LANES];
+    int steps[ENS_LANES];
+    int job[ENS_LANES];
+    rk_control_state ctl[ENS_LANES];
+} ens_lanes;
+
+static void lane_load(ens_lanes *s, int lane, int job, double theta0, double h_initial)
+{
+    s->th[lane] = theta0;
+    s->om[lane] = 0.0;
+    s->t[lane] = 0.0;
+    s->h[lane] = h_initial;
+    s->prev_omega[lane] = 0.0;
+    s->prev_t[lane] = 0.0;
+    s->zero_crossings[lane] = 0;
+    s->steps[lane] = 0;
+    s->job[lane] = job;
+    rk_control_state_reset(&s->ctl[lane]);
+}
+
+static void lane_move(ens_lanes *s, int dst, int src)
+{
+    s->th[dst] = s->th[src];
+    s->om[dst] = s->om[src];
+    s->t[dst] = s->t[src];
+    s->h[dst] = s->h[src];
+    s->prev_omega[dst] = s->prev_omega[src];
+    s->prev_t[dst] = s->prev_t[src];
+    s->zero_crossings[dst] = s->zero_crossings[src];
+    s->steps[dst] = s->steps[src];
+    s->job[dst] = s->job[src];
+    s->ctl[dst] = s->ctl[src];
+}
+
+// Passo inicial de uma lane: h_initial, ou a estimativa de rk_initial_step se h_initial <= 0.
+static double lane_initial_step(double theta0, double tol, double h_initial, double h_max, rk_stats *st)
+{
+    if (h_initial > 0.0)
+        return h_initial;
+    double y0[2] = { theta0, 0.0 };
+    (void)st;
+    RK_STATS_EVALS(st, RK_INITIAL_STEP_EVALS);
+    return rk_initial_step(0.0, y0, N_EQ, f_pendulo, tol, 4, h_max);
+}
+
+/**
+ * @brief Núcleo de detect_period_adaptive_batch e de detect_period_adaptive_batch_runs (ver
+ *        constant_batch_core).
+ */
+static int adaptive_batch_core(ens_rhs rhs, const double theta0[], int n, double tol, double h_initial,
+                               int num_periods, double T_num_out[], int steps_out[],
+                               double *utilization_out, rk_stats stats_out[], pendulo_period_run runs[])
+{
+    if (n <= 0 || tol <= 0.0 || num_periods <= 0)
+        return 0;
+
+    const int target = 2 * num_periods;
+    const double h_max = analytic_period() / 4.0;
+    const double h_min = rk_default_h_min(tol, h_max);
+    const double safety_factor = 0.9;
+    const int pi_control = rk_get_error_control()->mode == RK_CONTROL_PI;
+    int ok = 1;
+
+    if (stats_out && !runs)
+    {
+        for (int j = 0; j < n; ++j)
+            rk_stats_reset(&stats_out[j]);
+    }
+
+    ens_lanes s;
+    double y1t[ENS_LANES] ENS_ALIGN, y1w[ENS_LANES] ENS_ALIGN;
+    double ymt[ENS_LANES] ENS_ALIGN, ymw[ENS_LANES] ENS_ALIGN;
+    double y2t[ENS_LANES] ENS_ALIGN, y2w[ENS_LANES] ENS_ALIGN;
+    double h_half[ENS_LANES] ENS_ALIGN;
+
+    int next_job = 0;
+    int active = 0;
+    while (active < ENS_LANES && next_job < n)
+    {
+        lane_load(&s, active, next_job, theta0[next_job],
+                  lane_initial_step(theta0[next_job], tol, h_initial, h_max,
+                                    job_stats(stats_out, runs, next_job)));
+        active++;
+        next_job++;
+    }
+
+    long long iterations = 0, busy_lanes = 0;
+
+    while (active > 0)
+    {
+        iterations++;
+        busy_lanes += active;
+
+        // Passo dobrado: um passo h e dois passos h/2, vetorizados sobre as lanes
+        for (int i = 0; i < active; ++i)
+            h_half[i] = s.h[i] / 2.0;
+        rk4_lanes(rhs, s.h, active, s.th, s.om, y1t, y1w);
+        rk4_lanes(rhs, h_half, active, s.th, s.om, ymt, ymw);
+        rk4_lanes(rhs, h_half, active, ymt, ymw, y2t, y2w);
+
+        // Aceitação/rejeição e cruzamentos, lane a lane (mesma lógica de rk_adaptive_one_step)
+        for (int i = 0; i < active; ++i)
+        {
+            double h = s.h[i];
+            double error_estimate = fabs(y2t[i] - y1t[i]) / 15.0;
+            double h_new;
+            double factor = 0.0;
+            int accepted;
+            rk_stats *st = job_stats(stats_out, runs, s.job[i]);
+            (void)st;
+            RK_STATS_EVALS(st, 12); // Três passos RK4 por tentativa
+
+            if (pi_control)
+            {
+                double err[2] = { (y2t[i] - y1t[i]) / 15.0, (y2w[i] - y1w[i]) / 15.0 };
+                double y_old[2] = { s.th[i], s.om[i] }, y_new[2] = { y2t[i], y2w[i] };
+                double error_norm = rk_error_norm(2, err, y_old, y_new, tol);
+                accepted = error_norm <= 1.0 || h <= h_min * 1.0001;
+                factor = rk_control_factor(&s.ctl[i], error_norm, 4, accepted);
+            }
+            else
+            {
+                accepted = error_estimate <= tol || h <= h_min * 1.0001;
+            }
+
+            if (!accepted)
+            { // Passo rejeitado
+                RK_STATS_REJECT(st);
+                h_new = pi_control ? h * factor : h * safety_factor * pow(tol / error_estimate, 0.20);
+                s.h[i] = fmax(h_new, h_min);
+                continue;
+            }
+            RK_STATS_ACCEPT(st, h);
+
+            double t_before_step = s.t[i];
+            double y_prev[2] = { s.th[i], s.om[i] };
+            s.t[i] += h;
+            s.th[i] = y2t[i] + (y2t[i] - y1t[i]) / 15.0;
+            s.om[i] = y2w[i] + (y2w[i] - y1w[i]) / 15.0;
+
+            if (pi_control)
+                h_new = h * factor;
+            else if (error_estimate == 0.0)
+                h_new = h * 2.0;
+            else
+                h_new = h * safety_factor * pow(tol / error_estimate, 0.20);
+            s.h[i] = fmin(fmax(h_new, h_min), h_max);
+            s.steps[i]++;
+
+            double curr_omega = s.om[i];
+            if (s.prev_omega[i] * curr_omega <= 0 && t_before_step > 0)
+            {
+                // Todo cruzamento é localizado, como no caminho escalar
+                int job = s.job[i];
+                double y_curr[2] = { s.th[i], s.om[i] };
+                double t_cross = pendulo_crossing_time(s.prev_t[i], y_prev, s.t[i], y_curr);
+                RK_STATS_EVALS(st, PENDULO_CROSSING_EVALS);
+                s.zero_crossings[i]++;
+                if (runs && !pendulo_period_run_add_crossing(&runs[job], t_cross, s.steps[i], st))
+                    ok = 0;
+                if (s.zero_crossings[i] == target)
+                {
+                    if (T_num_out)
+                        T_num_out[job] = (2.0 * t_cross) / (double)target;
+                    if (steps_out)
+                        steps_out[job] = s.steps[i];
+                    if (runs)
+                    { // Checkpoint: o estado, o próximo h e o controlador no fim deste passo
+                        pendulo_period_run *run = &runs[job];
+                        run->t = s.t[i];
+                        run->y[0] = s.th[i];
+                        run->y[1] = s.om[i];
+                        run->h = s.h[i];
+                        run->ctl = s.ctl[i];
+                        run->steps = s.steps[i];
+                        run->started = 1;
+                    }
+
+                    // Aposenta a lane: recarrega da fila ou compacta trazendo a última lane ativa
+                    if (next_job < n)
+                    {
+                        lane_load(&s, i, next_job, theta0[next_job],
+                                  lane_initial_step(theta0[next_job], tol, h_initial, h_max,
+                                                    job_stats(stats_out, runs, next_job)));
+                        next_job++;
+                    }
+                    else
+                    {
+                        active--;
+                        if (i != active)
+                        {
+                            lane_move(&s, i, active);
+                            y1t[i] = y1t[active]; y1w[i] = y1w[active];
+                            y2t[i] = y2t[active]; y2w[i] = y2w[active];
+                            i--; // reprocessa a lane que veio para esta posição
+                        }
+                    }
+                    continue;
+                }
+            }
+            s.prev_omega[i] = curr_omega;
+            s.prev_t[i] = s.t[i];
+        }
+    }
+
+    if (utilization_out)
+        *utilization_out = iterations ? (double)busy_lanes / ((double)iterations * ENS_LANES) : 0.0;
+    return ok;
+}
+
+int detect_period_adaptive_batch(const double theta0[], int n, double tol, double h_initial,
+                                 int num_periods, double T_num_out[], int steps_out[],
+                                 double *utilization_out, rk_stats stats_out[])
+{
+    return adaptive_batch_core(f_pendulo_batch, theta0, n, tol, h_initial, num_periods, T_num_out,
+                               steps_out, utilization_out, stats_out, NULL);
+}
+
+int detect_period_adaptive_batch_runs(pendulo_period_run runs[], int n, double tol, double h_initial,
+                                      int num_periods)
+{
+    if (n <= 0)
+        return 0;
+    double *theta0 = malloc(n * sizeof(double));
+    if (!theta0)
+        return 0;
+    for (int i = 0; i < n; ++i)
+        theta0[i] = runs[i].theta0;
+    int ok = adaptive_batch_core(f_pendulo_batch_exact, theta0, n, tol, h_initial, num_periods, NULL, NULL,
+                                 NULL, NULL, runs);
+    free(theta0);
+    return ok;
+}
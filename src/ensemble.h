@@ -0,0 +1,92 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "pendulo.h"
+#include "rk_stats.h"
+
+/*
+ * Integração em lote ("ensemble") de muitos pêndulos independentes.
+ * O estado é guardado como structure-of-arrays (theta[], omega[]) para que
+ * cada estágio do RK4 seja um laço contíguo vetorizável (AVX2/AVX-512,
+ * conforme as flags de compilação).
+ *
+ * As derivadas usam f_pendulo_batch, então em VM_ACC_LIBM o seno é o vm_sin e o resultado
+ * difere do caminho escalar (só) pelo seno. As variantes _runs usam f_pendulo_batch_exact:
+ * repetem bit a bit a detecção escalar, com os mesmos passos e avaliações de f, e gravam
+ * os checkpoints de pendulo_period_run (é assim que o cache de períodos preenche as faltas).
+ */
+
+// Número de pêndulos processados por bloco (os temporários cabem na L1).
+#define ENS_BLOCK 256
+
+// Número de trajetórias ativas simultaneamente no integrador adaptativo em lote.
+#define ENS_LANES 16
+
+/**
+ * @brief Avança n pêndulos um passo h do RK4 clássico.
+ * @param h Tamanho do passo (o mesmo para todos).
+ * @param n Número de pêndulos.
+ * @param theta_in Ângulos atuais.
+ * @param omega_in Velocidades angulares atuais.
+ * @param theta_out Ângulos após o passo (pode ser o próprio theta_in).
+ * @param omega_out Velocidades após o passo (pode ser o próprio omega_in).
+ */
+void rk4_ensemble_step(double h, int n,
+                       const double theta_in[], const double omega_in[],
+                       double theta_out[], double omega_out[]);
+
+/**
+ * @brief Equivalente em lote de detect_period_constant: detecta o período de
+ *        n pêndulos com passo constante h, cada um com seu próprio cruzamento de omega.
+ * @param theta0 Vetor com os ângulos iniciais.
+ * @param n Número de ângulos.
+ * @param h Tamanho do passo.
+ * @param num_periods Número de períodos a simular.
+ * @param periods_out Período médio de cada ângulo.
+ * @param steps_out Número de passos usado por cada ângulo (pode ser NULL).
+ * @param stats_out Estatísticas de cada ângulo (pode ser NULL; sem contagem de ciclos).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int detect_period_constant_batch(const double theta0[], int n, double h, int num_periods,
+                                 double periods_out[], int steps_out[], rk_stats stats_out[]);
+
+/**
+ * @brief Começa os runs (recém-iniciados com pendulo_period_run_init) e os avança até
+ *        2 * num_periods cruzamentos com o RK4 de passo h, em lote: o mesmo resultado de
+ *        detect_period_fixed_resume(PENDULO_FIXED_RK4, ...) em cada run.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int detect_period_constant_batch_runs(pendulo_period_run runs[], int n, double h, int num_periods);
+
+/**
+ * @brief Equivalente em lote de detect_period_adaptive com RK_METHOD_RK4_DOUBLING
+ *        (e o mesmo controle de erro, rk_set_error_control).
+ *        Cada lane tem seu próprio t, h, estado de aceitação e contador de cruzamentos.
+ *        Quando uma lane completa 2*num_periods cruzamentos ela é aposentada e
+ *        recarregada com o próximo theta0 da fila, mantendo as lanes ocupadas
+ *        mesmo quando o custo por ângulo varia muito.
+ * @param theta0 Vetor com os ângulos iniciais (fila de trabalho).
+ * @param n Número de ângulos.
+ * @param tol Tolerância de erro.
+ * @param h_initial Tamanho inicial do passo (<= 0: estimado para cada ângulo com rk_initial_step).
+ * @param num_periods Número de períodos a simular.
+ * @param T_num_out Período médio de cada ângulo.
+ * @param steps_out Número de passos aceitos de cada ângulo (pode ser NULL).
+ * @param utilization_out Fração média de lanes ocupadas por iteração (pode ser NULL).
+ * @param stats_out Estatísticas de cada ângulo (pode ser NULL; sem contagem de ciclos).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int detect_period_adaptive_batch(const double theta0[], int n, double tol, double h_initial,
+                                 int num_periods, double T_num_out[], int steps_out[],
+                                 double *utilization_out, rk_stats stats_out[]);
+
+/**
+ * @brief Como detect_period_constant_batch_runs, com o passo dobrado de
+ *        detect_period_adaptive_batch: o mesmo resultado de detect_period_adaptive_resume
+ *        em cada run (RK_METHOD_RK4_DOUBLING, tolerância escalar).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int detect_period_adaptive_batch_runs(pendulo_period_run runs[], int n, double tol, double h_initial,
+                                      int num_periods);
+
+#endif
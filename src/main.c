@@ -1,18 +1,150 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
-#include <time.h>
 #include <string.h>
 
 #include "rk.h"
 #include "pendulo.h"
+#include "ensemble.h"
+#include "scheduler.h"
+#include "bench_harness.h"
+#include "timing.h"
+#include "period_cache.h"
+#include "server.h"
+#include "driven.h"
+#include "shard.h"
+#include "parareal.h"
+
+// Cache de períodos entre execuções (ver period_cache.h)
+#define PERIOD_CACHE_PATH "output/period_cache.bin"
 
 // Protótipos para as novas funções de análise
 void run_comparative_analysis();
 void run_10_period_analysis();
 void find_max_angle_for_error_threshold();
 void generate_plot_data();
+int run_bifurcation_sweep();
+int run_comparative_shard(const shard_spec *spec);
+int merge_comparative_parts(const char *out_path, const char *const paths[], int n_paths);
+int run_parareal_analysis();
+
+// Pool de threads compartilhado pelas análises
+static sched_pool *pool = NULL;
+
+// Formato dos dados de gráfico: binário colunar (padrão) ou CSV (--csv)
+static int plot_csv = 0;
+
+// Gravação dos dados de gráfico CSV numa thread separada (--csv --async, ver sink_async_create).
+// Só vale para o CSV: o binário colunar grava o arquivo todo ao fechar, então não há o que sobrepor.
+static int plot_async = 0;
+#define PLOT_ASYNC_BLOCK_ROWS 4096
+#define PLOT_ASYNC_BLOCKS 4
+
+// Períodos já calculados, nesta execução e nas anteriores (NULL com --no-cache)
+static period_cache *cache = NULL;
+
+int main(int argc, char *argv[]) {
+    int n_threads = 0; // 0 = um por núcleo
+    int use_cache = 1;
+    int server_mode = 0;
+    int bifurcation_mode = 0;
+    int shard_mode = 0;
+    int parareal_mode = 0;
+    shard_spec shard = SHARD_SPEC_ALL;
+    server_config server_cfg = SERVER_CONFIG_DEFAULT;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            n_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            plot_csv = 1;
+        } else if (strcmp(argv[i], "--async") == 0) {
+            plot_async = 1;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strcmp(argv[i], "--server") == 0) {
+            server_mode = 1;
+        } else if (strcmp(argv[i], "--bifurcation") == 0) {
+            bifurcation_mode = 1;
+        } else if (strcmp(argv[i], "--parareal") == 0) {
+            parareal_mode = 1;
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc && shard_parse(argv[i + 1], &shard)) {
+            shard_mode = 1;
+            ++i;
+        } else if (strcmp(argv[i], "--merge") == 0 && i + 2 < argc) {
+            // Junta os parciais dos shards (o resto da linha de comando) sem calcular nada
+            return merge_comparative_parts(argv[i + 1], (const char *const *)&argv[i + 2], argc - i - 2) ? 0 : 1;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            server_cfg.socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "ndjson") == 0 || strcmp(argv[i + 1], "csv") == 0)) {
+            server_cfg.format = strcmp(argv[++i], "csv") == 0 ? SERVER_FORMAT_CSV : SERVER_FORMAT_NDJSON;
+        } else {
+            fprintf(stderr, "Uso: %s [-t num_threads] [--csv [--async]] [--no-cache]\n"
+                            "     %s --server [--socket caminho] [--format ndjson|csv] [-t num_workers] [--no-cache]\n"
+                            "     %s --bifurcation [-t num_threads]\n"
+                            "     %s --parareal [-t num_threads]\n"
+                            "     %s --shard i/n [-t num_threads] [--no-cache]\n"
+                            "     %s --merge saida.csv parcial...\n",
+                    argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (plot_async && !plot_csv) {
+        fprintf(stderr, "--async só vale com --csv (o binário é gravado de uma vez ao fechar)\n");
+        return 1;
+    }
+    if (use_cache) {
+        cache = period_cache_create();
+        if (cache) {
+            period_cache_load(cache, PERIOD_CACHE_PATH);
+        }
+    }
+
+    // Modo servidor: consultas por linha até o fim da entrada (ver server.h), sem as análises
+    if (server_mode) {
+        server_cfg.n_workers = n_threads;
+        server_cfg.cache = cache;
+        int ok = server_run(&server_cfg);
+        if (cache) {
+            period_cache_save(cache, PERIOD_CACHE_PATH);
+            period_cache_destroy(cache);
+        }
+        return ok ? 0 : 1;
+    }
+
+    pool = sched_create(n_threads);
+    if (pool == NULL) {
+        fprintf(stderr, "Erro ao criar o pool de threads\n");
+        return 1;
+    }
+
+    // Diagrama de bifurcação do pêndulo amortecido e forçado, sem as análises
+    if (bifurcation_mode) {
+        int ok = run_bifurcation_sweep();
+        period_cache_destroy(cache);
+        sched_destroy(pool);
+        return ok ? 0 : 1;
+    }
+
+    // Parareal numa trajetória longa, sem as análises
+    if (parareal_mode) {
+        int ok = run_parareal_analysis();
+        period_cache_destroy(cache);
+        sched_destroy(pool);
+        return ok ? 0 : 1;
+    }
+
+    // Um shard da análise comparativa, sem as outras análises (shards.sh junta os parciais)
+    if (shard_mode) {
+        int ok = run_comparative_shard(&shard);
+        if (cache) {
+            period_cache_save(cache, PERIOD_CACHE_PATH);
+            period_cache_destroy(cache);
+        }
+        sched_destroy(pool);
+        return ok ? 0 : 1;
+    }
 
-int main() {
     printf("Executando analise comparativa...\n");
     run_comparative_analysis();
 
@@ -26,64 +158,324 @@ int main() {
     generate_plot_data();
     printf("Arquivos de dados gerados.\n");
 
+    if (cache) {
+        period_cache_counters c;
+        period_cache_get_counters(cache, &c);
+        printf("\nCache de periodos: %ld consultas, %ld respondidas, %ld continuadas, %ld integradas desde t = 0\n",
+               c.queries, c.hits, c.resumes, c.misses);
+        if (!period_cache_save(cache, PERIOD_CACHE_PATH)) {
+            fprintf(stderr, "Aviso: nao foi possivel gravar %s\n", PERIOD_CACHE_PATH);
+        }
+        period_cache_destroy(cache);
+    }
+    sched_destroy(pool);
     return 0;
 }
 
 
-/**
-Fa¸ca um comparativo do valor do per´ıodo calculado e do n´umero de passos, para diferentes
-ˆangulos iniciais θ0:
-*/
-void run_comparative_analysis(void) {
-    FILE *fp = fopen("output/analise_completa.csv", "w");
+/*
+ * Varredura da análise comparativa. O job k calcula o ângulo k % n_thetas com o método
+ * k / n_thetas (0 = adaptativo, j + 1 = passo constante h_vals[j]); com --shard, cada
+ * processo calcula só os seus jobs (ver shard.h) e a junção monta o mesmo CSV.
+ */
+static const double comparative_theta0[] = {0.1, 0.5, 1.0, 2.0, 3.0};
+static const double comparative_h[] = {0.01, 0.001, 0.0001};
 
-    if (fp == NULL) {
-        perror("Erro ao abrir o arquivo de saída");
-        return;
+// Ângulos por tarefa: cada tarefa consulta o cache em lote (as faltas vão para os kernels em lote)
+#define SWEEP_CHUNK ENS_LANES
+
+#define COMPARATIVE_SWEEP "analise_completa"
+#define COMPARATIVE_CSV_PATH "output/analise_completa.csv"
+// Colunas dos arquivos parciais: um registro por job
+#define COMPARATIVE_COLUMNS "period,steps,rejected,rhs_evals"
+#define COMPARATIVE_N_VALUES 4
+
+typedef struct {
+    const double *theta0_vals;
+    int n_thetas;
+    const double *h_vals;
+    int n_h;
+    double tol_adapt;
+    double h0_adapt;
+    shard_spec shard; // Jobs calculados por este processo (ver shard.h)
+    double *T;        // [(n_h + 1) * n_thetas]
+    int *steps;       // [(n_h + 1) * n_thetas]
+    rk_stats *stats;  // [(n_h + 1) * n_thetas]
+} comparative_jobs;
+
+static comparative_jobs comparative_sweep(void) {
+    comparative_jobs jobs = {
+        comparative_theta0, sizeof(comparative_theta0) / sizeof(comparative_theta0[0]),
+        comparative_h, sizeof(comparative_h) / sizeof(comparative_h[0]),
+        1e-7, // Tolerância do adaptativo
+        0.0,  // Passo inicial estimado (rk_initial_step)
+        SHARD_SPEC_ALL, NULL, NULL, NULL
+    };
+    return jobs;
+}
+
+static long comparative_job_count(const comparative_jobs *jobs) {
+    return (long)(jobs->n_h + 1) * jobs->n_thetas;
+}
+
+// Impressão digital de tudo o que muda os resultados: os parciais só se juntam se for igual.
+static uint64_t comparative_config(const comparative_jobs *jobs) {
+    uint64_t hash = SHARD_HASH_INIT;
+    uint64_t build = period_cache_build_id();
+    int32_t acc = pendulo_get_sin_accuracy();
+    const rk_error_control *c = rk_get_error_control();
+    int32_t mode = c->mode;
+    double params[9] = { G, L, jobs->tol_adapt, jobs->h0_adapt,
+                         c->safety, c->fac_min, c->fac_max, c->alpha, c->beta };
+    hash = shard_hash(hash, jobs->theta0_vals, jobs->n_thetas * sizeof(double));
+    hash = shard_hash(hash, jobs->h_vals, jobs->n_h * sizeof(double));
+    hash = shard_hash(hash, params, sizeof(params));
+    hash = shard_hash(hash, &build, sizeof(build));
+    hash = shard_hash(hash, &acc, sizeof(acc));
+    return shard_hash(hash, &mode, sizeof(mode));
+}
+
+static int comparative_alloc(comparative_jobs *jobs) {
+    long n_jobs = comparative_job_count(jobs);
+    jobs->T = calloc(n_jobs, sizeof(double));
+    jobs->steps = calloc(n_jobs, sizeof(int));
+    jobs->stats = calloc(n_jobs, sizeof(rk_stats));
+    return jobs->T && jobs->steps && jobs->stats;
+}
+
+static void comparative_free(comparative_jobs *jobs) {
+    free(jobs->T);
+    free(jobs->steps);
+    free(jobs->stats);
+}
+
+static int comparative_chunks(const comparative_jobs *jobs) {
+    return (jobs->n_thetas + SWEEP_CHUNK - 1) / SWEEP_CHUNK;
+}
+
+// Tarefa: até SWEEP_CHUNK ângulos do shard numa mesma linha (método), consultados juntos no cache.
+static void comparative_task(void *arg, int task) {
+    comparative_jobs *jobs = (comparative_jobs *)arg;
+    int row = task / comparative_chunks(jobs);
+    int first = (task % comparative_chunks(jobs)) * SWEEP_CHUNK;
+    double theta0[SWEEP_CHUNK], T[SWEEP_CHUNK];
+    int steps[SWEEP_CHUNK], index[SWEEP_CHUNK];
+    rk_stats stats[SWEEP_CHUNK];
+    int count = 0;
+
+    // Ângulos first..first + SWEEP_CHUNK - 1 entre os que o shard calcula nesta linha
+    for (int i = 0, owned = 0; i < jobs->n_thetas && count < SWEEP_CHUNK; ++i) {
+        int job = row * jobs->n_thetas + i;
+        if (!shard_owns(&jobs->shard, job) || owned++ < first) continue;
+        theta0[count] = jobs->theta0_vals[i];
+        index[count++] = job;
     }
+    if (count == 0) return;
 
-    // Lista de ângulos iniciais para testar (em radianos)
-    double theta0_vals[] = {0.1, 0.5, 1.0, 2.0, 3.0};
-    int n_thetas = sizeof(theta0_vals) / sizeof(theta0_vals[0]);
+    // Pelo cache: os mesmos ângulos e passos são pedidos de novo pelas outras análises
+    if (row == 0) {
+        period_cache_adaptive_batch(cache, theta0, count, jobs->tol_adapt, jobs->h0_adapt, 1, T, steps, stats);
+    } else {
+        period_cache_fixed_batch(cache, theta0, count, jobs->h_vals[row - 1], 1, T, steps, stats);
+    }
+    for (int k = 0; k < count; ++k) {
+        jobs->T[index[k]] = T[k];
+        jobs->steps[index[k]] = steps[k];
+        jobs->stats[index[k]] = stats[k];
+    }
+}
 
-    // Parâmetros para os métodos numéricos
-    double h_vals[] = {0.01, 0.001, 0.0001};
-    int n_h = sizeof(h_vals) / sizeof(h_vals[0]);
-    double tol_adapt = 1e-7;
-    double h0_adapt = 0.01;
+// Calcula os jobs de jobs->shard no pool, em lotes de até SWEEP_CHUNK ângulos por linha.
+static void comparative_run(comparative_jobs *jobs) {
+    sched_parallel_for(pool, (jobs->n_h + 1) * comparative_chunks(jobs), comparative_task, jobs);
+}
 
-    // Escreve o cabeçalho no arquivo
-    fprintf(fp, "theta0,method,h,period,steps,error_vs_adapt\n");
+// Grava o CSV com todos os jobs já calculados (ou lidos dos parciais), na ordem canônica.
+static int write_comparative_csv(const char *path, const comparative_jobs *jobs) {
+    FILE *fp = fopen(path, "w");
+
+    if (fp == NULL) {
+        perror("Erro ao abrir o arquivo de saída");
+        return 0;
+    }
+
+    // Escreve o cabeçalho no arquivo. "steps" conta só os passos aceitos; o custo real
+    // está em rhs_evals (avaliações de f, incluindo tentativas rejeitadas e a localização
+    // dos cruzamentos). Compilado com STATS=0, rejected e rhs_evals saem zerados.
+    fprintf(fp, "theta0,method,h,period,steps,rejected,rhs_evals,error_vs_exact\n");
 
     double T_analytic = analytic_period();
+    int n = jobs->n_thetas;
 
     // Loop principal sobre cada ângulo inicial
-    for (int i = 0; i < n_thetas; ++i) {
-        double theta0 = theta0_vals[i];
-        double T_adaptive;
-        int steps_adaptive;
+    for (int i = 0; i < n; ++i) {
+        double theta0 = jobs->theta0_vals[i];
+
+        // Referência: período exato pela integral elíptica (sem integração numérica)
+        double T_exact = exact_period(theta0);
+        fprintf(fp, "%.2f,exact,N/A,%.8f,0,0,0,0.0\n", theta0, T_exact);
 
         // 1. Solução Analítica Simplificada
-        fprintf(fp, "%.2f,analytic,N/A,%.8f,0,N/A\n", theta0, T_analytic);
+        fprintf(fp, "%.2f,analytic,N/A,%.8f,0,0,0,%.8f\n", theta0, T_analytic, fabs(T_analytic - T_exact));
 
-        // 2. Solução com Passo Adaptativo (referência de precisão)
-        detect_period_adaptive(theta0, tol_adapt, h0_adapt, 1, &T_adaptive, &steps_adaptive, NULL);
-        fprintf(fp, "%.2f,adaptive,%.1e,%.8f,%d,0.0\n", theta0, tol_adapt, T_adaptive, steps_adaptive);
+        // 2. Solução com Passo Adaptativo
+        fprintf(fp, "%.2f,adaptive,%.1e,%.8f,%d,%ld,%ld,%.8f\n", theta0, jobs->tol_adapt, jobs->T[i], jobs->steps[i],
+                jobs->stats[i].rejected_steps, jobs->stats[i].rhs_evals, fabs(jobs->T[i] - T_exact));
         
         // 3. Soluções com Passo Constante
-        for (int j = 0; j < n_h; ++j) {
-            double h = h_vals[j];
-            int steps_const;
-            double T_const = detect_period_constant(theta0, h, 1, &steps_const, NULL);
-            double error = fabs(T_const - T_adaptive);
-            fprintf(fp, "%.2f,constant,%.4f,%.8f,%d,%.8f\n", theta0, h, T_const, steps_const, error);
+        for (int j = 0; j < jobs->n_h; ++j) {
+            int k = (j + 1) * n + i;
+            double h = jobs->h_vals[j];
+            double error = fabs(jobs->T[k] - T_exact);
+            fprintf(fp, "%.2f,constant,%.4f,%.8f,%d,%ld,%ld,%.8f\n", theta0, h, jobs->T[k], jobs->steps[k],
+                    jobs->stats[k].rejected_steps, jobs->stats[k].rhs_evals, error);
         }
     }
 
-    fclose(fp);
-    printf("Arquivo 'analise_completa.csv' gerado com sucesso.\n");
+    return fclose(fp) == 0;
 }
 
+/**
+Fa¸ca um comparativo do valor do per´ıodo calculado e do n´umero de passos, para diferentes
+ˆangulos iniciais θ0:
+*/
+void run_comparative_analysis(void) {
+    comparative_jobs jobs = comparative_sweep();
+
+    if (!comparative_alloc(&jobs)) {
+        fprintf(stderr, "Erro: sem memoria para a analise comparativa\n");
+        comparative_free(&jobs);
+        return;
+    }
+    comparative_run(&jobs);
+    if (write_comparative_csv(COMPARATIVE_CSV_PATH, &jobs)) {
+        printf("Arquivo 'analise_completa.csv' gerado com sucesso.\n");
+    }
+    comparative_free(&jobs);
+}
+
+/**
+ * @brief Calcula só os jobs de um shard da análise comparativa e grava o arquivo parcial
+ *        (ver shard.h) em output/analise_completa.part-<i>-of-<n>.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int run_comparative_shard(const shard_spec *spec) {
+    comparative_jobs jobs = comparative_sweep();
+    long n_jobs = comparative_job_count(&jobs);
+    char path[256];
+    shard_part part;
+
+    jobs.shard = *spec;
+    snprintf(path, sizeof(path), "output/" COMPARATIVE_SWEEP ".part-%d-of-%d", spec->index, spec->count);
+    if (!comparative_alloc(&jobs) ||
+        !shard_part_open(&part, path, COMPARATIVE_SWEEP, comparative_config(&jobs), spec, n_jobs,
+                         COMPARATIVE_N_VALUES, COMPARATIVE_COLUMNS)) {
+        fprintf(stderr, "Erro ao criar %s\n", path);
+        comparative_free(&jobs);
+        return 0;
+    }
+
+    double t0 = timing_now();
+    comparative_run(&jobs);
+    double elapsed = timing_now() - t0;
+
+    for (long k = 0; k < shard_job_count(spec, n_jobs); ++k) {
+        long job = spec->index + k * spec->count;
+        double values[COMPARATIVE_N_VALUES] = {
+            jobs.T[job], jobs.steps[job], jobs.stats[job].rejected_steps, jobs.stats[job].rhs_evals
+        };
+        shard_part_write(&part, job, values);
+    }
+    int ok = shard_part_close(&part);
+    if (ok) {
+        printf("Shard %d/%d: %ld de %ld jobs em %.3f s -> %s\n", spec->index, spec->count,
+               shard_job_count(spec, n_jobs), n_jobs, elapsed, path);
+    } else {
+        fprintf(stderr, "Erro ao gravar %s\n", path);
+    }
+    comparative_free(&jobs);
+    return ok;
+}
+
+/**
+ * @brief Junta os arquivos parciais dos shards no CSV da análise comparativa, igual ao da
+ *        execução num só processo.
+ * @return 1 em caso de sucesso, 0 se os parciais estiverem incompletos ou forem de outra
+ *         configuração.
+ */
+int merge_comparative_parts(const char *out_path, const char *const paths[], int n_paths) {
+    comparative_jobs jobs = comparative_sweep();
+    long n_jobs = comparative_job_count(&jobs);
+    shard_merged merged;
+
+    if (!shard_merge(paths, n_paths, COMPARATIVE_SWEEP, comparative_config(&jobs), n_jobs,
+                     COMPARATIVE_N_VALUES, &merged)) {
+        return 0;
+    }
+    int ok = comparative_alloc(&jobs);
+    for (long job = 0; ok && job < n_jobs; ++job) {
+        const double *values = merged.values + job * COMPARATIVE_N_VALUES;
+        jobs.T[job] = values[0];
+        jobs.steps[job] = (int)values[1];
+        jobs.stats[job].rejected_steps = (long)values[2];
+        jobs.stats[job].rhs_evals = (long)values[3];
+    }
+    ok = ok && write_comparative_csv(out_path, &jobs);
+    if (ok) {
+        printf("%s: %ld jobs de %d shards\n", out_path, n_jobs, merged.count);
+    }
+    shard_merged_free(&merged);
+    comparative_free(&jobs);
+    return ok;
+}
+
+
+#define TIMING_MAX_JOBS 8
+
+typedef struct {
+    double theta0;
+    const double *h_vals;
+    int n_h;
+    double tol;
+    double h0;
+    int num_periods;
+    int steps[TIMING_MAX_JOBS];
+    bench_timing timing[TIMING_MAX_JOBS];
+    rk_stats stats[TIMING_MAX_JOBS];
+} timing_jobs;
+
+// Uma chamada do detector medida pelo harness (index < n_h: passo constante; n_h: adaptativo).
+typedef struct {
+    timing_jobs *jobs;
+    int index;
+} timing_call;
+
+static void timing_run(void *arg) {
+    timing_call *call = (timing_call *)arg;
+    timing_jobs *jobs = call->jobs;
+    int index = call->index;
+    if (index < jobs->n_h) {
+        detect_period_constant(jobs->theta0, jobs->h_vals[index], jobs->num_periods, &jobs->steps[index], NULL, NULL);
+    } else {
+        double T_adapt;
+        detect_period_adaptive(jobs->theta0, jobs->tol, jobs->h0, jobs->num_periods, &T_adapt, &jobs->steps[index], NULL,
+                               NULL);
+    }
+}
+
+// Contadores pelo cache (os passos constantes continuam do 1º período da análise
+// comparativa); são determinísticos, então podem ser calculados em paralelo.
+static void timing_task(void *arg, int index) {
+    timing_jobs *jobs = (timing_jobs *)arg;
+    double T;
+    if (index < jobs->n_h) {
+        period_cache_fixed(cache, PENDULO_FIXED_RK4, jobs->theta0, jobs->h_vals[index], jobs->num_periods, &T,
+                           &jobs->steps[index], &jobs->stats[index]);
+    } else {
+        period_cache_adaptive(cache, jobs->theta0, jobs->tol, jobs->h0, jobs->num_periods, &T, &jobs->steps[index],
+                              &jobs->stats[index]);
+    }
+}
 
 /**
 Qual o tempo de execu¸c˜ao da simula¸c˜ao para 10 per´ıodos considerando as diferentes es-
@@ -94,31 +486,34 @@ void run_10_period_analysis() {
     double h_vals[] = {0.01, 0.001, 0.0001};
     int n_h = sizeof(h_vals) / sizeof(h_vals[0]);
     double tol = 1e-6; // Tolerância mais alta para o adaptativo
-    double h0 = 0.01;
+    double h0 = 0.0;   // Passo inicial estimado (rk_initial_step)
     int num_periods = 10;
 
-    printf("--- Análise de Tempo para %d Períodos (theta0 = %.2f) ---\n", num_periods, theta0);
-    printf("method,h,steps,time_s\n");
+    // Tarefas 0..n_h-1: passo constante; tarefa n_h: adaptativo
+    timing_jobs jobs = { theta0, h_vals, n_h, tol, h0, num_periods, {0}, {{0}}, {{0}} };
+    sched_parallel_for(pool, n_h + 1, timing_task, &jobs);
 
-    // Passos constantes
-    for (int j = 0; j < n_h; ++j) {
-        double h = h_vals[j];
-        int steps_const;
-        clock_t tc0 = clock();
-        detect_period_constant(theta0, h, num_periods, &steps_const, NULL);
-        clock_t tc1 = clock();
-        double time_const = (double)(tc1 - tc0) / CLOCKS_PER_SEC;
-        printf("constant,%.4f,%d,%.6f\n", h, steps_const, time_const);
+    // Tempo pelo harness (aquecimento, mediana e percentis), uma estratégia por vez na thread
+    // atual: medições simultâneas dividiriam os núcleos e a memória entre si. O tempo mede
+    // sempre a integração completa: é a pergunta da análise, então não passa pelo cache.
+    for (int j = 0; j <= n_h; ++j) {
+        timing_call call = { &jobs, j };
+        bench_measure(NULL, timing_run, &call, &jobs.timing[j]);
     }
 
-    // Integrador adaptativo
-    int steps_adapt;
-    double T_adapt;
-    clock_t ta0 = clock();
-    detect_period_adaptive(theta0, tol, h0, num_periods, &T_adapt, &steps_adapt, NULL);
-    clock_t ta1 = clock();
-    double time_adapt = (double)(ta1 - ta0) / CLOCKS_PER_SEC;
-    printf("adaptive,%.4f,%d,%.6f\n", h0, steps_adapt, time_adapt);
+    // time_s é a mediana das amostras; p10/p90 dão a dispersão
+    printf("--- Análise de Tempo para %d Períodos (theta0 = %.2f) ---\n", num_periods, theta0);
+    // h_or_tol: o passo no passo constante, a tolerância no adaptativo (o passo inicial é estimado)
+    printf("method,h_or_tol,steps,rejected,rhs_evals,time_s,p10_s,p90_s\n");
+    for (int j = 0; j <= n_h; ++j) {
+        if (j < n_h) {
+            printf("constant,%.4f,", h_vals[j]);
+        } else {
+            printf("adaptive,%.1e,", tol);
+        }
+        printf("%d,%ld,%ld,%.9f,%.9f,%.9f\n", jobs.steps[j], jobs.stats[j].rejected_steps, jobs.stats[j].rhs_evals,
+               jobs.timing[j].median_s, jobs.timing[j].p10_s, jobs.timing[j].p90_s);
+    }
 }
 
 /**
@@ -127,16 +522,13 @@ ficada reporte um per´ıodo com erro menor que 0.001?
 **/
 void find_max_angle_for_error_threshold() {
     double T_ana = analytic_period();
-    double tol = 1e-8; // Usar tolerância bem baixa para ter um T_num preciso
-    double h0 = 0.01;
     double error_threshold = 0.001;
 
     printf("T_analitico = %.8f\n", T_ana);
     
+    // O período de referência é o exato (integral elíptica), então a busca não integra nada
     for (double theta0 = 0.1; theta0 > 0.01; theta0 -= 0.005) {
-        double T_num;
-        int steps;
-        detect_period_adaptive(theta0, tol, h0, 1, &T_num, &steps, NULL);
+        double T_num = exact_period(theta0);
         double error = fabs(T_num - T_ana);
 
         printf("theta0 = %.4f, T_num = %.8f, Erro = %.8f\n", theta0, T_num, error);
@@ -148,6 +540,87 @@ void find_max_angle_for_error_threshold() {
     }
 }
 
+typedef struct {
+    const double *theta0_vals;
+    double h;
+    double tol;
+} plot_jobs;
+
+// Abre o destino das amostras (t, theta): binário colunar (padrão) ou CSV.
+static traj_sink *open_plot_file_sink(const char *prefix, double theta0, FILE **fp_out) {
+    static const char *const col_names[] = { "t", "theta" };
+    char filename[100];
+    *fp_out = NULL;
+
+    if (!plot_csv) {
+        sprintf(filename, "output/%s_theta_%.1f.bin", prefix, theta0);
+        return sink_binary_create(filename, 2, col_names);
+    }
+    sprintf(filename, "output/%s_theta_%.1f.csv", prefix, theta0);
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        return NULL;
+    }
+    fprintf(fp, "t,theta\n");
+    *fp_out = fp;
+    return sink_csv_create(fp, 2, "%.8f", ',');
+}
+
+// Com --async, a escrita vai para uma thread separada (se não der, grava direto);
+// *async_out diz se foi, e stats recebe as esperas do integrador ao fechar.
+static traj_sink *open_plot_sink(const char *prefix, double theta0, FILE **fp_out,
+                                 sink_async_stats *stats, int *async_out) {
+    traj_sink *sink = open_plot_file_sink(prefix, theta0, fp_out);
+    *async_out = 0;
+    if (sink && plot_async) {
+        traj_sink *async = sink_async_create(sink, PLOT_ASYNC_BLOCK_ROWS, PLOT_ASYNC_BLOCKS, stats);
+        if (async) {
+            *async_out = 1;
+            return async;
+        }
+    }
+    return sink;
+}
+
+static void plot_task(void *arg, int index) {
+    plot_jobs *jobs = (plot_jobs *)arg;
+    double theta0 = jobs->theta0_vals[index / 2];
+    int adaptive = index % 2;
+    const char *prefix = adaptive ? "plot_adapt" : "plot_const";
+    int steps;
+    double T_num;
+    FILE *fp;
+    sink_async_stats stats;
+    int async;
+
+    traj_sink *sink = open_plot_sink(prefix, theta0, &fp, &stats, &async);
+    if (!sink) {
+        if (fp) {
+            fclose(fp);
+        }
+        return;
+    }
+    if (!adaptive) {
+        // Gerar dados com passo constante
+        detect_period_constant(theta0, jobs->h, 1, &steps, sink, NULL);
+    } else {
+        // Gerar dados com passo adaptativo
+        detect_period_adaptive(theta0, jobs->tol, jobs->h, 1, &T_num, &steps, sink, NULL);
+    }
+    // Amostras perdidas (sem memória, disco cheio) não passam em silêncio
+    int ok = sink_close(sink);
+    if (fp && fclose(fp) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Erro ao gravar a trajetória %s de theta0 = %.1f\n", prefix, theta0);
+    }
+    if (async) {
+        printf("%s theta0 = %.1f: %zu amostras em %zu blocos, integrador esperou %zu vezes (%.6f s)\n",
+               prefix, theta0, stats.samples, stats.blocks, stats.stalls, stats.stall_seconds);
+    }
+}
+
 /**
 Para diferentes valores de θ0, plote o gr´afico de θ × t de um ciclo completo, considerando a
 solu¸c˜ao num´erica e a solu¸c˜ao anal´ıtica aproximada.
@@ -157,28 +630,67 @@ void generate_plot_data() {
     int n_theta = sizeof(theta0_vals) / sizeof(theta0_vals[0]);
     double h = 0.001; // Um h pequeno para o gráfico de passo constante
     double tol = 1e-6;
-    int steps;
-    double T_num;
 
-    for (int i = 0; i < n_theta; ++i) {
-        char filename[100];
-        
-        // Gerar dados com passo constante
-        sprintf(filename, "output/plot_const_theta_%.1f.csv", theta0_vals[i]);
-        FILE* fp_const = fopen(filename, "w");
-        if (fp_const) {
-            fprintf(fp_const, "t,theta\n");
-            detect_period_constant(theta0_vals[i], h, 1, &steps, fp_const);
-            fclose(fp_const);
-        }
+    // Cada (theta0, método) escreve seu próprio arquivo, então as tarefas são independentes
+    plot_jobs jobs = { theta0_vals, h, tol };
+    sched_parallel_for(pool, 2 * n_theta, plot_task, &jobs);
+}
 
-        // Gerar dados com passo adaptativo
-        sprintf(filename, "output/plot_adapt_theta_%.1f.csv", theta0_vals[i]);
-        FILE* fp_adapt = fopen(filename, "w");
-        if (fp_adapt) {
-            fprintf(fp_adapt, "t,theta\n");
-            detect_period_adaptive(theta0_vals[i], tol, h, 1, &T_num, &steps, fp_adapt);
-            fclose(fp_adapt);
-        }
+/**
+Diagrama de bifurcação do pêndulo amortecido e forçado (gamma = 0.5, w0 = 1, w_d = 2/3)
+na faixa de amplitudes em que aparecem as duplicações de período e o caos.
+**/
+int run_bifurcation_sweep() {
+    driven_sweep_config cfg = {
+        0.5, 1.0,                // gamma, w0^2
+        0.9, 1.5, 241,           // amplitudes
+        2.0 / 3.0, 2.0 / 3.0, 1, // frequências
+        0.2, 0.0,                // condição inicial
+        300, 100,                // períodos de transiente, amostras
+        1e-8                     // tol
+    };
+    const char *path = "output/bifurcation.bin";
+
+    double t0 = timing_now();
+    driven_bifurcation *bif = driven_sweep(pool, &cfg);
+    double t1 = timing_now();
+    if (!bif) {
+        fprintf(stderr, "Erro na varredura de bifurcacao\n");
+        return 0;
     }
-}
\ No newline at end of file
+    int ok = driven_bifurcation_write(bif, path);
+    printf("Bifurcacao: %d x %d pontos, %d amostras por ponto, %ld passos, %ld avaliacoes de f, %.3f s -> %s\n",
+           cfg.n_amp, cfg.n_freq, cfg.samples, bif->steps, bif->rhs_evals, t1 - t0, ok ? path : "(falha ao gravar)");
+    driven_bifurcation_free(bif);
+    return ok;
+}
+
+/**
+Uma trajetória longa do pêndulo (theta0 = 2, 1000 períodos) integrada com Parareal no pool e
+comparada com a solução fina serial nas mesmas fatias (ver parareal.h).
+**/
+int run_parareal_analysis() {
+    double y0[2] = {2.0, 0.0};
+    double t_final = 1000 * exact_period(y0[0]);
+    parareal_config cfg = {320, 400, 1e-12, 1e-9, 0};
+    parareal_result r;
+    double y[2], y_serial[2];
+
+    if (!parareal_solve(pool, 0.0, t_final, y0, N_EQ, f_pendulo, &cfg, y, &r)) {
+        fprintf(stderr, "Erro no Parareal\n");
+        return 0;
+    }
+    double t0 = timing_now();
+    parareal_serial_fine(0.0, t_final, y0, N_EQ, f_pendulo, &cfg, y_serial, NULL);
+    double serial_s = timing_now() - t0;
+
+    printf("Parareal: %d fatias, %d threads, %d iteracoes (%s)\n", cfg.n_slices, sched_num_threads(pool),
+           r.iterations, r.converged ? "convergiu" : "nao convergiu");
+    for (int k = 0; k < r.iterations && k < PARAREAL_MAX_HISTORY; ++k) {
+        printf("  iteracao %d: maior correcao relativa %.3e\n", k + 1, r.update[k]);
+    }
+    printf("Erro vs fina serial: %.3e\n", fmax(fabs(y[0] - y_serial[0]), fabs(y[1] - y_serial[1])));
+    printf("Tempo: %.3f s (G %.3f s, F %.3f s de parede, %.3f s de CPU) vs %.3f s serial: %.2fx\n",
+           r.elapsed_s, r.coarse_s, r.fine_s, r.fine_work_s, serial_s, serial_s / r.elapsed_s);
+    return 1;
+}
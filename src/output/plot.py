@@ -16,38 +16,59 @@ if script_dir:
 if not os.path.exists('graficos'):
     os.makedirs('graficos')
 
-# Encontra todos os arquivos CSV que começam com "plot_" no diretório atual
-# O padrão foi melhorado para ser mais específico
-csv_files = glob.glob('plot_*.csv')
+def read_binary_trajectory(path):
+    """Lê o formato binário colunar gravado por sink_binary_create (ver src/sink.h).
 
-if not csv_files:
-    print("Nenhum arquivo CSV com o padrão 'plot_*.csv' foi encontrado.")
+    As colunas são mapeadas direto do arquivo com np.memmap, sem cópia nem parsing.
+    """
+    header = np.fromfile(path, dtype='<u4', count=4)
+    if bytes(np.fromfile(path, dtype='S8', count=1)[0]) != b'PENDTRJ':
+        raise ValueError("cabeçalho inválido")
+    n_cols = int(header[3])
+    n_rows, data_offset = (int(v) for v in np.fromfile(path, dtype='<u8', count=4)[2:4])
+    names = np.fromfile(path, dtype='S16', count=n_cols, offset=32)
+    columns = np.memmap(path, dtype='<f8', mode='r', offset=data_offset, shape=(n_cols, n_rows))
+    return {name.decode(): columns[i] for i, name in enumerate(names)}
+
+
+# Encontra todos os arquivos de dados que começam com "plot_" no diretório atual.
+# O binário colunar é o formato padrão; CSVs (main --csv) são usados se não houver binário.
+data_files = glob.glob('plot_*.bin')
+binary_bases = {os.path.splitext(f)[0] for f in data_files}
+data_files += [f for f in glob.glob('plot_*.csv') if os.path.splitext(f)[0] not in binary_bases]
+
+if not data_files:
+    print("Nenhum arquivo com o padrão 'plot_*.bin' ou 'plot_*.csv' foi encontrado.")
 else:
-    print(f"Encontrados {len(csv_files)} arquivos CSV para processar...")
+    print(f"Encontrados {len(data_files)} arquivos de dados para processar...")
 
 # Loop em cada nome de arquivo encontrado
-for file_path in csv_files:
+for file_path in data_files:
     try:
         base_filename = os.path.basename(file_path)
+        stem, extension = os.path.splitext(base_filename)
         
-        # Lê o arquivo CSV
-        data = pd.read_csv(file_path)
+        # Lê o arquivo (binário mapeado em memória ou CSV)
+        if extension == '.bin':
+            data = read_binary_trajectory(file_path)
+        else:
+            data = pd.read_csv(file_path)
         
-        if 't' not in data.columns or 'theta' not in data.columns:
+        if 't' not in data or 'theta' not in data:
             print(f"AVISO: Arquivo '{base_filename}' não tem colunas 't' e 'theta'. Pulando.")
             continue
 
 
         # 1. Extrai theta0 do nome do arquivo
-        # Ex: de "plot_const_theta_1.0.csv", extrai "1.0"
+        # Ex: de "plot_const_theta_1.0.bin", extrai "1.0"
         try:
-            theta0_str = base_filename.split('theta_')[1].replace('.csv', '')
+            theta0_str = stem.split('theta_')[1]
             theta0 = float(theta0_str)
         except (IndexError, ValueError):
             print(f"AVISO: Não foi possível extrair theta0 do nome do arquivo '{base_filename}'. Pulando.")
             continue
             
-        # 2. Pega os dados do CSV (solução numérica)
+        # 2. Pega os dados do arquivo (solução numérica)
         t_numerical = data['t']
         theta_numerical = data['theta']
 
@@ -70,7 +91,7 @@ for file_path in csv_files:
         ax.grid(True)
 
         # 7. Salva o gráfico combinado
-        output_filename = f"graficos/comparacao_{base_filename.replace('.csv', '.png')}"
+        output_filename = f"graficos/comparacao_{stem}.png"
         plt.savefig(output_filename)
         plt.close(fig)
 
@@ -0,0 +1,219 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parareal.h"
+#include "rk.h"
+#include "timing.h"
+
+static int config_valid(double t0, double t_final, int n_eq, const parareal_config *cfg)
+{
+    return n_eq > 0 && t_final > t0 && cfg->n_slices > 0 && cfg->coarse_steps > 0 && cfg->fine_tol > 0.0 &&
+           cfg->conv_tol >= 0.0;
+}
+
+// Fronteira T_n, calculada diretamente (sem acumular arredondamento; T_N = t_final).
+static double slice_time(double t0, double t_final, int n_slices, int n)
+{
+    return n == n_slices ? t_final : t0 + (t_final - t0) * n / n_slices;
+}
+
+// Tempo de CPU da thread atual (as fatias de F dividem os núcleos com as outras threads).
+static double thread_cpu_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Propagador grosso: coarse_steps passos RK4 de ta a tb.
+static void coarse_propagate(double ta, double tb, const double y_in[], int n_eq,
+                             void (*f)(double, double[], double[]), int coarse_steps, double y_out[],
+                             double tmp[])
+{
+    double h = (tb - ta) / coarse_steps;
+    memcpy(y_out, y_in, n_eq * sizeof(double));
+    for (int s = 0; s < coarse_steps; ++s)
+    {
+        rk4_single_step_system(ta + s * h, y_out, h, n_eq, f, tmp);
+        memcpy(y_out, tmp, n_eq * sizeof(double));
+    }
+}
+
+// Propagador fino: uma integração adaptativa que só depende do estado de entrada.
+static int fine_propagate(double ta, double tb, const double y_in[], int n_eq,
+                          void (*f)(double, double[], double[]), double tol, double y_out[], rk_stats *stats)
+{
+    return RungeKutta_system_adaptive_h(ta, tb, y_in, n_eq, f, tol, 0.0, NULL, y_out, stats);
+}
+
+typedef struct
+{
+    double t0, t_final;
+    int n_eq;
+    void (*f)(double, double[], double[]);
+    const parareal_config *cfg;
+    int first;        // Primeira fatia desta iteração
+    const double *U;  // [(N + 1) * n_eq] estados da iteração anterior
+    double *F;        // [(N + 1) * n_eq] F(U_n) em F[n + 1]
+    long *steps;      // [N]
+    long *rhs_evals;  // [N]
+    double *seconds;  // [N]
+} fine_jobs;
+
+static void fine_task(void *arg, int index)
+{
+    fine_jobs *jobs = (fine_jobs *)arg;
+    int n = jobs->first + index;
+    int n_eq = jobs->n_eq;
+    int N = jobs->cfg->n_slices;
+    rk_stats stats;
+
+    double t_start = thread_cpu_now();
+    jobs->steps[n] = fine_propagate(slice_time(jobs->t0, jobs->t_final, N, n),
+                                    slice_time(jobs->t0, jobs->t_final, N, n + 1), jobs->U + n * n_eq, n_eq,
+                                    jobs->f, jobs->cfg->fine_tol, jobs->F + (n + 1) * n_eq,
+                                    RK_STATS_ENABLED ? &stats : NULL);
+    jobs->seconds[n] = thread_cpu_now() - t_start;
+    jobs->rhs_evals[n] = RK_STATS_ENABLED ? stats.rhs_evals : 0;
+}
+
+int parareal_solve(sched_pool *pool, double t0, double t_final, const double y0[], int n_eq,
+                   void (*f)(double, double[], double[]), const parareal_config *cfg,
+                   double y_out[], parareal_result *result)
+{
+    parareal_result res;
+    memset(&res, 0, sizeof(res));
+    if (!config_valid(t0, t_final, n_eq, cfg))
+        return 0;
+
+    int N = cfg->n_slices;
+    int max_iter = cfg->max_iter > 0 && cfg->max_iter < N ? cfg->max_iter : N;
+    size_t n_states = (size_t)(N + 1) * n_eq;
+    double *U = malloc(n_states * sizeof(double));      // Estados nas fronteiras
+    double *F = malloc(n_states * sizeof(double));      // F(U^{k-1}_n) em F[n + 1]
+    double *G_old = malloc(n_states * sizeof(double));  // G(U^{k-1}_n) em G_old[n + 1]
+    double *work = malloc(2 * n_eq * sizeof(double));
+    long *counters = malloc(2 * N * sizeof(long));
+    double *seconds = malloc(N * sizeof(double));
+    if (!U || !F || !G_old || !work || !counters || !seconds)
+    {
+        free(U);
+        free(F);
+        free(G_old);
+        free(work);
+        free(counters);
+        free(seconds);
+        return 0;
+    }
+    double *G_new = work, *tmp = work + n_eq;
+    long coarse_evals = 4L * cfg->coarse_steps;
+    double t_begin = timing_now();
+
+    // Iteração 0: uma varredura serial de G
+    memcpy(U, y0, n_eq * sizeof(double));
+    for (int n = 0; n < N; ++n)
+    {
+        coarse_propagate(slice_time(t0, t_final, N, n), slice_time(t0, t_final, N, n + 1), U + n * n_eq, n_eq,
+                         f, cfg->coarse_steps, G_old + (n + 1) * n_eq, tmp);
+        memcpy(U + (n + 1) * n_eq, G_old + (n + 1) * n_eq, n_eq * sizeof(double));
+    }
+    res.coarse_s = timing_now() - t_begin;
+    res.rhs_evals = RK_STATS_ENABLED ? N * coarse_evals : 0;
+
+    fine_jobs jobs = { t0, t_final, n_eq, f, cfg, 0, U, F, counters, counters + N, seconds };
+    for (int k = 1; k <= max_iter; ++k)
+    {
+        // As fronteiras 0..k-1 já são a solução fina: só as fatias k-1..N-1 são propagadas
+        int first = k - 1;
+        jobs.first = first;
+        double t_fine = timing_now();
+        sched_parallel_for(pool, N - first, fine_task, &jobs);
+        res.fine_s += timing_now() - t_fine;
+        for (int n = first; n < N; ++n)
+        {
+            res.fine_steps += counters[n];
+            res.rhs_evals += counters[N + n];
+            res.fine_work_s += seconds[n];
+        }
+        res.fine_slices += N - first;
+
+        // Correção serial: U_{n+1} = F(U^{k-1}_n) + [G(U^k_n) - G(U^{k-1}_n)]. Na fatia first,
+        // U_n não mudou, então o colchete é zero e U_{n+1} fica exatamente igual a F.
+        double t_coarse = timing_now();
+        double update = 0.0;
+        for (int n = first; n < N; ++n)
+        {
+            double *u_next = U + (n + 1) * n_eq;
+            double *g_old = G_old + (n + 1) * n_eq;
+            const double *f_next = F + (n + 1) * n_eq;
+            coarse_propagate(slice_time(t0, t_final, N, n), slice_time(t0, t_final, N, n + 1), U + n * n_eq,
+                             n_eq, f, cfg->coarse_steps, G_new, tmp);
+            for (int i = 0; i < n_eq; ++i)
+            {
+                double u = f_next[i] + (G_new[i] - g_old[i]);
+                update = fmax(update, fabs(u - u_next[i]) / (1.0 + fabs(u)));
+                u_next[i] = u;
+                g_old[i] = G_new[i];
+            }
+        }
+        res.coarse_s += timing_now() - t_coarse;
+        if (RK_STATS_ENABLED)
+            res.rhs_evals += (N - first) * coarse_evals;
+
+        if (k <= PARAREAL_MAX_HISTORY)
+            res.update[k - 1] = update;
+        res.iterations = k;
+        if (update <= cfg->conv_tol)
+        {
+            res.converged = 1;
+            break;
+        }
+    }
+    // Com N iterações todas as fronteiras são a solução fina, mesmo sem atingir conv_tol
+    if (res.iterations == N)
+        res.converged = 1;
+
+    memcpy(y_out, U + N * n_eq, n_eq * sizeof(double));
+    res.elapsed_s = timing_now() - t_begin;
+    if (result)
+        *result = res;
+
+    free(U);
+    free(F);
+    free(G_old);
+    free(work);
+    free(counters);
+    free(seconds);
+    return 1;
+}
+
+long parareal_serial_fine(double t0, double t_final, const double y0[], int n_eq,
+                          void (*f)(double, double[], double[]), const parareal_config *cfg,
+                          double y_out[], rk_stats *stats)
+{
+    if (!config_valid(t0, t_final, n_eq, cfg))
+        return -1;
+
+    int N = cfg->n_slices;
+    double *y = malloc(n_eq * sizeof(double));
+    if (!y)
+        return -1;
+    long steps = 0;
+    rk_stats slice_stats;
+
+    if (stats)
+        rk_stats_reset(stats);
+    memcpy(y, y0, n_eq * sizeof(double));
+    for (int n = 0; n < N; ++n)
+    {
+        steps += fine_propagate(slice_time(t0, t_final, N, n), slice_time(t0, t_final, N, n + 1), y, n_eq, f,
+                                cfg->fine_tol, y, stats ? &slice_stats : NULL);
+        if (stats)
+            rk_stats_merge(stats, &slice_stats);
+    }
+    memcpy(y_out, y, n_eq * sizeof(double));
+    free(y);
+    return steps;
+}
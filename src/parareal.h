@@ -0,0 +1,79 @@
+#ifndef PARAREAL_H
+#define PARAREAL_H
+
+#include "rk_stats.h"
+#include "scheduler.h"
+
+/*
+ * Parareal (Lions, Maday e Turinici): paralelismo no tempo para uma única trajetória longa.
+ *
+ * O horizonte [t0, t_final] é dividido em N fatias iguais, com fronteiras T_n. Dois
+ * propagadores levam o estado de T_n a T_{n+1}:
+ *   G (grosso): RK4 de passo fixo com coarse_steps passos por fatia, barato e serial;
+ *   F (fino):   RungeKutta_system_adaptive_h com tolerância fine_tol, caro e independente
+ *               entre as fatias, então roda em paralelo no pool.
+ * A iteração k parte dos estados U^{k-1} e faz
+ *   U^k_{n+1} = F(U^{k-1}_n) + [G(U^k_n) - G(U^{k-1}_n)],
+ * com os F em paralelo e a correção G em série. Depois de k iterações as k primeiras
+ * fronteiras já são exatamente a solução fina serial, então cada iteração só propaga as
+ * fatias restantes e o método termina em no máximo N iterações. Para quando a maior
+ * correção relativa max |U^k_n - U^{k-1}_n| / (1 + |U^k_n|) fica <= conv_tol.
+ *
+ * A solução de referência é a fina serial nas mesmas fatias (parareal_serial_fine): F
+ * sempre recomeça o controlador e estima o passo inicial em T_n, então o resultado de uma
+ * fatia depende só do estado de entrada, não da thread nem da ordem de execução.
+ *
+ * Com P threads, o tempo é ~ (k + 1) t_G + k t_F N / P (t_G e t_F: custo de uma fatia em
+ * cada propagador), contra N t_F da solução serial; só compensa quando k << P e t_G << t_F.
+ */
+
+// Correções registradas em parareal_result (as iterações seguintes não são guardadas).
+#define PARAREAL_MAX_HISTORY 64
+
+typedef struct
+{
+    int n_slices;          // Fatias de tempo (N)
+    int coarse_steps;      // Passos RK4 de G por fatia
+    double fine_tol;       // Tolerância de F
+    double conv_tol;       // Critério de parada sobre a maior correção relativa
+    int max_iter;          // Limite de iterações; <= 0 usa N
+} parareal_config;
+
+#define PARAREAL_CONFIG_DEFAULT {32, 8, 1e-8, 1e-8, 0}
+
+typedef struct
+{
+    int iterations;                       // Iterações feitas
+    int converged;                        // A última correção ficou <= conv_tol
+    double update[PARAREAL_MAX_HISTORY];  // Maior correção relativa de cada iteração
+    long fine_slices;                     // Fatias propagadas por F, somando as iterações
+    long fine_steps;                      // Passos aceitos de F
+    long rhs_evals;                       // Avaliações de f (G e F)
+    double coarse_s;                      // Tempo das varreduras seriais de G
+    double fine_s;                        // Tempo de parede das fases paralelas de F
+    double fine_work_s;                   // Soma do tempo de CPU de cada fatia de F
+    double elapsed_s;
+} parareal_result;
+
+/**
+ * @brief Integra y' = f(t, y) de t0 a t_final com Parareal.
+ * @param pool Pool onde rodam as fatias de F.
+ * @param y_out Estado em t_final (n_eq valores).
+ * @param result Convergência, custo e tempos (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 em caso de falha (configuração inválida ou sem memória).
+ */
+int parareal_solve(sched_pool *pool, double t0, double t_final, const double y0[], int n_eq,
+                   void (*f)(double, double[], double[]), const parareal_config *cfg,
+                   double y_out[], parareal_result *result);
+
+/**
+ * @brief Solução fina serial nas mesmas fatias de parareal_solve: a que Parareal reproduz
+ *        quando converge.
+ * @param stats Estatísticas somadas de todas as fatias (pode ser NULL).
+ * @return Número de passos aceitos, ou -1 se a configuração for inválida.
+ */
+long parareal_serial_fine(double t0, double t_final, const double y0[], int n_eq,
+                          void (*f)(double, double[], double[]), const parareal_config *cfg,
+                          double y_out[], rk_stats *stats);
+
+#endif
@@ -1,9 +1,100 @@
 #include "pendulo.h"
 #include "rk.h"
+#include "vecmath.h"
+#include "rk_spec.h"
+#include "symplectic.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+vm_accuracy pendulo_sin_acc = PENDULO_SIN_ACCURACY;
+
+void pendulo_set_sin_accuracy(vm_accuracy acc) {
+    if (acc >= 0 && acc < VM_ACC_COUNT)
+        pendulo_sin_acc = acc;
+}
+
+vm_accuracy pendulo_get_sin_accuracy(void) {
+    return pendulo_sin_acc;
+}
 
 void f_pendulo(double t, double y[], double dydt[]) {
-    dydt[0] = y[1];
-    dydt[1] = -(G/L) * sin(y[0]);
+    f_pendulo_inline(t, y, dydt);
+}
+
+// Steppers gerados para o pêndulo (N_EQ fixo, derivada inline); ver rk_spec.h.
+RK_DEFINE_RK4_STEPPER(rk4_pendulo, N_EQ, f_pendulo_inline)
+RK_DEFINE_DOUBLING_STEPPER(rk_doubling_pendulo, rk4_pendulo, N_EQ)
+
+// Aceleração angular para os integradores simpléticos (q = theta, p = omega).
+static inline void accel_pendulo(const double q[], double a[]) {
+    a[0] = -(G/L) * vm_sin_acc(pendulo_sin_acc, q[0]);
+}
+
+SYMPL_DEFINE_STEPPER(sympl_pendulo, 1, accel_pendulo)
+
+static const sympl_scheme *const fixed_schemes[PENDULO_FIXED_COUNT] = {
+    NULL, &sympl_verlet, &sympl_yoshida4, &sympl_suzuki4, &sympl_yoshida6,
+};
+
+// Mesmo sistema para n pêndulos; os senos de vecmath.h permitem vetorizar o laço.
+void f_pendulo_batch(int n, const double theta[], const double omega[],
+                     double dtheta[], double domega[]) {
+    switch (pendulo_sin_acc) {
+    case VM_ACC_1ULP:
+        #pragma omp simd
+        for (int i = 0; i < n; ++i) {
+            dtheta[i] = omega[i];
+            domega[i] = -(G/L) * vm_sin_accurate(theta[i]);
+        }
+        break;
+    case VM_ACC_FAST:
+        #pragma omp simd
+        for (int i = 0; i < n; ++i) {
+            dtheta[i] = omega[i];
+            domega[i] = -(G/L) * vm_sin_fast(theta[i]);
+        }
+        break;
+    default:
+        #pragma omp simd
+        for (int i = 0; i < n; ++i) {
+            dtheta[i] = omega[i];
+            domega[i] = -(G/L) * vm_sin(theta[i]);
+        }
+        break;
+    }
+}
+
+void f_pendulo_batch_exact(int n, const double theta[], const double omega[],
+                           double dtheta[], double domega[]) {
+    if (pendulo_sin_acc != VM_ACC_LIBM) {
+        f_pendulo_batch(n, theta, omega, dtheta, domega);
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        dtheta[i] = omega[i];
+        domega[i] = -(G/L) * vm_sin_acc(VM_ACC_LIBM, theta[i]);
+    }
+}
+
+static double omega_event(double t, const double y[], void *ctx) {
+    return y[1];
+}
+
+// Cruzamento de omega por zero localizado na saída densa do passo.
+double pendulo_crossing_time(double t0, const double y0[], double t1, const double y1[]) {
+    double f0[N_EQ], f1[N_EQ];
+    f_pendulo(t0, (double *)y0, f0);
+    f_pendulo(t1, (double *)y1, f1);
+
+    rk_dense_step step = { t0, t1, N_EQ, y0, f0, y1, f1 };
+    double t_event;
+    if (!rk_locate_event(&step, omega_event, NULL, 1e-15 * (1.0 + fabs(t1)), &t_event)) {
+        // Sem troca de sinal estrita (omega nulo numa ponta): usa a interpolação linear
+        double ratio = fabs(y0[1]) / (fabs(y0[1]) + fabs(y1[1]));
+        return t0 + ratio * (t1 - t0);
+    }
+    return t_event;
 }
 
 // Período analítico (pequeno ângulo)
@@ -12,48 +103,232 @@ double analytic_period() {
 }
 
 
-// Detecta o período numérico usando passo constante h.
-double detect_period_constant(double theta0, double h, int num_periods, int *steps_out, FILE* outfile) {
-    double t = 0.0;
-    double y[2] = { theta0, 0.0 };
+// Período exato via média aritmético-geométrica: K(k) = pi / (2 AGM(1, sqrt(1 - k^2))).
+double exact_period(double theta0) {
+    double a = 1.0;
+    double b = cos(fabs(theta0) / 2.0); // sqrt(1 - sin^2(theta0/2))
+    for (int iter = 0; iter < 64 && fabs(a - b) > 4.0 * 2.2e-16 * a; ++iter) {
+        double a_next = 0.5 * (a + b);
+        b = sqrt(a * b);
+        a = a_next;
+    }
+    return 4.0 * sqrt(L / G) * M_PI / (2.0 * a);
+}
+
+static double *period_table = NULL;
+static int period_table_n = 0;
+static double period_table_step = 0.0;
+
+// Tabela uniforme em theta0, com um ponto extra em cada ponta para a interpolação cúbica.
+int exact_period_table_init(int n_points) {
+    if (n_points < 4) {
+        return 0;
+    }
+    double *table = malloc((n_points + 2) * sizeof(double));
+    if (!table) {
+        return 0;
+    }
+    double step = PERIOD_TABLE_MAX / (double)(n_points - 1);
+    for (int i = 0; i < n_points + 2; ++i) {
+        table[i] = exact_period((i - 1) * step); // T é par em theta0: T(-x) = T(x)
+    }
+    free(period_table);
+    period_table = table;
+    period_table_n = n_points;
+    period_table_step = step;
+    return 1;
+}
+
+double exact_period_lookup(double theta0) {
+    double x = fabs(theta0);
+    if (!period_table || x >= PERIOD_TABLE_MAX) {
+        return exact_period(theta0);
+    }
+    // Interpolação de Lagrange com os 4 pontos vizinhos (nós -1, 0, 1, 2 em unidades do passo)
+    double u = x / period_table_step;
+    int i = (int)u;
+    double s = u - i;
+    const double *p = period_table + i; // p[0..3] = T(x_{i-1}), ..., T(x_{i+2})
+    double w0 = -s * (s - 1.0) * (s - 2.0) / 6.0;
+    double w1 = (s + 1.0) * (s - 1.0) * (s - 2.0) / 2.0;
+    double w2 = -(s + 1.0) * s * (s - 2.0) / 2.0;
+    double w3 = (s + 1.0) * s * (s - 1.0) / 6.0;
+    return w0 * p[0] + w1 * p[1] + w2 * p[2] + w3 * p[3];
+}
+
+const char *pendulo_fixed_method_name(pendulo_fixed_method method) {
+    if (method < 0 || method >= PENDULO_FIXED_COUNT) {
+        return "unknown";
+    }
+    return method == PENDULO_FIXED_RK4 ? "rk4" : fixed_schemes[method]->name;
+}
+
+int pendulo_fixed_rhs_evals(pendulo_fixed_method method) {
+    if (method < 0 || method >= PENDULO_FIXED_COUNT) {
+        return 0;
+    }
+    return method == PENDULO_FIXED_RK4 ? 4 : fixed_schemes[method]->stages;
+}
+
+double pendulo_energy(const double y[]) {
+    return 0.5 * y[1] * y[1] + (G/L) * (1.0 - cos(y[0]));
+}
+
+void pendulo_period_run_init(pendulo_period_run *run, double theta0) {
+    run->theta0 = theta0;
+    run->t = 0.0;
+    run->y[0] = theta0;
+    run->y[1] = 0.0;
+    run->h = 0.0;
+    run->accel = 0.0;
+    rk_control_state_reset(&run->ctl);
+    run->started = 0;
+    run->steps = 0;
+    rk_stats_reset(&run->stats);
+    run->n_crossings = 0;
+    run->cap_crossings = 0;
+    run->crossings = NULL;
+}
+
+void pendulo_period_run_free(pendulo_period_run *run) {
+    free(run->crossings);
+    run->crossings = NULL;
+    run->n_crossings = run->cap_crossings = 0;
+}
+
+int pendulo_period_run_copy(pendulo_period_run *dst, const pendulo_period_run *src) {
+    pendulo_crossing *crossings = NULL;
+    if (src->n_crossings > 0) {
+        crossings = malloc(src->n_crossings * sizeof(pendulo_crossing));
+        if (!crossings) {
+            return 0;
+        }
+        memcpy(crossings, src->crossings, src->n_crossings * sizeof(pendulo_crossing));
+    }
+    *dst = *src;
+    dst->crossings = crossings;
+    dst->cap_crossings = src->n_crossings;
+    return 1;
+}
+
+// Grava o cruzamento de índice index no run (sem alterar n_crossings, atualizado no fim).
+static int record_crossing(pendulo_period_run *run, int index, double t_cross, int steps,
+                           const rk_stats *stats) {
+    if (index >= run->cap_crossings) {
+        int cap = run->cap_crossings ? 2 * run->cap_crossings : 8;
+        pendulo_crossing *grown = realloc(run->crossings, cap * sizeof(pendulo_crossing));
+        if (!grown) {
+            return 0;
+        }
+        run->crossings = grown;
+        run->cap_crossings = cap;
+    }
+    pendulo_crossing *c = &run->crossings[index];
+    c->t = t_cross;
+    c->steps = steps;
+    c->stats = *stats;
+    memset(c->stats.cycles, 0, sizeof(c->stats.cycles));
+    return 1;
+}
+
+int pendulo_period_run_add_crossing(pendulo_period_run *run, double t_cross, int steps,
+                                    const rk_stats *stats) {
+    if (!record_crossing(run, run->n_crossings, t_cross, steps, stats)) {
+        return 0;
+    }
+    run->n_crossings++;
+    return 1;
+}
+
+int pendulo_period_run_result(const pendulo_period_run *run, int num_periods, double *T_num_out,
+                              int *steps_out, rk_stats *stats) {
+    int k = 2 * num_periods;
+    if (num_periods <= 0 || run->n_crossings < k) {
+        return 0;
+    }
+    const pendulo_crossing *c = &run->crossings[k - 1];
+    *T_num_out = (2.0 * c->t) / (double)k;
+    if (steps_out) {
+        *steps_out = c->steps;
+    }
+    if (stats) {
+        *stats = c->stats;
+    }
+    return 1;
+}
+
+// Avança run com passo constante h até target cruzamentos. Com record, cada cruzamento
+// é gravado no run (stats deve ser &run->stats); *t_last recebe o instante do último.
+static int fixed_core(pendulo_fixed_method method, pendulo_period_run *run, double h, int target,
+                      traj_sink *sink, rk_stats *stats, int record, double *t_last) {
+    double t = run->t;
+    double y[2] = { run->y[0], run->y[1] };
     double y_next[2];
     double prev_omega = y[1];
-    int steps = 0;
-    
-    int zero_crossings = 0;
-    double first_half_period_time = 0.0;
-    double total_time = 0.0;
+    int steps = run->steps;
+    int zero_crossings = run->n_crossings;
+
+    const sympl_scheme *scheme = (method > PENDULO_FIXED_RK4 && method < PENDULO_FIXED_COUNT)
+        ? fixed_schemes[method] : NULL;
+    int evals_per_step = pendulo_fixed_rhs_evals(scheme ? method : PENDULO_FIXED_RK4);
+    (void)evals_per_step; // Só usado por RK_STATS_EVALS
+    double accel[1] = { run->accel };
+
+    if (!run->started) {
+        if (scheme) {
+            // Aceleração inicial; depois cada estágio reaproveita a do anterior
+            accel_pendulo(y, accel);
+            RK_STATS_EVALS(stats, 1);
+        }
 
-    // Salva o ponto inicial.
-    if (outfile) {
-        fprintf(outfile, "%.8f,%.8f\n", t, y[0]);
+        // Salva o ponto inicial.
+        if (sink) {
+            RK_CYCLES_BEGIN(c_out);
+            sink_write(sink, t, y);
+            RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
+        }
+        run->started = 1;
     }
 
-    while (zero_crossings < 2 * num_periods) {
-        rk4_single_step_system(t, y, h, N_EQ, f_pendulo, y_next);
+    while (zero_crossings < target) {
+        RK_CYCLES_BEGIN(c_step);
+        if (scheme) {
+            y_next[0] = y[0];
+            y_next[1] = y[1];
+            sympl_pendulo(scheme, &y_next[0], &y_next[1], accel, h);
+        } else {
+            rk4_pendulo(t, y, h, y_next);
+        }
+        RK_CYCLES_END(stats, RK_PHASE_STEP, c_step);
+        RK_STATS_EVALS(stats, evals_per_step);
+        RK_STATS_ACCEPT(stats, h);
         steps++;
         double curr_t = t + h;
         double curr_omega = y_next[1];
 
         // Salva o ponto atual.
-        if (outfile) {
-            fprintf(outfile, "%.8f,%.8f\n", curr_t, y[0]);
+        if (sink) {
+            RK_CYCLES_BEGIN(c_out);
+            sink_write(sink, curr_t, y_next);
+            RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
         }
 
         // Detecta cruzamento por zero da velocidade angular (inversão de movimento)
         if (prev_omega * curr_omega <= 0 && t > 0) {
             zero_crossings++;
             
-            // Interpolação linear para encontrar o tempo exato do cruzamento
-            double ratio = fabs(prev_omega) / (fabs(prev_omega) + fabs(curr_omega));
-            double interpolated_time = t + ratio * h;
+            // Interpolação de Hermite + Brent para encontrar o tempo exato do cruzamento
+            RK_CYCLES_BEGIN(c_event);
+            double interpolated_time = pendulo_crossing_time(t, y, curr_t, y_next);
+            RK_CYCLES_END(stats, RK_PHASE_EVENT, c_event);
+            RK_STATS_EVALS(stats, PENDULO_CROSSING_EVALS);
 
-            if (zero_crossings == 1) { // Primeiro meio período
-                first_half_period_time = interpolated_time;
+            if (record && !record_crossing(run, zero_crossings - 1, interpolated_time, steps, stats)) {
+                return 0;
             }
-            // Ao final de `num_periods` (2*num_periods meios-períodos)
-            if (zero_crossings == 2 * num_periods) {
-                 total_time = interpolated_time;
+            // Ao final de `target` meios-períodos
+            if (zero_crossings == target) {
+                 *t_last = interpolated_time;
             }
         }
 
@@ -62,44 +337,100 @@ double detect_period_constant(double theta0, double h, int num_periods, int *ste
         y[0] = y_next[0];
         y[1] = y_next[1];
     }
-    
-    *steps_out = steps;
+
+    run->t = t;
+    run->y[0] = y[0];
+    run->y[1] = y[1];
+    run->accel = accel[0];
+    run->steps = steps;
+    run->n_crossings = zero_crossings;
+    return 1;
+}
+
+// Detecta o período numérico usando passo constante h.
+double detect_period_fixed(pendulo_fixed_method method, double theta0, double h, int num_periods,
+                           int *steps_out, traj_sink *sink, rk_stats *stats) {
+    pendulo_period_run run;
+    double total_time = 0.0;
+
+    pendulo_period_run_init(&run, theta0);
+    if (stats) {
+        rk_stats_reset(stats);
+    }
+    fixed_core(method, &run, h, 2 * num_periods, sink, stats, 0, &total_time);
+
+    *steps_out = run.steps;
    
     // Retorna o período médio
     return (2.0 * total_time) / (double)(2 * num_periods);
 }
 
+double detect_period_constant(double theta0, double h, int num_periods, int *steps_out, traj_sink *sink,
+                              rk_stats *stats) {
+    return detect_period_fixed(PENDULO_FIXED_RK4, theta0, h, num_periods, steps_out, sink, stats);
+}
 
-//  Detecta o período usando integrador adaptativo.
-int detect_period_adaptive(double theta0, double tol, double h_initial, int num_periods,
-                           double *T_num_out, int *steps_out, FILE* outfile) {
-    double t = 0.0;
-    double y[2] = { theta0, 0.0 };
-    double h = h_initial;
-    double h_min = tol * 0.1;
+int detect_period_fixed_resume(pendulo_fixed_method method, pendulo_period_run *run, double h,
+                               int num_periods, traj_sink *sink) {
+    double t_last;
+    return fixed_core(method, run, h, 2 * num_periods, sink, &run->stats, 1, &t_last);
+}
+
+// Avança run com o integrador adaptativo até target cruzamentos (ver fixed_core).
+static int adaptive_core(pendulo_period_run *run, double tol, double h_initial, int target,
+                         traj_sink *sink, rk_stats *stats, int record, double *t_last) {
+    double t = run->t;
+    double y[2] = { run->y[0], run->y[1] };
+    double h = run->h;
     double h_max = analytic_period() / 4.0;
+    double h_min = rk_default_h_min(tol, h_max);
     double prev_omega = y[1];
     double prev_t = t;
-    int steps = 0;
+    int steps = run->steps;
+    int zero_crossings = run->n_crossings;
+    // O passo dobrado tem versão especializada; os pares embutidos usam o caminho genérico
+    int specialized = (rk_get_adaptive_method() == RK_METHOD_RK4_DOUBLING);
+    rk_control_state ctl = run->ctl;
 
-    int zero_crossings = 0;
-    double total_time = 0.0;
-    
-    if (outfile) {
-        fprintf(outfile, "%.8f,%.8f\n", t, y[0]);
+    if (!run->started) {
+        h = h_initial;
+        if (h <= 0.0) {
+            h = rk_initial_step(t, y, N_EQ, f_pendulo, tol, rk_method_error_order(rk_get_adaptive_method()), h_max);
+            RK_STATS_EVALS(stats, RK_INITIAL_STEP_EVALS);
+        }
+
+        if (sink) {
+            RK_CYCLES_BEGIN(c_out);
+            sink_write(sink, t, y);
+            RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
+        }
+        run->started = 1;
+    }
+    if (!specialized) {
+        // O caminho genérico guarda o controlador no workspace da thread
+        *rk_adaptive_control(N_EQ, f_pendulo, t) = ctl;
     }
 
-    while (zero_crossings < 2 * num_periods) {
+    while (zero_crossings < target) {
         double t_before_step = t;
-        int status = rk_adaptive_one_step(&t, y, &h, N_EQ, f_pendulo,
-                                         tol, h_min, h_max);
+        double y_before_step[2] = { y[0], y[1] };
+        RK_CYCLES_BEGIN(c_step);
+        int status = specialized
+            ? rk_doubling_pendulo(&t, y, &h, tol, h_min, h_max, &ctl)
+            : rk_adaptive_step(&t, y, &h, N_EQ, f_pendulo, tol, h_min, h_max);
+        RK_CYCLES_END(stats, RK_PHASE_STEP, c_step);
+        RK_STATS_EVALS(stats, specialized ? 12 : rk_last_step_evals());
         if (status == 0) { // Passo rejeitado
+            RK_STATS_REJECT(stats);
             continue;
         }
+        RK_STATS_ACCEPT(stats, t - t_before_step);
         steps++;
         
-        if (outfile) {
-            fprintf(outfile, "%.8f,%.8f\n", t, y[0]);
+        if (sink) {
+            RK_CYCLES_BEGIN(c_out);
+            sink_write(sink, t, y);
+            RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
         }
 
         double curr_omega = y[1];
@@ -107,11 +438,16 @@ int detect_period_adaptive(double theta0, double tol, double h_initial, int num_
         if (prev_omega * curr_omega <= 0 && t_before_step > 0) {
             zero_crossings++;
 
-            double ratio = fabs(prev_omega) / (fabs(prev_omega) + fabs(curr_omega));
-            double interpolated_time = prev_t + ratio * (t - prev_t);
+            RK_CYCLES_BEGIN(c_event);
+            double interpolated_time = pendulo_crossing_time(prev_t, y_before_step, t, y);
+            RK_CYCLES_END(stats, RK_PHASE_EVENT, c_event);
+            RK_STATS_EVALS(stats, PENDULO_CROSSING_EVALS);
             
-            if (zero_crossings == 2 * num_periods) {
-                total_time = interpolated_time;
+            if (record && !record_crossing(run, zero_crossings - 1, interpolated_time, steps, stats)) {
+                return 0;
+            }
+            if (zero_crossings == target) {
+                *t_last = interpolated_time;
             }
         }
 
@@ -119,8 +455,39 @@ int detect_period_adaptive(double theta0, double tol, double h_initial, int num_
         prev_t = t;
     }
 
-    *steps_out = steps;
+    if (!specialized) {
+        ctl = *rk_adaptive_control(N_EQ, f_pendulo, t);
+    }
+    run->t = t;
+    run->y[0] = y[0];
+    run->y[1] = y[1];
+    run->h = h;
+    run->ctl = ctl;
+    run->steps = steps;
+    run->n_crossings = zero_crossings;
+    return 1;
+}
+
+//  Detecta o período usando integrador adaptativo.
+int detect_period_adaptive(double theta0, double tol, double h_initial, int num_periods,
+                           double *T_num_out, int *steps_out, traj_sink *sink, rk_stats *stats) {
+    pendulo_period_run run;
+    double total_time = 0.0;
+
+    pendulo_period_run_init(&run, theta0);
+    if (stats) {
+        rk_stats_reset(stats);
+    }
+    adaptive_core(&run, tol, h_initial, 2 * num_periods, sink, stats, 0, &total_time);
+
+    *steps_out = run.steps;
     // Retorna o período médio
     *T_num_out = (2.0 * total_time) / (double)(2 * num_periods);
     return 1;
-}
\ No newline at end of file
+}
+
+int detect_period_adaptive_resume(pendulo_period_run *run, double tol, double h_initial,
+                                  int num_periods, traj_sink *sink) {
+    double t_last;
+    return adaptive_core(run, tol, h_initial, 2 * num_periods, sink, &run->stats, 1, &t_last);
+}
@@ -5,45 +5,234 @@
 #include <stdbool.h>
 #include <math.h>
 
+#include "sink.h"
+#include "rk_stats.h"
+#include "rk.h"
+#include "vecmath.h"
+
 // Constantes Físicas e do Sistema
 #define G 9.81      // Aceleração da gravidade
 #define L 1.0       // Comprimento do pêndulo
 #define N_EQ 2      // Número de equações (theta, omega)
 
+// Precisão inicial do seno nas derivadas; pode ser trocada na compilação
+// (make SIN=VM_ACC_4ULP, por exemplo) ou em tempo de execução com pendulo_set_sin_accuracy.
+#ifndef PENDULO_SIN_ACCURACY
+#define PENDULO_SIN_ACCURACY VM_ACC_LIBM
+#endif
+
+// Nível em uso; lido a cada avaliação de f (não alterar durante integrações concorrentes).
+extern vm_accuracy pendulo_sin_acc;
+
+/**
+ * @brief Seleciona a implementação do seno usada por f_pendulo, f_pendulo_batch e pelos
+ *        integradores simpléticos. Em f_pendulo_batch, VM_ACC_LIBM usa vm_sin (a libm não vetoriza).
+ */
+void pendulo_set_sin_accuracy(vm_accuracy acc);
+vm_accuracy pendulo_get_sin_accuracy(void);
+
 /**
  * @brief Define o sistema de EDOs para o pêndulo.
  * y[0] = theta, y[1] = omega
  */
 void f_pendulo(double t, double y[], double dydt[]);
 
+// Mesma derivada, visível ao compilador para os steppers especializados de rk_spec.h.
+static inline void f_pendulo_inline(double t, const double y[], double dydt[]) {
+    dydt[0] = y[1];
+    dydt[1] = -(G/L) * vm_sin_acc(pendulo_sin_acc, y[0]);
+}
+
+/**
+ * @brief Versão em lote (structure-of-arrays) de f_pendulo para n pêndulos.
+ *        dtheta[i] = omega[i], domega[i] = -(G/L) sin(theta[i]).
+ */
+void f_pendulo_batch(int n, const double theta[], const double omega[],
+                     double dtheta[], double domega[]);
+
+/**
+ * @brief Como f_pendulo_batch, mas com o mesmo seno de f_pendulo também em VM_ACC_LIBM
+ *        (então o seno não vetoriza nesse nível): o resultado é bit a bit o de f_pendulo.
+ */
+void f_pendulo_batch_exact(int n, const double theta[], const double omega[],
+                           double dtheta[], double domega[]);
+
+/**
+ * @brief Instante em que omega cruza zero dentro do passo [t0, t1].
+ *        Usa o interpolante de Hermite do passo e o método de Brent (erro O(h^4)
+ *        em vez do O(h^2) da interpolação linear entre as pontas).
+ * @param y0 Estado (theta, omega) em t0.
+ * @param y1 Estado (theta, omega) em t1; omega deve trocar de sinal entre y0 e y1.
+ */
+double pendulo_crossing_time(double t0, const double y0[], double t1, const double y1[]);
+
+// Avaliações de f feitas por pendulo_crossing_time (as derivadas nas duas pontas do passo).
+#define PENDULO_CROSSING_EVALS 2
+
 /**
  * @brief Calcula o período analítico para pequenas oscilações.
  */
 double analytic_period();
 
 /**
- * @brief Detecta o período numérico usando passo constante h.
+ * @brief Período exato para amplitude theta0 (sem aproximação de pequenos ângulos):
+ *        T = 4 sqrt(L/G) K(sin(theta0/2)), com a integral elíptica completa K calculada
+ *        pela média aritmético-geométrica (convergência quadrática, ~5 iterações).
+ */
+double exact_period(double theta0);
+
+// Faixa coberta pela tabela de exact_period_lookup; fora dela a consulta recai no AGM.
+#define PERIOD_TABLE_MAX 3.1
+
+/**
+ * @brief Pré-calcula a tabela de exact_period_lookup com n_points pontos em [0, PERIOD_TABLE_MAX].
+ *        Deve ser chamada antes de consultas concorrentes (a tabela é global).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int exact_period_table_init(int n_points);
+
+/**
+ * @brief Período exato por interpolação cúbica na tabela pré-calculada (O(1)).
+ *        Recai em exact_period se a tabela não foi criada ou theta0 está fora da faixa.
+ */
+double exact_period_lookup(double theta0);
+
+// Integradores de passo fixo disponíveis para a detecção de período.
+typedef enum {
+    PENDULO_FIXED_RK4 = 0,  // RK4 clássico (4 avaliações de f por passo)
+    PENDULO_FIXED_VERLET,   // Störmer-Verlet, simplético de 2ª ordem (1 avaliação)
+    PENDULO_FIXED_YOSHIDA4, // Yoshida, simplético de 4ª ordem (3 avaliações)
+    PENDULO_FIXED_SUZUKI4,  // Suzuki, simplético de 4ª ordem (5 avaliações, constante de erro menor)
+    PENDULO_FIXED_YOSHIDA6, // Yoshida, simplético de 6ª ordem (7 avaliações)
+    PENDULO_FIXED_COUNT
+} pendulo_fixed_method;
+
+const char *pendulo_fixed_method_name(pendulo_fixed_method method);
+
+// Avaliações de f por passo do método.
+int pendulo_fixed_rhs_evals(pendulo_fixed_method method);
+
+/**
+ * @brief Energia por unidade de massa e comprimento^2: omega^2/2 + (G/L)(1 - cos theta).
+ */
+double pendulo_energy(const double y[]);
+
+/**
+ * @brief Detecta o período numérico com passo constante h e o integrador escolhido.
+ *        Os métodos simpléticos mantêm o erro de energia limitado, o que permite passos
+ *        bem maiores que o RK4 em simulações de muitos períodos.
+ * @param method Integrador de passo fixo.
+ * @param theta0 Ângulo inicial.
+ * @param h Tamanho do passo.
+ * @param num_periods Número de períodos a simular.
+ * @param steps_out Ponteiro para armazenar o número total de passos.
+ * @param sink Destino das amostras (t, theta[, omega]) de cada passo (pode ser NULL).
+ * @param stats Estatísticas da integração (pode ser NULL).
+ * @return O período médio calculado ao longo de num_periods.
+ */
+double detect_period_fixed(pendulo_fixed_method method, double theta0, double h, int num_periods,
+                           int *steps_out, traj_sink *sink, rk_stats *stats);
+
+/**
+ * @brief Detecta o período numérico usando passo constante h (RK4; ver detect_period_fixed).
  * @param theta0 Ângulo inicial.
  * @param h Tamanho do passo.
  * @param num_periods Número de períodos a simular.
  * @param steps_out Ponteiro para armazenar o número total de passos.
- * @param outfile Ponteiro de arquivo para salvar dados de theta vs t (pode ser NULL).
+ * @param sink Destino das amostras (t, theta) de cada passo, com n_cols = 2 (pode ser NULL).
+ * @param stats Estatísticas da integração, incluindo as avaliações de f na localização
+ *              dos cruzamentos (pode ser NULL).
  * @return O período médio calculado ao longo de num_periods.
  */
-double detect_period_constant(double theta0, double h, int num_periods, int *steps_out, FILE* outfile);
+double detect_period_constant(double theta0, double h, int num_periods, int *steps_out, traj_sink *sink,
+                              rk_stats *stats);
 
 /**
- * @brief Detecta o período numérico usando passo adaptativo.
+ * @brief Detecta o período numérico usando passo adaptativo (método de rk_set_adaptive_method).
  * @param theta0 Ângulo inicial.
  * @param tol Tolerância de erro.
- * @param h_initial Tamanho inicial do passo.
+ * @param h_initial Tamanho inicial do passo (<= 0: estimado com rk_initial_step).
  * @param num_periods Número de períodos a simular.
  * @param T_num_out Ponteiro para armazenar o período médio final.
  * @param steps_out Ponteiro para armazenar o número total de passos.
- * @param outfile Ponteiro de arquivo para salvar dados de theta vs t (pode ser NULL).
+ * @param sink Destino das amostras (t, theta) de cada passo, com n_cols = 2 (pode ser NULL).
+ * @param stats Estatísticas da integração, com os passos rejeitados (pode ser NULL).
  * @return 1 em caso de sucesso, 0 em caso de falha.
  */
-int detect_period_adaptive(double theta0, double tol, double h_initial, int num_periods, double *T_num_out, int *steps_out, FILE* outfile);
+int detect_period_adaptive(double theta0, double tol, double h_initial, int num_periods, double *T_num_out, int *steps_out, traj_sink *sink,
+                           rk_stats *stats);
+
+// Um cruzamento de omega por zero, com o custo acumulado desde t = 0 até o passo que o contém.
+typedef struct {
+    double t;       // Instante do cruzamento (Hermite + Brent)
+    int steps;      // Passos aceitos até aqui
+    rk_stats stats; // Estatísticas acumuladas até aqui (sem ciclos)
+} pendulo_crossing;
+
+/*
+ * Detecção de período que pode ser continuada. O run guarda o estado no fim do último
+ * passo (checkpoint: t, y, o próximo h e o controlador PI) e todos os cruzamentos, então
+ * pedir mais períodos continua de onde parou em vez de recomeçar em t = 0. O resultado é
+ * o mesmo de uma integração única até 2 * num_periods cruzamentos (nos pares com FSAL,
+ * retomar em outra thread ou processo custa uma avaliação de f a mais). Um run só pode ser continuado com o mesmo
+ * método, h/tol e passo inicial com que começou.
+ */
+typedef struct {
+    double theta0;
+    double t, y[2];
+    double h;              // Próximo passo (adaptativo)
+    double accel;          // Aceleração em y (simpléticos)
+    rk_control_state ctl;  // Controlador PI (adaptativo)
+    int started;
+    int steps;
+    rk_stats stats;        // Acumuladas desde t = 0
+    int n_crossings;
+    int cap_crossings;
+    pendulo_crossing *crossings;
+} pendulo_period_run;
+
+void pendulo_period_run_init(pendulo_period_run *run, double theta0);
+void pendulo_period_run_free(pendulo_period_run *run);
+
+/**
+ * @brief Cópia independente de src (inclusive os cruzamentos).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int pendulo_period_run_copy(pendulo_period_run *dst, const pendulo_period_run *src);
+
+/**
+ * @brief Acrescenta a run o cruzamento seguinte, com os passos e as estatísticas acumulados
+ *        até o passo que o contém (para integradores fora de pendulo.c, como os de ensemble.h).
+ * @return 1 em caso de sucesso, 0 em caso de falha (sem memória).
+ */
+int pendulo_period_run_add_crossing(pendulo_period_run *run, double t_cross, int steps,
+                                    const rk_stats *stats);
+
+/**
+ * @brief Continua run até 2 * num_periods cruzamentos com passo constante h.
+ * @param sink Recebe só as amostras dos passos novos (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 em caso de falha (sem memória para os cruzamentos).
+ */
+int detect_period_fixed_resume(pendulo_fixed_method method, pendulo_period_run *run, double h,
+                               int num_periods, traj_sink *sink);
+
+/**
+ * @brief Continua run até 2 * num_periods cruzamentos com o integrador adaptativo.
+ * @param h_initial Passo inicial, usado só se o run ainda não começou (<= 0: estimado).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int detect_period_adaptive_resume(pendulo_period_run *run, double tol, double h_initial,
+                                  int num_periods, traj_sink *sink);
+
+/**
+ * @brief Período médio dos num_periods primeiros períodos de run e o custo até eles
+ *        (os mesmos valores que a detecção de num_periods períodos a partir de t = 0 daria).
+ * @param steps_out Passos aceitos (pode ser NULL).
+ * @param stats Estatísticas (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 se run ainda não tem 2 * num_periods cruzamentos.
+ */
+int pendulo_period_run_result(const pendulo_period_run *run, int num_periods, double *T_num_out,
+                              int *steps_out, rk_stats *stats);
 
 
 #endif
\ No newline at end of file
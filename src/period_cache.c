@@ -0,0 +1,601 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ensemble.h"
+#include "period_cache.h"
+#include "rk.h"
+
+// Métodos adaptativos ficam depois dos de passo fixo no campo method da chave.
+#define PERIOD_CACHE_ADAPTIVE PENDULO_FIXED_COUNT
+
+typedef struct
+{
+    int32_t model;
+    int32_t method;   // pendulo_fixed_method, ou PERIOD_CACHE_ADAPTIVE + rk_method
+    double theta0;
+    double param;     // h (passo fixo) ou tol (adaptativo)
+    double h_initial; // Passo inicial do adaptativo (0 no passo fixo)
+    uint64_t variant; // Impressão digital da configuração global
+} cache_key;
+
+typedef struct
+{
+    cache_key key;
+    pendulo_period_run run;
+} cache_entry;
+
+struct period_cache
+{
+    pthread_mutex_t lock;
+    cache_entry *entries;
+    int n_entries;
+    int capacity;
+    int *slots;   // Tabela de dispersão (endereçamento aberto): índice da entrada + 1, 0 = vazio
+    int n_slots;  // Potência de 2, pelo menos o dobro de capacity
+    period_cache_counters counters;
+};
+
+period_cache *period_cache_create(void)
+{
+    period_cache *cache = calloc(1, sizeof(period_cache));
+    if (!cache)
+        return NULL;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+void period_cache_destroy(period_cache *cache)
+{
+    if (!cache)
+        return;
+    for (int i = 0; i < cache->n_entries; ++i)
+        pendulo_period_run_free(&cache->entries[i].run);
+    free(cache->entries);
+    free(cache->slots);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/* --------------------------------------------------------------- chaves */
+
+// FNV-1a sobre os bytes de um valor.
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Configuração global que muda a trajetória: seno das derivadas e, no adaptativo, o controle de erro.
+static uint64_t config_variant(int adaptive)
+{
+    uint64_t hash = 14695981039346656037ull;
+    int32_t acc = pendulo_get_sin_accuracy();
+    hash = fnv1a(hash, &acc, sizeof(acc));
+    if (adaptive)
+    {
+        const rk_error_control *c = rk_get_error_control();
+        int32_t mode = c->mode;
+        double params[5] = { c->safety, c->fac_min, c->fac_max, c->alpha, c->beta };
+        hash = fnv1a(hash, &mode, sizeof(mode));
+        hash = fnv1a(hash, params, sizeof(params));
+    }
+    return hash;
+}
+
+// 1 se o código foi compilado com contração de a * b + c em FMA (-ffp-contract=fast).
+static int fp_contracted(void)
+{
+    // a * a = 1 + 2^-26 + 2^-54: o último termo se perde no produto arredondado, mas não no FMA
+    volatile double a = 1.0 + 0x1p-27, c = -(1.0 + 0x1p-26);
+    double x = a, y = c;
+    return x * x + y != 0.0;
+}
+
+uint64_t period_cache_build_id(void)
+{
+    int32_t build[6] = {
+        PERIOD_CACHE_NUMERICS_VERSION,
+        RK_STATS_ENABLED,
+#ifdef RK_ENABLE_CYCLES
+        1,
+#else
+        0,
+#endif
+        PENDULO_SIN_ACCURACY,
+#ifdef __FAST_MATH__
+        1,
+#else
+        0,
+#endif
+        fp_contracted(),
+    };
+    return fnv1a(14695981039346656037ull, build, sizeof(build));
+}
+
+static int key_equal(const cache_key *a, const cache_key *b)
+{
+    return a->model == b->model && a->method == b->method && a->theta0 == b->theta0 &&
+           a->param == b->param && a->h_initial == b->h_initial && a->variant == b->variant;
+}
+
+// Dispersão compatível com key_equal (+0.0 e -0.0 são a mesma chave).
+static uint64_t key_hash(const cache_key *key)
+{
+    double values[3] = { key->theta0 + 0.0, key->param + 0.0, key->h_initial + 0.0 };
+    uint64_t hash = fnv1a(14695981039346656037ull, &key->model, sizeof(key->model));
+    hash = fnv1a(hash, &key->method, sizeof(key->method));
+    hash = fnv1a(hash, values, sizeof(values));
+    return fnv1a(hash, &key->variant, sizeof(key->variant));
+}
+
+// Posição da chave na tabela: a da entrada com a chave, ou a vaga onde ela entraria.
+static int find_slot(const period_cache *cache, const cache_key *key)
+{
+    unsigned mask = (unsigned)cache->n_slots - 1;
+    unsigned s = (unsigned)key_hash(key) & mask;
+    while (cache->slots[s] && !key_equal(&cache->entries[cache->slots[s] - 1].key, key))
+        s = (s + 1) & mask;
+    return (int)s;
+}
+
+// Entrada com a chave, ou NULL (chamar com o lock).
+static cache_entry *find_entry(period_cache *cache, const cache_key *key)
+{
+    if (cache->n_slots == 0)
+        return NULL;
+    int slot = cache->slots[find_slot(cache, key)];
+    return slot ? &cache->entries[slot - 1] : NULL;
+}
+
+// Aumenta o vetor de entradas e refaz a tabela com o dobro do tamanho (chamar com o lock).
+static int grow_entries(period_cache *cache)
+{
+    int capacity = cache->capacity ? 2 * cache->capacity : 16;
+    int n_slots = 2 * capacity;
+    cache_entry *grown = realloc(cache->entries, capacity * sizeof(cache_entry));
+    if (!grown)
+        return 0;
+    cache->entries = grown;
+    int *slots = calloc(n_slots, sizeof(int));
+    if (!slots)
+        return 0;
+    cache->capacity = capacity;
+    free(cache->slots);
+    cache->slots = slots;
+    cache->n_slots = n_slots;
+    for (int i = 0; i < cache->n_entries; ++i)
+        cache->slots[find_slot(cache, &cache->entries[i].key)] = i + 1;
+    return 1;
+}
+
+/**
+ * @brief Guarda run na entrada da chave (chamar com o lock). O cache passa a ser dono de
+ *        run; se a entrada existente já foi mais longe, run é descartado.
+ */
+static int store_entry(period_cache *cache, const cache_key *key, pendulo_period_run *run)
+{
+    cache_entry *entry = find_entry(cache, key);
+    if (entry)
+    {
+        if (entry->run.n_crossings >= run->n_crossings)
+        {
+            pendulo_period_run_free(run);
+            return 1;
+        }
+        pendulo_period_run_free(&entry->run);
+        entry->run = *run;
+        return 1;
+    }
+    if (cache->n_entries == cache->capacity && !grow_entries(cache))
+    {
+        pendulo_period_run_free(run);
+        return 0;
+    }
+    cache->entries[cache->n_entries].key = *key;
+    cache->entries[cache->n_entries].run = *run;
+    cache->n_entries++;
+    cache->slots[find_slot(cache, key)] = cache->n_entries;
+    return 1;
+}
+
+/* ------------------------------------------------------------- consultas */
+
+// Responde do cache, ou continua/começa a integração fora do lock e guarda o resultado.
+static int cache_query(period_cache *cache, const cache_key *key, int num_periods,
+                       double *T_num_out, int *steps_out, rk_stats *stats)
+{
+    pendulo_period_run run;
+    int ok;
+
+    if (num_periods <= 0)
+        return 0;
+
+    pthread_mutex_lock(&cache->lock);
+    cache->counters.queries++;
+    cache_entry *entry = find_entry(cache, key);
+    if (entry && pendulo_period_run_result(&entry->run, num_periods, T_num_out, steps_out, stats))
+    {
+        cache->counters.hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return 1;
+    }
+    if (entry)
+    {
+        if (!pendulo_period_run_copy(&run, &entry->run))
+        {
+            pthread_mutex_unlock(&cache->lock);
+            return 0;
+        }
+        cache->counters.resumes++;
+    }
+    else
+    {
+        pendulo_period_run_init(&run, key->theta0);
+        cache->counters.misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (key->method < PERIOD_CACHE_ADAPTIVE)
+        ok = detect_period_fixed_resume((pendulo_fixed_method)key->method, &run, key->param, num_periods, NULL);
+    else
+        ok = detect_period_adaptive_resume(&run, key->param, key->h_initial, num_periods, NULL);
+    ok = ok && pendulo_period_run_result(&run, num_periods, T_num_out, steps_out, stats);
+    if (!ok)
+    {
+        pendulo_period_run_free(&run);
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    store_entry(cache, key, &run);
+    pthread_mutex_unlock(&cache->lock);
+    return 1;
+}
+
+int period_cache_fixed(period_cache *cache, pendulo_fixed_method method, double theta0, double h,
+                       int num_periods, double *T_num_out, int *steps_out, rk_stats *stats)
+{
+    if (method < 0 || method >= PENDULO_FIXED_COUNT)
+        return 0;
+    if (!cache)
+    {
+        int steps;
+        *T_num_out = detect_period_fixed(method, theta0, h, num_periods, &steps, NULL, stats);
+        if (steps_out)
+            *steps_out = steps;
+        return 1;
+    }
+    cache_key key = { PERIOD_CACHE_MODEL_PENDULO, method, theta0, h, 0.0, config_variant(0) };
+    return cache_query(cache, &key, num_periods, T_num_out, steps_out, stats);
+}
+
+int period_cache_adaptive(period_cache *cache, double theta0, double tol, double h_initial,
+                          int num_periods, double *T_num_out, int *steps_out, rk_stats *stats)
+{
+    const rk_error_control *control = rk_get_error_control();
+    if (!cache || control->atol || control->rtol)
+    {
+        // Vetores de tolerância não entram na chave: integra sem o cache
+        int steps;
+        if (cache)
+        {
+            pthread_mutex_lock(&cache->lock);
+            cache->counters.queries++;
+            cache->counters.bypassed++;
+            pthread_mutex_unlock(&cache->lock);
+        }
+        detect_period_adaptive(theta0, tol, h_initial, num_periods, T_num_out, &steps, NULL, stats);
+        if (steps_out)
+            *steps_out = steps;
+        return 1;
+    }
+    cache_key key = { PERIOD_CACHE_MODEL_PENDULO, PERIOD_CACHE_ADAPTIVE + rk_get_adaptive_method(), theta0,
+                      tol, h_initial > 0.0 ? h_initial : 0.0, config_variant(1) };
+    return cache_query(cache, &key, num_periods, T_num_out, steps_out, stats);
+}
+
+// Integra em lote n runs recém-iniciados com o método e o parâmetro da chave (ensemble.h).
+typedef int (*batch_fill)(pendulo_period_run runs[], int n, const cache_key *key, int num_periods);
+
+static int fill_fixed(pendulo_period_run runs[], int n, const cache_key *key, int num_periods)
+{
+    return detect_period_constant_batch_runs(runs, n, key->param, num_periods);
+}
+
+static int fill_adaptive(pendulo_period_run runs[], int n, const cache_key *key, int num_periods)
+{
+    return detect_period_adaptive_batch_runs(runs, n, key->param, key->h_initial, num_periods);
+}
+
+/**
+ * @brief cache_query para n chaves que só diferem em theta0: as entradas completas respondem
+ *        direto, as incompletas continuam uma a uma e as que faltam são integradas juntas por
+ *        fill. Sem cache (NULL), todas são integradas por fill.
+ */
+static int cache_query_batch(period_cache *cache, const cache_key keys[], int n, int num_periods,
+                             batch_fill fill, double T_out[], int steps_out[], rk_stats stats_out[])
+{
+    if (n <= 0 || num_periods <= 0)
+        return 0;
+    pendulo_period_run *runs = malloc(n * sizeof(pendulo_period_run));
+    int *index = malloc(2 * n * sizeof(int));
+    if (!runs || !index)
+    {
+        free(runs);
+        free(index);
+        return 0;
+    }
+    int *resume = index + n;
+    int n_miss = 0, n_resume = 0;
+
+    if (cache)
+        pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < n; ++i)
+    {
+        cache_entry *entry = cache ? find_entry(cache, &keys[i]) : NULL;
+        if (entry && pendulo_period_run_result(&entry->run, num_periods, &T_out[i],
+                                               steps_out ? &steps_out[i] : NULL,
+                                               stats_out ? &stats_out[i] : NULL))
+        {
+            cache->counters.queries++;
+            cache->counters.hits++;
+        }
+        else if (entry)
+        {
+            resume[n_resume++] = i; // Contada por cache_query
+        }
+        else
+        {
+            if (cache)
+            {
+                cache->counters.queries++;
+                cache->counters.misses++;
+            }
+            pendulo_period_run_init(&runs[n_miss], keys[i].theta0);
+            index[n_miss++] = i;
+        }
+    }
+    if (cache)
+        pthread_mutex_unlock(&cache->lock);
+
+    int ok = n_miss == 0 || fill(runs, n_miss, &keys[index[0]], num_periods);
+    for (int k = 0; k < n_miss; ++k)
+    {
+        int i = index[k];
+        ok = ok && pendulo_period_run_result(&runs[k], num_periods, &T_out[i],
+                                             steps_out ? &steps_out[i] : NULL,
+                                             stats_out ? &stats_out[i] : NULL);
+        if (ok && cache)
+        {
+            pthread_mutex_lock(&cache->lock);
+            store_entry(cache, &keys[i], &runs[k]);
+            pthread_mutex_unlock(&cache->lock);
+        }
+        else
+        {
+            pendulo_period_run_free(&runs[k]);
+        }
+    }
+    for (int k = 0; ok && k < n_resume; ++k)
+    {
+        int i = resume[k];
+        ok = cache_query(cache, &keys[i], num_periods, &T_out[i], steps_out ? &steps_out[i] : NULL,
+                         stats_out ? &stats_out[i] : NULL);
+    }
+    free(runs);
+    free(index);
+    return ok;
+}
+
+int period_cache_fixed_batch(period_cache *cache, const double theta0[], int n, double h, int num_periods,
+                             double T_out[], int steps_out[], rk_stats stats_out[])
+{
+    cache_key *keys = malloc((n > 0 ? n : 1) * sizeof(cache_key));
+    if (!keys)
+        return 0;
+    uint64_t variant = config_variant(0);
+    for (int i = 0; i < n; ++i)
+    {
+        cache_key key = { PERIOD_CACHE_MODEL_PENDULO, PENDULO_FIXED_RK4, theta0[i], h, 0.0, variant };
+        keys[i] = key;
+    }
+    int ok = cache_query_batch(cache, keys, n, num_periods, fill_fixed, T_out, steps_out, stats_out);
+    free(keys);
+    return ok;
+}
+
+int period_cache_adaptive_batch(period_cache *cache, const double theta0[], int n, double tol,
+                                double h_initial, int num_periods, double T_out[], int steps_out[],
+                                rk_stats stats_out[])
+{
+    const rk_error_control *control = rk_get_error_control();
+    if (rk_get_adaptive_method() != RK_METHOD_RK4_DOUBLING || control->atol || control->rtol)
+    {
+        // O lote adaptativo só implementa o passo dobrado com tolerância escalar
+        for (int i = 0; i < n; ++i)
+        {
+            if (!period_cache_adaptive(cache, theta0[i], tol, h_initial, num_periods, &T_out[i],
+                                       steps_out ? &steps_out[i] : NULL, stats_out ? &stats_out[i] : NULL))
+                return 0;
+        }
+        return n > 0;
+    }
+    cache_key *keys = malloc((n > 0 ? n : 1) * sizeof(cache_key));
+    if (!keys)
+        return 0;
+    uint64_t variant = config_variant(1);
+    for (int i = 0; i < n; ++i)
+    {
+        cache_key key = { PERIOD_CACHE_MODEL_PENDULO, PERIOD_CACHE_ADAPTIVE + RK_METHOD_RK4_DOUBLING, theta0[i],
+                          tol, h_initial > 0.0 ? h_initial : 0.0, variant };
+        keys[i] = key;
+    }
+    int ok = cache_query_batch(cache, keys, n, num_periods, fill_adaptive, T_out, steps_out, stats_out);
+    free(keys);
+    return ok;
+}
+
+void period_cache_get_counters(period_cache *cache, period_cache_counters *out)
+{
+    pthread_mutex_lock(&cache->lock);
+    *out = cache->counters;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int period_cache_size(period_cache *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    int n = cache->n_entries;
+    pthread_mutex_unlock(&cache->lock);
+    return n;
+}
+
+/* ----------------------------------------------------------- persistência */
+
+// Campos do checkpoint, na ordem do arquivo.
+typedef struct
+{
+    double t, y[2], h, accel;
+    double log_err_prev;
+    int32_t last_rejected;
+    int32_t started;
+    int32_t steps;
+    int32_t n_crossings;
+    rk_stats stats;
+} cache_checkpoint;
+
+static int write_entry(FILE *fp, const cache_entry *entry)
+{
+    const pendulo_period_run *run = &entry->run;
+    cache_checkpoint cp = {
+        run->t, { run->y[0], run->y[1] }, run->h, run->accel, run->ctl.log_err_prev,
+        run->ctl.last_rejected, run->started, run->steps, run->n_crossings, run->stats
+    };
+    memset(cp.stats.cycles, 0, sizeof(cp.stats.cycles));
+    return fwrite(&entry->key, sizeof(cache_key), 1, fp) == 1 &&
+           fwrite(&cp, sizeof(cp), 1, fp) == 1 &&
+           fwrite(run->crossings, sizeof(pendulo_crossing), run->n_crossings, fp) == (size_t)run->n_crossings;
+}
+
+static int read_entry(FILE *fp, cache_key *key, pendulo_period_run *run)
+{
+    cache_checkpoint cp;
+    if (fread(key, sizeof(cache_key), 1, fp) != 1 || fread(&cp, sizeof(cp), 1, fp) != 1)
+        return 0;
+    if (cp.n_crossings < 0 || key->model < 0 || key->model >= PERIOD_CACHE_MODEL_COUNT)
+        return 0;
+
+    pendulo_period_run_init(run, key->theta0);
+    if (cp.n_crossings > 0)
+    {
+        run->crossings = malloc(cp.n_crossings * sizeof(pendulo_crossing));
+        if (!run->crossings ||
+            fread(run->crossings, sizeof(pendulo_crossing), cp.n_crossings, fp) != (size_t)cp.n_crossings)
+        {
+            pendulo_period_run_free(run);
+            return 0;
+        }
+    }
+    run->t = cp.t;
+    run->y[0] = cp.y[0];
+    run->y[1] = cp.y[1];
+    run->h = cp.h;
+    run->accel = cp.accel;
+    run->ctl.log_err_prev = cp.log_err_prev;
+    run->ctl.last_rejected = cp.last_rejected;
+    run->started = cp.started;
+    run->steps = cp.steps;
+    run->stats = cp.stats;
+    run->n_crossings = run->cap_crossings = cp.n_crossings;
+    return 1;
+}
+
+int period_cache_load(period_cache *cache, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    char magic[8];
+    uint32_t version, n_entries, stats_size, crossing_size;
+    double g, l;
+    uint64_t build;
+    int loaded = 0;
+
+    if (!fp)
+        return -1;
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, PERIOD_CACHE_MAGIC, 8) != 0 ||
+        fread(&version, sizeof(version), 1, fp) != 1 || version != PERIOD_CACHE_VERSION ||
+        fread(&n_entries, sizeof(n_entries), 1, fp) != 1 ||
+        fread(&stats_size, sizeof(stats_size), 1, fp) != 1 || stats_size != sizeof(rk_stats) ||
+        fread(&crossing_size, sizeof(crossing_size), 1, fp) != 1 || crossing_size != sizeof(pendulo_crossing) ||
+        fread(&g, sizeof(g), 1, fp) != 1 || g != G || fread(&l, sizeof(l), 1, fp) != 1 || l != L ||
+        fread(&build, sizeof(build), 1, fp) != 1 || build != period_cache_build_id())
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    for (uint32_t i = 0; i < n_entries; ++i)
+    {
+        cache_key key;
+        pendulo_period_run run;
+        if (!read_entry(fp, &key, &run))
+            break; // Arquivo truncado: fica o que foi lido
+        if (!store_entry(cache, &key, &run))
+            break;
+        loaded++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    fclose(fp);
+    return loaded;
+}
+
+int period_cache_save(period_cache *cache, const char *path)
+{
+    char tmp_path[1024];
+    char magic[8] = PERIOD_CACHE_MAGIC;
+    uint32_t version = PERIOD_CACHE_VERSION;
+    uint32_t stats_size = sizeof(rk_stats);
+    uint32_t crossing_size = sizeof(pendulo_crossing);
+    double g = G, l = L;
+    uint64_t build = period_cache_build_id();
+    int ok;
+
+    // Temporário por processo: vários processos (shards) podem gravar o mesmo cache
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid()) >= (int)sizeof(tmp_path))
+        return 0;
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp)
+        return 0;
+
+    pthread_mutex_lock(&cache->lock);
+    uint32_t n_entries = (uint32_t)cache->n_entries;
+    ok = fwrite(magic, 1, 8, fp) == 8 &&
+         fwrite(&version, sizeof(version), 1, fp) == 1 &&
+         fwrite(&n_entries, sizeof(n_entries), 1, fp) == 1 &&
+         fwrite(&stats_size, sizeof(stats_size), 1, fp) == 1 &&
+         fwrite(&crossing_size, sizeof(crossing_size), 1, fp) == 1 &&
+         fwrite(&g, sizeof(g), 1, fp) == 1 &&
+         fwrite(&l, sizeof(l), 1, fp) == 1 &&
+         fwrite(&build, sizeof(build), 1, fp) == 1;
+    for (int i = 0; ok && i < cache->n_entries; ++i)
+        ok = write_entry(fp, &cache->entries[i]);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (fclose(fp) != 0)
+        ok = 0;
+    if (!ok || rename(tmp_path, path) != 0)
+    {
+        remove(tmp_path);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,139 @@
+#ifndef PERIOD_CACHE_H
+#define PERIOD_CACHE_H
+
+#include <stdint.h>
+
+#include "pendulo.h"
+#include "rk_stats.h"
+
+/*
+ * Cache de períodos compartilhado pelas análises. Cada entrada é identificada por
+ * (modelo, theta0, método, h ou tol, passo inicial) e por uma impressão digital da
+ * configuração global que muda a trajetória (precisão do seno, controle de erro), e
+ * guarda um pendulo_period_run: todos os cruzamentos de omega já encontrados, com o
+ * custo acumulado até cada um, e o estado no fim do último passo.
+ *
+ * Um pedido de num_periods períodos é respondido sem integrar nada se a entrada já tem
+ * 2 * num_periods cruzamentos; se tem menos, a integração continua do checkpoint em vez
+ * de recomeçar em t = 0. Os resultados (período, passos, avaliações de f) são os mesmos
+ * da detecção direta; as estatísticas devolvidas não têm contagem de ciclos.
+ *
+ * As consultas podem ser feitas de várias threads: a integração roda fora do lock, e se
+ * duas threads estenderem a mesma entrada fica a que chegou mais longe. As entradas são
+ * encontradas por uma tabela de dispersão sobre a chave, então o custo de uma consulta não
+ * cresce com o tamanho do cache.
+ *
+ * Formato do arquivo (little-endian):
+ *   0  char[8]   magic "PENDPCH\0"
+ *   8  uint32    versão (PERIOD_CACHE_VERSION)
+ *   12 uint32    número de entradas
+ *   16 uint32    sizeof(rk_stats)
+ *   20 uint32    sizeof(pendulo_crossing)
+ *   24 float64   G
+ *   32 float64   L
+ *   40 uint64    impressão digital da compilação (period_cache_build_id)
+ *   48 entradas: chave, checkpoint e os cruzamentos (pendulo_crossing)
+ * Arquivos de outra versão, de outro layout das estruturas, de outras constantes físicas
+ * ou de outra compilação são ignorados.
+ */
+
+#define PERIOD_CACHE_MAGIC "PENDPCH"
+#define PERIOD_CACHE_VERSION 2
+
+// Versão da numérica dos integradores e do pêndulo. Incrementar sempre que uma mudança no
+// código alterar trajetórias, passos ou contadores, para que os caches gravados antes dela
+// sejam descartados.
+#define PERIOD_CACHE_NUMERICS_VERSION 1
+
+// Modelos com entradas no cache.
+typedef enum
+{
+    PERIOD_CACHE_MODEL_PENDULO = 0, // Pêndulo simples (pendulo.h)
+    PERIOD_CACHE_MODEL_COUNT
+} period_cache_model;
+
+typedef struct period_cache period_cache;
+
+typedef struct
+{
+    long queries;  // Consultas
+    long hits;     // Respondidas sem integrar
+    long resumes;  // Continuadas a partir de um checkpoint
+    long misses;   // Integradas desde t = 0
+    long bypassed; // Fora do cache (tolerâncias por componente em rk_set_error_control)
+} period_cache_counters;
+
+/**
+ * @brief Cria um cache vazio.
+ * @return O cache, ou NULL em caso de falha.
+ */
+period_cache *period_cache_create(void);
+void period_cache_destroy(period_cache *cache);
+
+/**
+ * @brief Acrescenta ao cache as entradas gravadas em path.
+ * @return Número de entradas lidas, ou -1 se o arquivo não existe ou não é compatível.
+ */
+int period_cache_load(period_cache *cache, const char *path);
+
+/**
+ * @brief Grava todas as entradas em path (num arquivo temporário renomeado no fim, então
+ *        uma gravação interrompida não corrompe o cache anterior). Se vários processos gravam
+ *        o mesmo caminho, fica o cache do último.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int period_cache_save(period_cache *cache, const char *path);
+
+/**
+ * @brief Equivalente a detect_period_fixed, consultando e estendendo o cache.
+ * @param cache O cache (NULL: integra diretamente).
+ * @param steps_out Passos aceitos (pode ser NULL).
+ * @param stats Estatísticas da integração (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int period_cache_fixed(period_cache *cache, pendulo_fixed_method method, double theta0, double h,
+                       int num_periods, double *T_num_out, int *steps_out, rk_stats *stats);
+
+/**
+ * @brief Equivalente a detect_period_adaptive (método e controle de erro globais),
+ *        consultando e estendendo o cache.
+ * @param h_initial Passo inicial (<= 0: estimado); faz parte da chave.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int period_cache_adaptive(period_cache *cache, double theta0, double tol, double h_initial,
+                          int num_periods, double *T_num_out, int *steps_out, rk_stats *stats);
+
+/**
+ * @brief period_cache_fixed com PENDULO_FIXED_RK4 para n ângulos. As entradas que faltam
+ *        são integradas juntas pelo kernel em lote (detect_period_constant_batch_runs), com o
+ *        mesmo resultado das consultas uma a uma; sem cache (NULL), todos os ângulos são.
+ * @param steps_out Passos aceitos de cada ângulo (pode ser NULL).
+ * @param stats_out Estatísticas de cada ângulo (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int period_cache_fixed_batch(period_cache *cache, const double theta0[], int n, double h, int num_periods,
+                             double T_out[], int steps_out[], rk_stats stats_out[]);
+
+/**
+ * @brief period_cache_adaptive para n ângulos, com as faltas integradas por
+ *        detect_period_adaptive_batch_runs. Com outro método adaptativo ou com tolerâncias
+ *        por componente, consulta ângulo a ângulo.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int period_cache_adaptive_batch(period_cache *cache, const double theta0[], int n, double tol,
+                                double h_initial, int num_periods, double T_out[], int steps_out[],
+                                rk_stats stats_out[]);
+
+/**
+ * @brief Impressão digital da compilação que produz os resultados: PERIOD_CACHE_NUMERICS_VERSION,
+ *        coleta de estatísticas (RK_STATS_ENABLED; sem ela rhs_evals é sempre 0) e de ciclos,
+ *        precisão inicial do seno (PENDULO_SIN_ACCURACY), -ffast-math e contração em FMA.
+ */
+uint64_t period_cache_build_id(void);
+
+void period_cache_get_counters(period_cache *cache, period_cache_counters *out);
+
+// Número de entradas no cache.
+int period_cache_size(period_cache *cache);
+
+#endif
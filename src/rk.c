@@ -2,10 +2,258 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#include "rk.h"
+
+#ifdef RK_ENABLE_STATS
+static _Thread_local int last_step_evals;
+#define SET_LAST_STEP_EVALS(n) (last_step_evals = (n))
+#else
+#define SET_LAST_STEP_EVALS(n) ((void)0)
+#endif
+
+int rk_last_step_evals(void)
+{
+#ifdef RK_ENABLE_STATS
+    return last_step_evals;
+#else
+    return 0;
+#endif
+}
+
+#define RK_MAX_STAGES 7
+
+/*
+ * Workspace: todos os vetores temporários dos steppers num único bloco alinhado,
+ * com um buffer de n_eq doubles (arredondado para a linha de cache) por papel.
+ * Os papéis do RK4 e os do par embutido se sobrepõem porque nunca são usados juntos.
+ */
+enum
+{
+    WS_K1 = 0, WS_K2, WS_K3, WS_K4, WS_Y_TEMP, // rk4_single_step_system
+    WS_Y1, WS_Y2_HALF1, WS_Y2,                 // passo dobrado (em cima dos do RK4)
+    WS_STAGE0 = 0,                             // par embutido: k[0..RK_MAX_STAGES-1]
+    WS_Y_STAGE = RK_MAX_STAGES, WS_Y_NEW,
+    WS_Y,                                      // RungeKutta_system_adaptive_h_ws
+    WS_FSAL_Y, WS_FSAL_DYDT,                   // cache FSAL
+    WS_DENSE,                                  // rk_locate_event: estado interpolado
+    WS_N_BUFFERS
+};
+
+#define RK_WS_ALIGN 64
+#define RK_WS_ALIGN_DOUBLES (RK_WS_ALIGN / sizeof(double))
+
+struct rk_workspace
+{
+    int capacity; // Maior n_eq suportado sem realocar
+    size_t stride; // Doubles entre buffers consecutivos
+    double *block;
+    // Última derivada calculada, reaproveitada como k1 se o passo seguinte começar
+    // exatamente no mesmo (t, y)
+    int fsal_valid;
+    int fsal_n_eq;
+    void (*fsal_f)(double, double[], double[]);
+    double fsal_t;
+    // Estado do controlador PI, válido para um passo que comece em ctl_t
+    rk_control_state ctl;
+    int ctl_valid;
+    int ctl_n_eq;
+    void (*ctl_f)(double, double[], double[]);
+    double ctl_t;
+};
+
+static inline double *ws_buf(rk_workspace *ws, int role)
+{
+    return ws->block + (size_t)role * ws->stride;
+}
+
+rk_workspace *rk_workspace_create(int n_eq)
+{
+    rk_workspace *ws = calloc(1, sizeof(rk_workspace));
+    if (!ws)
+        return NULL;
+    if (!rk_workspace_reserve(ws, n_eq > 0 ? n_eq : 1))
+    {
+        free(ws);
+        return NULL;
+    }
+    return ws;
+}
+
+void rk_workspace_destroy(rk_workspace *ws)
+{
+    if (!ws)
+        return;
+    free(ws->block);
+    free(ws);
+}
+
+int rk_workspace_reserve(rk_workspace *ws, int n_eq)
+{
+    if (n_eq <= ws->capacity)
+        return 1;
+    size_t stride = ((size_t)n_eq + RK_WS_ALIGN_DOUBLES - 1) / RK_WS_ALIGN_DOUBLES * RK_WS_ALIGN_DOUBLES;
+    double *block = aligned_alloc(RK_WS_ALIGN, WS_N_BUFFERS * stride * sizeof(double));
+    if (!block)
+        return 0;
+    free(ws->block);
+    ws->block = block;
+    ws->stride = stride;
+    ws->capacity = n_eq;
+    ws->fsal_valid = 0;
+    ws->ctl_valid = 0;
+    return 1;
+}
+
+int rk_workspace_capacity(const rk_workspace *ws)
+{
+    return ws->capacity;
+}
+
+// Workspace implícito das funções sem _ws: um por thread, crescendo sob demanda e
+// liberado quando a thread termina.
+static pthread_key_t thread_ws_key;
+static pthread_once_t thread_ws_once = PTHREAD_ONCE_INIT;
+static _Thread_local rk_workspace *thread_ws;
+
+static void thread_ws_destructor(void *ws)
+{
+    rk_workspace_destroy((rk_workspace *)ws);
+}
+
+static void thread_ws_key_init(void)
+{
+    pthread_key_create(&thread_ws_key, thread_ws_destructor);
+}
+
+static rk_workspace *thread_workspace(int n_eq)
+{
+    if (thread_ws && n_eq <= thread_ws->capacity)
+        return thread_ws;
+    if (!thread_ws)
+    {
+        pthread_once(&thread_ws_once, thread_ws_key_init);
+        thread_ws = rk_workspace_create(n_eq);
+        if (thread_ws)
+            pthread_setspecific(thread_ws_key, thread_ws);
+    }
+    else if (!rk_workspace_reserve(thread_ws, n_eq))
+    {
+        fprintf(stderr, "rk: sem memória para o workspace de %d equações\n", n_eq);
+        abort();
+    }
+    if (!thread_ws)
+    {
+        fprintf(stderr, "rk: sem memória para o workspace de %d equações\n", n_eq);
+        abort();
+    }
+    return thread_ws;
+}
+
+void rk_thread_workspace_release(void)
+{
+    if (!thread_ws)
+        return;
+    pthread_setspecific(thread_ws_key, NULL);
+    rk_workspace_destroy(thread_ws);
+    thread_ws = NULL;
+}
+
+static rk_error_control error_control = RK_ERROR_CONTROL_DEFAULT;
+
+void rk_set_error_control(const rk_error_control *control)
+{
+    error_control = *control;
+}
+
+const rk_error_control *rk_get_error_control(void)
+{
+    return &error_control;
+}
+
+void rk_control_state_reset(rk_control_state *state)
+{
+    state->log_err_prev = 0.0; // err_prev = 1: o primeiro passo usa só a parte I
+    state->last_rejected = 0;
+}
+
+double rk_error_norm(int n_eq, const double err[], const double y_old[], const double y_new[], double tol)
+{
+    const double *atol = error_control.atol, *rtol = error_control.rtol;
+    double acc = 0.0;
+    for (int i = 0; i < n_eq; ++i)
+    {
+        double a = atol ? atol[i] : tol;
+        double r = rtol ? rtol[i] : tol;
+        double q = err[i] / (a + r * fmax(fabs(y_old[i]), fabs(y_new[i])));
+        acc += q * q;
+    }
+    return sqrt(acc / n_eq);
+}
+
+double rk_control_factor(rk_control_state *state, double err, int error_order, int accepted)
+{
+    const rk_error_control *c = &error_control;
+    double k = error_order + 1;
+    double factor;
+
+    // Em escala logarítmica: uma log e uma exp por passo em vez de duas pow
+    double log_err = log(fmax(err, 1e-10));
+    if (err == 0.0)
+        factor = c->fac_max;
+    else if (accepted)
+        factor = c->safety * exp((c->beta * state->log_err_prev - c->alpha * log_err) / k);
+    else
+        factor = c->safety * exp(-log_err / k); // Rejeição: só a parte I, para reduzir h de imediato
+
+    // Depois de uma rejeição o passo não cresce, o que evita aceitar/rejeitar alternadamente
+    double upper = (accepted && !state->last_rejected) ? c->fac_max : 1.0;
+    factor = fmin(fmax(factor, c->fac_min), upper);
+
+    if (accepted)
+    {
+        state->log_err_prev = fmax(log_err, log(1e-4));
+        state->last_rejected = 0;
+    }
+    else
+    {
+        state->last_rejected = 1;
+    }
+    return factor;
+}
+
+double rk_default_h_min(double tol, double h_max)
+{
+    return (error_control.mode == RK_CONTROL_LEGACY) ? tol * 0.1 : h_max * 1e-12;
+}
+
+// Estado do controlador do workspace; recomeça se o passo não continua a integração anterior.
+static rk_control_state *ws_control(rk_workspace *ws, void (*f)(double, double[], double[]), int n_eq,
+                                    double t)
+{
+    if (!ws->ctl_valid || ws->ctl_f != f || ws->ctl_n_eq != n_eq || ws->ctl_t != t)
+    {
+        rk_control_state_reset(&ws->ctl);
+        ws->ctl_valid = 1;
+        ws->ctl_f = f;
+        ws->ctl_n_eq = n_eq;
+    }
+    return &ws->ctl;
+}
+
+rk_control_state *rk_adaptive_control(int n_eq, void (*f)(double, double[], double[]), double t)
+{
+    rk_workspace *ws = thread_workspace(n_eq);
+    rk_control_state *ctl = ws_control(ws, f, n_eq, t);
+    ws->ctl_t = t;
+    return ctl;
+}
 
 /**
  * @brief Realiza um único passo do método Runge-Kutta de 4ª ordem para um sistema de EDOs.
  * y_out = y_in + resultado_do_passo_rk4
+ * @param ws Workspace com capacidade para n_eq equações.
  * @param t Tempo atual.
  * @param y_in Vetor do estado atual [y1, y2, ..., yn].
  * @param h Tamanho do passo.
@@ -13,12 +261,13 @@
  * @param f Ponteiro para a função de derivadas f(t, y, dydt).
  * @param y_out Vetor onde o resultado do passo y(t+h) será armazenado.
  */
-void rk4_single_step_system(double t, const double y_in[], double h, int n_eq,
-                            void (*f)(double, double[], double[]),
-                            double y_out[])
+void rk4_single_step_system_ws(rk_workspace *ws, double t, const double y_in[], double h, int n_eq,
+                               void (*f)(double, double[], double[]),
+                               double y_out[])
 {
-    double k1[n_eq], k2[n_eq], k3[n_eq], k4[n_eq];
-    double y_temp[n_eq];
+    double *k1 = ws_buf(ws, WS_K1), *k2 = ws_buf(ws, WS_K2);
+    double *k3 = ws_buf(ws, WS_K3), *k4 = ws_buf(ws, WS_K4);
+    double *y_temp = ws_buf(ws, WS_Y_TEMP);
     int i;
 
     // Calcular k1
@@ -52,9 +301,17 @@ void rk4_single_step_system(double t, const double y_in[], double h, int n_eq,
     }
 }
 
+void rk4_single_step_system(double t, const double y_in[], double h, int n_eq,
+                            void (*f)(double, double[], double[]),
+                            double y_out[])
+{
+    rk4_single_step_system_ws(thread_workspace(n_eq), t, y_in, h, n_eq, f, y_out);
+}
+
 /**
  * @brief Realiza um passo de integração com controle de erro para RK4 adaptativo.
  *        Baseado na estratégia de dobrar o passo.
+ * @param ws Workspace com capacidade para n_eq equações.
  * @param t_current Ponteiro para o tempo atual (será atualizado).
  * @param y_current Vetor do estado atual (será atualizado).
  * @param h_current Ponteiro para o tamanho do passo atual (será atualizado para o próximo passo).
@@ -65,25 +322,53 @@ void rk4_single_step_system(double t, const double y_in[], double h, int n_eq,
  * @param h_max Limite superior para o tamanho do passo.
  * @return 1 se o passo foi aceito, 0 se foi rejeitado (e h_current foi reduzido).
  */
-int rk_adaptive_one_step(
+int rk_adaptive_one_step_ws(
+    rk_workspace *ws,
     double *t_current, double y_current[], double *h_current, int n_eq,
     void (*f)(double, double[], double[]),
     double tol, double h_min, double h_max)
 {
-    double y1[n_eq];       // Resultado de um passo h
-    double y2_half1[n_eq]; // Resultado do primeiro meio passo (h/2)
-    double y2[n_eq];       // Resultado de dois meio passos (h/2 + h/2)
+    double *y1 = ws_buf(ws, WS_Y1);             // Resultado de um passo h
+    double *y2_half1 = ws_buf(ws, WS_Y2_HALF1); // Resultado do primeiro meio passo (h/2)
+    double *y2 = ws_buf(ws, WS_Y2);             // Resultado de dois meio passos (h/2 + h/2)
 
     double h = *h_current;
     int i;
 
     // 1. Calcular y1 (um passo de h)
-    rk4_single_step_system(*t_current, y_current, h, n_eq, f, y1);
+    rk4_single_step_system_ws(ws, *t_current, y_current, h, n_eq, f, y1);
 
     // 2. Calcular y2 (dois passos de h/2)
     double h_half = h / 2.0;
-    rk4_single_step_system(*t_current, y_current, h_half, n_eq, f, y2_half1);
-    rk4_single_step_system(*t_current + h_half, y2_half1, h_half, n_eq, f, y2);
+    rk4_single_step_system_ws(ws, *t_current, y_current, h_half, n_eq, f, y2_half1);
+    rk4_single_step_system_ws(ws, *t_current + h_half, y2_half1, h_half, n_eq, f, y2);
+    SET_LAST_STEP_EVALS(12);
+
+    if (error_control.mode == RK_CONTROL_PI)
+    {
+        // Erro local de cada componente (y_temp já não é usado pelos passos RK4)
+        double *err = ws_buf(ws, WS_Y_TEMP);
+        for (i = 0; i < n_eq; ++i)
+            err[i] = (y2[i] - y1[i]) / 15.0;
+        double error_norm = rk_error_norm(n_eq, err, y_current, y2, tol);
+        rk_control_state *ctl = ws_control(ws, f, n_eq, *t_current);
+        int accepted = error_norm <= 1.0 || h <= h_min * 1.0001;
+        double factor = rk_control_factor(ctl, error_norm, 4, accepted);
+
+        if (accepted)
+        {
+            *t_current += h;
+            for (i = 0; i < n_eq; ++i)
+                y_current[i] = y2[i] + (y2[i] - y1[i]) / 15.0;
+            *h_current = fmin(fmax(h * factor, h_min), h_max);
+        }
+        else
+        {
+            *h_current = fmax(h * factor, h_min);
+        }
+        ws->ctl_t = *t_current;
+        return accepted;
+    }
 
     // 3. Estimar o erro (truncamento local)
     // O erro é estimado como |y2[0] - y1[0]| / 15.0 para a componente theta (y[0])
@@ -127,45 +412,394 @@ int rk_adaptive_one_step(
     }
 }
 
+int rk_adaptive_one_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return rk_adaptive_one_step_ws(thread_workspace(n_eq), t_current, y_current, h_current,
+                                   n_eq, f, tol, h_min, h_max);
+}
+
+/**
+ * Tabela de Butcher de um par embutido com a propriedade FSAL ("first same as last"):
+ * o último estágio é avaliado em (t+h, y_novo) e serve de k1 do passo seguinte.
+ */
+typedef struct
+{
+    int stages;
+    int error_order; // Ordem do estimador de erro (q); o controle usa o expoente 1/(q+1)
+    double c[RK_MAX_STAGES];
+    double a[RK_MAX_STAGES][RK_MAX_STAGES];
+    double b[RK_MAX_STAGES]; // Pesos da solução propagada (ordem mais alta)
+    double e[RK_MAX_STAGES]; // b - b_chapeu (estimativa do erro local)
+} rk_tableau;
+
+static const rk_tableau dormand_prince_54 = {
+    7, 4,
+    {0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0},
+    {
+        {0},
+        {1.0 / 5.0},
+        {3.0 / 40.0, 9.0 / 40.0},
+        {44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0},
+        {19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0},
+        {9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0},
+        {35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0},
+    },
+    {35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0, 0.0},
+    {71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0},
+};
+
+static const rk_tableau bogacki_shampine_32 = {
+    4, 2,
+    {0.0, 1.0 / 2.0, 3.0 / 4.0, 1.0},
+    {
+        {0},
+        {1.0 / 2.0},
+        {0.0, 3.0 / 4.0},
+        {2.0 / 9.0, 1.0 / 3.0, 4.0 / 9.0},
+    },
+    {2.0 / 9.0, 1.0 / 3.0, 4.0 / 9.0, 0.0},
+    {-5.0 / 72.0, 1.0 / 12.0, 1.0 / 9.0, -1.0 / 8.0},
+};
+
+static int fsal_lookup(rk_workspace *ws, void (*f)(double, double[], double[]), int n_eq,
+                       double t, const double y[], double dydt[])
+{
+    if (!ws->fsal_valid || ws->fsal_f != f || ws->fsal_n_eq != n_eq || ws->fsal_t != t)
+        return 0;
+    if (memcmp(ws_buf(ws, WS_FSAL_Y), y, n_eq * sizeof(double)) != 0)
+        return 0;
+    memcpy(dydt, ws_buf(ws, WS_FSAL_DYDT), n_eq * sizeof(double));
+    return 1;
+}
+
+static void fsal_store(rk_workspace *ws, void (*f)(double, double[], double[]), int n_eq,
+                       double t, const double y[], const double dydt[])
+{
+    ws->fsal_valid = 1;
+    ws->fsal_f = f;
+    ws->fsal_n_eq = n_eq;
+    ws->fsal_t = t;
+    memcpy(ws_buf(ws, WS_FSAL_Y), y, n_eq * sizeof(double));
+    memcpy(ws_buf(ws, WS_FSAL_DYDT), dydt, n_eq * sizeof(double));
+}
+
+/**
+ * @brief Passo de um par Runge-Kutta embutido com FSAL.
+ *        O erro é estimado pela diferença entre as duas soluções embutidas, na componente
+ *        y[0] (mesmo critério de rk_adaptive_one_step), sem passos extras.
+ * @return 1 se o passo foi aceito, 0 se foi rejeitado (e h_current foi reduzido).
+ */
+static int rk_embedded_one_step(
+    rk_workspace *ws, const rk_tableau *tab,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    int s = tab->stages;
+    double *k[RK_MAX_STAGES];
+    double *y_stage = ws_buf(ws, WS_Y_STAGE);
+    double *y_new = ws_buf(ws, WS_Y_NEW);
+    double t = *t_current;
+    double h = *h_current;
+    int i, j, l;
+
+    for (j = 0; j < s; ++j)
+        k[j] = ws_buf(ws, WS_STAGE0 + j);
+
+    // k1: reaproveitado do último estágio do passo anterior quando possível
+    if (fsal_lookup(ws, f, n_eq, t, y_current, k[0]))
+    {
+        SET_LAST_STEP_EVALS(s - 1);
+    }
+    else
+    {
+        f(t, y_current, k[0]);
+        fsal_store(ws, f, n_eq, t, y_current, k[0]);
+        SET_LAST_STEP_EVALS(s);
+    }
+
+    // Estágios intermediários
+    for (j = 1; j < s - 1; ++j)
+    {
+        for (i = 0; i < n_eq; ++i)
+        {
+            double acc = 0.0;
+            for (l = 0; l < j; ++l)
+                acc += tab->a[j][l] * k[l][i];
+            y_stage[i] = y_current[i] + h * acc;
+        }
+        f(t + tab->c[j] * h, y_stage, k[j]);
+    }
+
+    // Solução de ordem alta; o último estágio é f(t+h, y_new) (FSAL)
+    for (i = 0; i < n_eq; ++i)
+    {
+        double acc = 0.0;
+        for (l = 0; l < s - 1; ++l)
+            acc += tab->b[l] * k[l][i];
+        y_new[i] = y_current[i] + h * acc;
+    }
+    f(t + h, y_new, k[s - 1]);
+
+    if (error_control.mode == RK_CONTROL_PI)
+    {
+        // Erro local de cada componente (y_stage já não é usado pelos estágios)
+        double *err = y_stage;
+        for (i = 0; i < n_eq; ++i)
+        {
+            double acc = 0.0;
+            for (l = 0; l < s; ++l)
+                acc += tab->e[l] * k[l][i];
+            err[i] = h * acc;
+        }
+        double error_norm = rk_error_norm(n_eq, err, y_current, y_new, tol);
+        rk_control_state *ctl = ws_control(ws, f, n_eq, t);
+        int accepted = error_norm <= 1.0 || h <= h_min * 1.0001;
+        double factor = rk_control_factor(ctl, error_norm, tab->error_order, accepted);
+
+        if (accepted)
+        {
+            *t_current = t + h;
+            memcpy(y_current, y_new, n_eq * sizeof(double));
+            fsal_store(ws, f, n_eq, *t_current, y_current, k[s - 1]);
+            *h_current = fmin(fmax(h * factor, h_min), h_max);
+        }
+        else
+        {
+            *h_current = fmax(h * factor, h_min);
+        }
+        ws->ctl_t = *t_current;
+        return accepted;
+    }
+
+    double err = 0.0;
+    for (l = 0; l < s; ++l)
+        err += tab->e[l] * k[l][0];
+    double error_estimate = fabs(h * err);
+
+    double safety_factor = 0.9;
+    double exponent = 1.0 / (tab->error_order + 1);
+    double factor = (error_estimate == 0.0) ? 5.0 : safety_factor * pow(tol / error_estimate, exponent);
+    factor = fmin(fmax(factor, 0.2), 5.0); // Evita variações bruscas de h
+
+    if (error_estimate <= tol || h <= h_min * 1.0001)
+    { // Passo aceito
+        *t_current = t + h;
+        memcpy(y_current, y_new, n_eq * sizeof(double));
+        fsal_store(ws, f, n_eq, *t_current, y_current, k[s - 1]);
+        *h_current = fmin(fmax(h * factor, h_min), h_max);
+        return 1;
+    }
+    // Passo rejeitado: k1 continua válido para a nova tentativa a partir do mesmo (t, y)
+    *h_current = fmax(h * factor, h_min);
+    return 0;
+}
+
+/**
+ * @brief Passo adaptativo Dormand-Prince 5(4). Mesma interface de rk_adaptive_one_step_ws.
+ */
+int rk_dp54_one_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return rk_embedded_one_step(ws, &dormand_prince_54, t_current, y_current, h_current,
+                                n_eq, f, tol, h_min, h_max);
+}
+
+int rk_dp54_one_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return rk_dp54_one_step_ws(thread_workspace(n_eq), t_current, y_current, h_current,
+                               n_eq, f, tol, h_min, h_max);
+}
+
+/**
+ * @brief Passo adaptativo Bogacki-Shampine 3(2). Mesma interface de rk_adaptive_one_step_ws.
+ */
+int rk_bs32_one_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return rk_embedded_one_step(ws, &bogacki_shampine_32, t_current, y_current, h_current,
+                                n_eq, f, tol, h_min, h_max);
+}
+
+int rk_bs32_one_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return rk_bs32_one_step_ws(thread_workspace(n_eq), t_current, y_current, h_current,
+                               n_eq, f, tol, h_min, h_max);
+}
+
+static rk_method selected_method = RK_METHOD_RK4_DOUBLING;
+
+static const rk_adaptive_step_ws_fn method_steppers[RK_METHOD_COUNT] = {
+    rk_adaptive_one_step_ws,
+    rk_dp54_one_step_ws,
+    rk_bs32_one_step_ws,
+};
+
+static const char *method_names[RK_METHOD_COUNT] = {
+    "rk4_doubling",
+    "dp54",
+    "bs32",
+};
+
+static const int method_error_orders[RK_METHOD_COUNT] = {4, 4, 2};
+
+int rk_method_error_order(rk_method method)
+{
+    if (method < 0 || method >= RK_METHOD_COUNT)
+        return 4;
+    return method_error_orders[method];
+}
+
+void rk_set_adaptive_method(rk_method method)
+{
+    if (method >= 0 && method < RK_METHOD_COUNT)
+        selected_method = method;
+}
+
+rk_method rk_get_adaptive_method(void)
+{
+    return selected_method;
+}
+
+const char *rk_method_name(rk_method method)
+{
+    if (method < 0 || method >= RK_METHOD_COUNT)
+        return "unknown";
+    return method_names[method];
+}
+
+int rk_adaptive_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return method_steppers[selected_method](ws, t_current, y_current, h_current, n_eq,
+                                            f, tol, h_min, h_max);
+}
+
+int rk_adaptive_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max)
+{
+    return rk_adaptive_step_ws(thread_workspace(n_eq), t_current, y_current, h_current,
+                               n_eq, f, tol, h_min, h_max);
+}
+
+double rk_initial_step_ws(rk_workspace *ws, double t0, const double y0[], int n_eq,
+                          void (*f)(double, double[], double[]),
+                          double tol, int order, double h_max)
+{
+    double *f0 = ws_buf(ws, WS_K1), *f1 = ws_buf(ws, WS_K2);
+    double *y1 = ws_buf(ws, WS_Y_TEMP), *df = ws_buf(ws, WS_K3);
+    int i;
+
+    f(t0, (double *)y0, f0);
+    // f(t0, y0) também serve de primeiro estágio para os pares com FSAL
+    fsal_store(ws, f, n_eq, t0, y0, f0);
+
+    // Primeiro palpite: o passo que moveria y em ~1% da sua escala
+    double d0 = rk_error_norm(n_eq, y0, y0, y0, tol);
+    double d1 = rk_error_norm(n_eq, f0, y0, y0, tol);
+    double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+    h0 = fmin(h0, h_max);
+
+    // Segunda derivada estimada por diferença, para o passo com erro ~ tol
+    for (i = 0; i < n_eq; ++i)
+        y1[i] = y0[i] + h0 * f0[i];
+    f(t0 + h0, y1, f1);
+    for (i = 0; i < n_eq; ++i)
+        df[i] = (f1[i] - f0[i]) / h0;
+    double d2 = rk_error_norm(n_eq, df, y0, y0, tol);
+
+    double d = fmax(d1, d2);
+    double h1 = (d <= 1e-15) ? fmax(1e-6, h0 * 1e-3) : pow(0.01 / d, 1.0 / (order + 1));
+    return fmin(fmin(100.0 * h0, h1), h_max);
+}
+
+double rk_initial_step(double t0, const double y0[], int n_eq,
+                       void (*f)(double, double[], double[]),
+                       double tol, int order, double h_max)
+{
+    return rk_initial_step_ws(thread_workspace(n_eq), t0, y0, n_eq, f, tol, order, h_max);
+}
+
 /**
  * @brief Resolve um sistema de EDOs usando Runge-Kutta de 4ª ordem com passo adaptativo.
+ *        O passo é dado pelo método escolhido em rk_set_adaptive_method (RK4 com passo dobrado por padrão).
  * @param t0 Tempo inicial.
  * @param t_final Tempo final.
  * @param y0 Vetor de condições iniciais.
  * @param n_eq Número de equações.
  * @param f Ponteiro para a função de derivadas.
  * @param tol Tolerância de erro desejada.
- * @param h_initial Estimativa inicial para o tamanho do passo.
- * @param outfile Ponteiro para o arquivo de saída (NULL se não quiser salvar).
+ * @param h_initial Estimativa inicial para o tamanho do passo (<= 0: estimado com rk_initial_step).
+ * @param sink Destino das amostras (t, y[0..n_cols-2]) a cada passo aceito (NULL se não quiser salvar).
  * @param y_final_out Vetor para armazenar o estado final (opcional, pode ser NULL).
+ * @param stats Estatísticas da integração (opcional, pode ser NULL).
  * @return Número de passos aceitos.
  */
 int RungeKutta_system_adaptive_h(
     double t0, double t_final, const double y0[], int n_eq,
     void (*f)(double, double[], double[]),
     double tol, double h_initial,
-    FILE *outfile, double y_final_out[])
+    traj_sink *sink, double y_final_out[], rk_stats *stats)
+{
+    return RungeKutta_system_adaptive_h_ws(thread_workspace(n_eq), t0, t_final, y0, n_eq, f,
+                                           tol, h_initial, sink, y_final_out, stats);
+}
+
+int RungeKutta_system_adaptive_h_ws(
+    rk_workspace *ws,
+    double t0, double t_final, const double y0[], int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_initial,
+    traj_sink *sink, double y_final_out[], rk_stats *stats)
 {
     double t = t0;
-    double y[n_eq];
+    double *y = ws_buf(ws, WS_Y);
     double h = h_initial;
     int i;
 
-    double h_min = tol * 0.1;             // Exemplo de h_min, pode ser ajustado
     double h_max = (t_final - t0) / 10.0; // Exemplo de h_max
+    double h_min = rk_default_h_min(tol, h_max);
 
     int accepted_steps = 0;
-    int rejected_steps = 0; // Para estatísticas, se desejar
+
+    if (stats)
+        rk_stats_reset(stats);
 
     for (i = 0; i < n_eq; ++i)
         y[i] = y0[i];
 
-    if (outfile)
+    ws->ctl_valid = 0; // O controlador PI começa do zero em cada integração
+    if (h <= 0.0)
+    {
+        h = rk_initial_step_ws(ws, t, y, n_eq, f, tol, rk_method_error_order(selected_method), h_max);
+        RK_STATS_EVALS(stats, RK_INITIAL_STEP_EVALS);
+    }
+
+    if (sink)
     { // Salvar ponto inicial
-        fprintf(outfile, "%.8e", t);
-        for (i = 0; i < n_eq; ++i)
-            fprintf(outfile, " %.8e", y[i]);
-        fprintf(outfile, "\n");
+        RK_CYCLES_BEGIN(c_out);
+        sink_write(sink, t, y);
+        RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
     }
 
     while (t < t_final)
@@ -177,31 +811,32 @@ int RungeKutta_system_adaptive_h(
         if (h <= 1e-12)
             break; // Evitar passo efetivamente nulo
 
-        double y_temp_before_step[n_eq]; // Salvar estado caso o passo seja rejeitado
-        memcpy(y_temp_before_step, y, n_eq * sizeof(double));
+        // Os steppers não alteram t nem y quando rejeitam o passo, então não há cópia de segurança
         double t_before_step = t;
+        (void)t_before_step; // Só usado por RK_STATS_ACCEPT
         double h_try = h; // h que será tentado (e possivelmente modificado por rk_adaptive_one_step)
 
-        int status = rk_adaptive_one_step(&t, y, &h_try, n_eq, f, tol, h_min, h_max);
+        RK_CYCLES_BEGIN(c_step);
+        int status = rk_adaptive_step_ws(ws, &t, y, &h_try, n_eq, f, tol, h_min, h_max);
+        RK_CYCLES_END(stats, RK_PHASE_STEP, c_step);
+        RK_STATS_EVALS(stats, rk_last_step_evals());
 
         if (status == 1)
         { // Passo aceito
             accepted_steps++;
+            RK_STATS_ACCEPT(stats, t - t_before_step);
             h = h_try; // h_try foi atualizado para o próximo passo sugerido
-            if (outfile)
+            if (sink)
             {
-                fprintf(outfile, "%.8e", t);
-                for (i = 0; i < n_eq; ++i)
-                    fprintf(outfile, " %.8e", y[i]);
-                fprintf(outfile, "\n");
+                RK_CYCLES_BEGIN(c_out);
+                sink_write(sink, t, y);
+                RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
             }
         }
         else
         { // Passo rejeitado
-            rejected_steps++;
-            memcpy(y, y_temp_before_step, n_eq * sizeof(double)); // Restaurar y
-            t = t_before_step;                                    // Restaurar t
-            h = h_try;                                            // h_try foi reduzido pela rk_adaptive_one_step
+            RK_STATS_REJECT(stats);
+            h = h_try; // h_try foi reduzido pela rk_adaptive_one_step
             // O loop continuará e tentará novamente com o novo h reduzido.
         }
     }
@@ -210,6 +845,131 @@ int RungeKutta_system_adaptive_h(
         for (i = 0; i < n_eq; ++i)
             y_final_out[i] = y[i];
     }
-    // printf("Adaptativo: Aceitos=%d, Rejeitados=%d\n", accepted_steps, rejected_steps);
     return accepted_steps;
-}
\ No newline at end of file
+}
+
+void rk_dense_eval(const rk_dense_step *step, double t, double y_out[])
+{
+    double h = step->t1 - step->t0;
+    double s = (t - step->t0) / h;
+    double s2 = s * s, s3 = s2 * s;
+
+    // Bases de Hermite cúbicas
+    double h00 = 2.0 * s3 - 3.0 * s2 + 1.0;
+    double h10 = s3 - 2.0 * s2 + s;
+    double h01 = -2.0 * s3 + 3.0 * s2;
+    double h11 = s3 - s2;
+
+    for (int i = 0; i < step->n_eq; ++i)
+    {
+        y_out[i] = h00 * step->y0[i] + h10 * h * step->f0[i] + h01 * step->y1[i] + h11 * h * step->f1[i];
+    }
+}
+
+int rk_brent_root(double (*g)(double t, void *ctx), void *ctx,
+                  double a, double b, double ga, double gb, double xtol, double *root)
+{
+    if (ga == 0.0)
+    {
+        *root = a;
+        return 1;
+    }
+    if (gb == 0.0)
+    {
+        *root = b;
+        return 1;
+    }
+    if ((ga > 0.0) == (gb > 0.0))
+        return 0;
+
+    double c = a, gc = ga, d = b - a, e = d;
+    for (int iter = 0; iter < 100; ++iter)
+    {
+        if ((gb > 0.0) == (gc > 0.0))
+        { // Mantém a raiz entre b e c
+            c = a;
+            gc = ga;
+            d = e = b - a;
+        }
+        if (fabs(gc) < fabs(gb))
+        { // b é sempre a melhor estimativa
+            a = b; b = c; c = a;
+            ga = gb; gb = gc; gc = ga;
+        }
+
+        double tol1 = 2.0 * 2.2e-16 * fabs(b) + 0.5 * xtol;
+        double xm = 0.5 * (c - b);
+        if (fabs(xm) <= tol1 || gb == 0.0)
+        {
+            *root = b;
+            return 1;
+        }
+
+        if (fabs(e) >= tol1 && fabs(ga) > fabs(gb))
+        { // Tenta interpolação (secante ou quadrática inversa)
+            double p, q, r, s = gb / ga;
+            if (a == c)
+            {
+                p = 2.0 * xm * s;
+                q = 1.0 - s;
+            }
+            else
+            {
+                q = ga / gc;
+                r = gb / gc;
+                p = s * (2.0 * xm * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0)
+                q = -q;
+            p = fabs(p);
+            if (2.0 * p < fmin(3.0 * xm * q - fabs(tol1 * q), fabs(e * q)))
+            { // Interpolação aceita
+                e = d;
+                d = p / q;
+            }
+            else
+            { // Recai na bisseção
+                d = xm;
+                e = d;
+            }
+        }
+        else
+        {
+            d = xm;
+            e = d;
+        }
+
+        a = b;
+        ga = gb;
+        b += (fabs(d) > tol1) ? d : (xm > 0.0 ? tol1 : -tol1);
+        gb = g(b, ctx);
+    }
+    *root = b;
+    return 1;
+}
+
+// Adapta g(t, y) para uma função escalar de t usando a saída densa do passo.
+typedef struct
+{
+    const rk_dense_step *step;
+    rk_event_fn g;
+    void *ctx;
+    double *y; // Estado interpolado (n_eq doubles, no workspace da thread)
+} dense_event_ctx;
+
+static double dense_event_eval(double t, void *ctx)
+{
+    dense_event_ctx *ev = (dense_event_ctx *)ctx;
+    rk_dense_eval(ev->step, t, ev->y);
+    return ev->g(t, ev->y, ev->ctx);
+}
+
+int rk_locate_event(const rk_dense_step *step, rk_event_fn g, void *ctx,
+                    double xtol, double *t_event)
+{
+    double g0 = g(step->t0, step->y0, ctx);
+    double g1 = g(step->t1, step->y1, ctx);
+    dense_event_ctx ev = {step, g, ctx, ws_buf(thread_workspace(step->n_eq), WS_DENSE)};
+    return rk_brent_root(dense_event_eval, &ev, step->t0, step->t1, g0, g1, xtol, t_event);
+}
@@ -2,14 +2,44 @@
 #define ODE_H
 
 #include <stdio.h>
+#include "sink.h"
+#include "rk_stats.h"
 #define G 9.81
 #define L 1.0
 
+/*
+ * Workspace dos integradores: todos os vetores temporários dos steppers (estágios,
+ * estados intermediários, cache FSAL) num bloco alinhado, alocado uma vez e reusado
+ * a cada passo. Cada thread deve usar o seu (as funções _ws são reentrantes).
+ *
+ * As funções sem _ws usam um workspace implícito por thread, que cresce conforme o
+ * maior n_eq visto e é liberado quando a thread termina (ou em rk_thread_workspace_release).
+ * Nenhuma delas aloca vetores na pilha, então sistemas grandes não estouram a pilha.
+ */
+typedef struct rk_workspace rk_workspace;
+
+/**
+ * @brief Cria um workspace para sistemas de até n_eq equações.
+ * @return O workspace, ou NULL em caso de falha.
+ */
+rk_workspace *rk_workspace_create(int n_eq);
+void rk_workspace_destroy(rk_workspace *ws);
+
+/**
+ * @brief Garante capacidade para n_eq equações (realoca se necessário; invalida o cache FSAL).
+ * @return 1 em caso de sucesso, 0 se faltou memória (o workspace continua válido).
+ */
+int rk_workspace_reserve(rk_workspace *ws, int n_eq);
+int rk_workspace_capacity(const rk_workspace *ws);
+
+// Libera o workspace implícito da thread atual (é recriado no próximo uso).
+void rk_thread_workspace_release(void);
+
 int RungeKutta_system_adaptive_h(
     double t0, double t_final, const double y0[], int n_eq,
     void (*f)(double, double[], double[]),
     double tol, double h_initial,
-    FILE *outfile, double y_final_out[]);
+    traj_sink *sink, double y_final_out[], rk_stats *stats);
 
 void rk4_single_step_system(double t, const double y_in[], double h, int n_eq,
                         void (*f)(double, double[], double[]),
@@ -19,5 +49,230 @@ int rk_adaptive_one_step(
     double *t_current, double y_current[], double *h_current, int n_eq,
     void (*f)(double, double[], double[]),
     double tol, double h_min, double h_max);
+
+// Versões com workspace explícito (capacidade >= n_eq) das funções acima.
+int RungeKutta_system_adaptive_h_ws(
+    rk_workspace *ws,
+    double t0, double t_final, const double y0[], int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_initial,
+    traj_sink *sink, double y_final_out[], rk_stats *stats);
+
+void rk4_single_step_system_ws(rk_workspace *ws, double t, const double y_in[], double h, int n_eq,
+                               void (*f)(double, double[], double[]),
+                               double y_out[]);
+
+int rk_adaptive_one_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+// Par embutido Dormand-Prince 5(4) com FSAL (6 avaliações de f por passo).
+int rk_dp54_one_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+// Par embutido Bogacki-Shampine 3(2) com FSAL (3 avaliações de f por passo).
+int rk_bs32_one_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+int rk_dp54_one_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+int rk_bs32_one_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+// Métodos adaptativos disponíveis, selecionáveis em tempo de execução.
+typedef enum
+{
+    RK_METHOD_RK4_DOUBLING = 0, // RK4 com passo dobrado (padrão)
+    RK_METHOD_DP54,
+    RK_METHOD_BS32,
+    RK_METHOD_COUNT
+} rk_method;
+
+typedef int (*rk_adaptive_step_fn)(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+typedef int (*rk_adaptive_step_ws_fn)(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+/*
+ * Controle de erro dos passos adaptativos (global ao processo, como o método).
+ *
+ * RK_CONTROL_LEGACY (padrão): o critério original, só |erro em y[0]| <= tol com controlador I.
+ * RK_CONTROL_PI (opcional): o erro local e_i de cada componente é medido contra
+ *   sc_i = atol_i + rtol_i * max(|y_i|, |y_novo_i|) e o passo é aceito se a norma RMS
+ *   ponderada sqrt(mean((e_i/sc_i)^2)) for <= 1. O novo passo sai de um controlador PI
+ *   (Gustafsson): h_novo = h * safety * err^(-alpha/k) * err_anterior^(beta/k), com k = ordem
+ *   do estimador + 1 e a razão h_novo/h limitada a [fac_min, fac_max] (e a 1 logo após
+ *   uma rejeição). Sem vetores atol/rtol, as duas tolerâncias valem tol em toda componente.
+ *   Controla todas as componentes e quase não rejeita passos, mas nos cenários de main.c
+ *   gasta mais avaliações de f que o legado para o mesmo erro (ver bench_error_control).
+ */
+typedef enum
+{
+    RK_CONTROL_PI = 0,
+    RK_CONTROL_LEGACY
+} rk_control_mode;
+
+typedef struct
+{
+    rk_control_mode mode;
+    const double *atol; // Tolerância absoluta por componente (n_eq) ou NULL para usar tol
+    const double *rtol; // Tolerância relativa por componente (n_eq) ou NULL para usar tol
+    double safety;
+    double fac_min, fac_max; // Limites da razão h_novo/h
+    double alpha, beta;      // Expoentes do controlador PI (divididos pela ordem k)
+} rk_error_control;
+
+// Modo legado; os demais campos são os do controlador PI, para quem só troca o modo
+#define RK_ERROR_CONTROL_DEFAULT {RK_CONTROL_LEGACY, NULL, NULL, 0.9, 0.2, 5.0, 0.7, 0.4}
+
+/**
+ * @brief Define o controle de erro usado pelos steppers adaptativos, por
+ *        detect_period_adaptive e pelo lote adaptativo. Os vetores atol/rtol não são
+ *        copiados e devem continuar válidos enquanto estiverem em uso.
+ */
+void rk_set_error_control(const rk_error_control *control);
+const rk_error_control *rk_get_error_control(void);
+
+// Estado do controlador PI entre passos consecutivos de uma mesma integração.
+typedef struct
+{
+    double log_err_prev; // log da norma do último passo aceito
+    int last_rejected;   // A última tentativa foi rejeitada
+} rk_control_state;
+
+void rk_control_state_reset(rk_control_state *state);
+
+/**
+ * @brief Controlador PI que rk_adaptive_step usará no próximo passo de f a partir de t
+ *        nesta thread (zerado se a última integração de f não parou em t). Permite salvar
+ *        e restaurar o controlador para retomar uma integração exatamente de onde parou.
+ */
+rk_control_state *rk_adaptive_control(int n_eq, void (*f)(double, double[], double[]), double t);
+
+/**
+ * @brief Norma RMS ponderada de err (erro local) com as tolerâncias do controle de erro.
+ * @param y_old Estado no início do passo.
+ * @param y_new Estado no fim do passo.
+ */
+double rk_error_norm(int n_eq, const double err[], const double y_old[], const double y_new[], double tol);
+
+/**
+ * @brief Razão h_novo/h do controlador PI para a norma err (aceito = err <= 1 ou h mínimo).
+ *        Atualiza o estado do controlador.
+ * @param error_order Ordem do estimador de erro (4 no passo dobrado e no DP54, 2 no BS32).
+ */
+double rk_control_factor(rk_control_state *state, double err, int error_order, int accepted);
+
+/**
+ * @brief h_min padrão dos drivers: tol * 0.1 no modo legado; no PI, h_max * 1e-12
+ *        (só evita um laço infinito; o controlador não precisa de um piso artificial).
+ */
+double rk_default_h_min(double tol, double h_max);
+
+/**
+ * @brief Estima o passo inicial (Hairer, Nørsett e Wanner, II.4) com duas avaliações de f,
+ *        na norma do controle de erro. Os drivers o usam quando h_initial <= 0.
+ * @param order Ordem do estimador de erro do método (rk_method_error_order).
+ * @return O passo estimado, limitado a h_max.
+ */
+double rk_initial_step(double t0, const double y0[], int n_eq,
+                       void (*f)(double, double[], double[]),
+                       double tol, int order, double h_max);
+
+double rk_initial_step_ws(rk_workspace *ws, double t0, const double y0[], int n_eq,
+                          void (*f)(double, double[], double[]),
+                          double tol, int order, double h_max);
+
+// Avaliações de f feitas por rk_initial_step.
+#define RK_INITIAL_STEP_EVALS 2
+
+/**
+ * @brief Seleciona o método usado por rk_adaptive_step, RungeKutta_system_adaptive_h
+ *        e detect_period_adaptive. A escolha é global ao processo.
+ */
+void rk_set_adaptive_method(rk_method method);
+rk_method rk_get_adaptive_method(void);
+const char *rk_method_name(rk_method method);
+
+// Ordem do estimador de erro do método (para rk_control_factor e rk_initial_step).
+int rk_method_error_order(rk_method method);
+
+// Passo adaptativo com o método selecionado (mesma assinatura de rk_adaptive_one_step).
+int rk_adaptive_step(
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+int rk_adaptive_step_ws(
+    rk_workspace *ws,
+    double *t_current, double y_current[], double *h_current, int n_eq,
+    void (*f)(double, double[], double[]),
+    double tol, double h_min, double h_max);
+
+/**
+ * @brief Avaliações de f feitas pela última tentativa de passo adaptativo desta thread
+ *        (12 no passo dobrado; 6/7 no DP54 e 3/4 no BS32, conforme o FSAL).
+ *        Só é mantido com RK_ENABLE_STATS; caso contrário retorna 0.
+ */
+int rk_last_step_evals(void);
+
+/**
+ * Um passo aceito [t0, t1] com estados e derivadas nas duas pontas: o suficiente para
+ * o interpolante cúbico de Hermite (saída densa de 3ª ordem para qualquer stepper).
+ */
+typedef struct
+{
+    double t0, t1;
+    int n_eq;
+    const double *y0, *f0; // y(t0) e f(t0, y(t0))
+    const double *y1, *f1; // y(t1) e f(t1, y(t1))
+} rk_dense_step;
+
+/**
+ * @brief Avalia o interpolante de Hermite do passo em t (t0 <= t <= t1).
+ */
+void rk_dense_eval(const rk_dense_step *step, double t, double y_out[]);
+
+// Função de evento g(t, y); o evento ocorre quando g troca de sinal.
+typedef double (*rk_event_fn)(double t, const double y[], void *ctx);
+
+/**
+ * @brief Localiza a raiz de g(t) = 0 com o método de Brent.
+ * @param ga g(a) já calculado.
+ * @param gb g(b) já calculado; ga e gb devem ter sinais opostos (ou um deles ser zero).
+ * @return 1 se a raiz foi encontrada, 0 se [a, b] não contém troca de sinal.
+ */
+int rk_brent_root(double (*g)(double t, void *ctx), void *ctx,
+                  double a, double b, double ga, double gb, double xtol, double *root);
+
+/**
+ * @brief Localiza um evento g(t, y(t)) = 0 dentro de um passo, usando Brent sobre a saída densa.
+ *        O estado interpolado fica no workspace implícito da thread (step não deve apontar
+ *        para ele).
+ * @param xtol Tolerância absoluta no tempo do evento.
+ * @param t_event Instante do evento.
+ * @return 1 se houve troca de sinal de g no passo, 0 caso contrário.
+ */
+int rk_locate_event(const rk_dense_step *step, rk_event_fn g, void *ctx,
+                    double xtol, double *t_event);
 #endif
 
@@ -0,0 +1,494 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rk.h"
+#include "rk_par.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpu_relax() _mm_pause()
+#else
+#define cpu_relax() ((void)0)
+#endif
+
+// Iterações de espera ativa na barreira antes de dormir (0 se há mais threads que núcleos)
+#define RK_PAR_SPIN 20000
+// Fronteiras das faixas em múltiplos de 8 unidades (uma linha de cache de doubles)
+#define RK_PAR_GRAIN 8
+
+enum
+{
+    PAR_K1 = 0, PAR_K2, PAR_K3, PAR_K4, PAR_YA, PAR_YB, // estágios do RK4
+    PAR_Y1, PAR_Y2_HALF1, PAR_Y2,                      // passo dobrado
+    PAR_Y,                                             // rk_par_integrate
+    PAR_N_BUFFERS
+};
+
+// Estado de cada thread numa linha de cache própria (evita falso compartilhamento)
+typedef struct
+{
+    _Alignas(64) double partial; // Contribuição da thread para a redução
+    int sense;                   // Sentido local da barreira
+} par_slot;
+
+typedef struct
+{
+    rk_par_team *team;
+    int tid;
+} par_worker_arg;
+
+struct rk_par_team
+{
+    int n_threads;
+    int n_units, n_fields, n_eq;
+    int *bounds; // Faixa da thread k: [bounds[k], bounds[k+1])
+    pthread_t *threads;
+    par_worker_arg *args;
+    par_slot *slots;
+    size_t stride; // Doubles entre buffers consecutivos (múltiplo da linha de cache)
+    double *block;
+
+    // Barreira com inversão de sentido
+    atomic_int count;
+    atomic_int sense;
+    atomic_int sleepers;
+    int spin;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    // Trabalho corrente, publicado pela thread 0 antes da barreira de início
+    void (*job)(rk_par_team *team, int tid);
+    int stop;
+    rk_par_rhs f;
+    void *ctx;
+    double t, h, tol, h_min;
+    const double *y_in;
+    double *y_out;
+    int pi_control; // Modo do controle de erro no passo corrente
+    int accepted;
+    double error_estimate; // Norma RMS ponderada (PI) ou |erro em y[0]| (legado)
+
+    // Estado do controlador PI, válido para um passo de (ctl_f, ctl_ctx) que comece em ctl_t
+    rk_control_state ctl;
+    int ctl_valid;
+    rk_par_rhs ctl_f;
+    void *ctl_ctx;
+    double ctl_t;
+};
+
+static inline double *par_buf(rk_par_team *team, int role)
+{
+    return team->block + (size_t)role * team->stride;
+}
+
+// Percorre as equações das unidades [b, e) em todos os campos (cada índice é independente)
+#define FOR_OWNED(team, b, e, i)                                                                        \
+    for (size_t fld_ = 0, off_ = 0; fld_ < (size_t)(team)->n_fields; ++fld_, off_ += (team)->n_units) \
+        _Pragma("omp simd") for (size_t i = off_ + (b); i < off_ + (e); ++i)
+
+static void team_barrier(rk_par_team *team, int tid)
+{
+    par_slot *me = &team->slots[tid];
+    int sense = me->sense = !me->sense;
+
+    if (atomic_fetch_sub(&team->count, 1) == 1)
+    { // Última a chegar: rearma o contador e libera as demais
+        atomic_store(&team->count, team->n_threads);
+        atomic_store(&team->sense, sense);
+        if (atomic_load(&team->sleepers) > 0)
+        {
+            pthread_mutex_lock(&team->lock);
+            pthread_cond_broadcast(&team->cond);
+            pthread_mutex_unlock(&team->lock);
+        }
+        return;
+    }
+
+    for (int i = 0; i < team->spin; ++i)
+    {
+        if (atomic_load_explicit(&team->sense, memory_order_acquire) == sense)
+            return;
+        cpu_relax();
+    }
+    pthread_mutex_lock(&team->lock);
+    atomic_fetch_add(&team->sleepers, 1);
+    while (atomic_load(&team->sense) != sense)
+        pthread_cond_wait(&team->cond, &team->lock);
+    atomic_fetch_sub(&team->sleepers, 1);
+    pthread_mutex_unlock(&team->lock);
+}
+
+static void *par_worker_main(void *p)
+{
+    par_worker_arg *wa = (par_worker_arg *)p;
+    rk_par_team *team = wa->team;
+
+    for (;;)
+    {
+        team_barrier(team, wa->tid); // Início de um trabalho
+        if (team->stop)
+            break;
+        team->job(team, wa->tid);
+        team_barrier(team, wa->tid); // Fim do trabalho
+    }
+    return NULL;
+}
+
+// Executa job em todas as threads do time; retorna quando todas terminaram.
+static void team_run(rk_par_team *team, void (*job)(rk_par_team *, int))
+{
+    team->job = job;
+    team_barrier(team, 0);
+    job(team, 0);
+    team_barrier(team, 0);
+}
+
+// Primeiro toque de cada faixa pela thread dona (as páginas ficam no nó NUMA dela)
+static void job_first_touch(rk_par_team *team, int tid)
+{
+    int b = team->bounds[tid], e = team->bounds[tid + 1];
+    for (int role = 0; role < PAR_N_BUFFERS; ++role)
+    {
+        double *buf = par_buf(team, role);
+        for (int fld = 0; fld < team->n_fields; ++fld)
+            memset(buf + (size_t)fld * team->n_units + b, 0, (size_t)(e - b) * sizeof(double));
+    }
+}
+
+// Divide as unidades entre as n_threads do time, em múltiplos de RK_PAR_GRAIN.
+static void team_partition(rk_par_team *team)
+{
+    int n_threads = team->n_threads;
+    for (int k = 0; k <= n_threads; ++k)
+    {
+        long long b = (long long)team->n_units * k / n_threads;
+        team->bounds[k] = (k == n_threads) ? team->n_units : (int)(b / RK_PAR_GRAIN * RK_PAR_GRAIN);
+    }
+}
+
+rk_par_team *rk_par_create(int n_threads, int n_units, int n_fields)
+{
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpus <= 0)
+        n_cpus = 1;
+    if (n_threads <= 0)
+        n_threads = (int)n_cpus;
+    if (n_units <= 0 || n_fields <= 0)
+        return NULL;
+
+    rk_par_team *team = calloc(1, sizeof(rk_par_team));
+    if (!team)
+        return NULL;
+    team->n_threads = n_threads;
+    team->n_units = n_units;
+    team->n_fields = n_fields;
+    team->n_eq = n_units * n_fields;
+    team->spin = (n_threads <= n_cpus) ? RK_PAR_SPIN : 0;
+    team->bounds = malloc((n_threads + 1) * sizeof(int));
+    team->threads = malloc(n_threads * sizeof(pthread_t));
+    team->args = malloc(n_threads * sizeof(par_worker_arg));
+    team->slots = aligned_alloc(64, n_threads * sizeof(par_slot));
+    team->stride = ((size_t)team->n_eq + RK_PAR_GRAIN - 1) / RK_PAR_GRAIN * RK_PAR_GRAIN;
+    team->block = aligned_alloc(64, PAR_N_BUFFERS * team->stride * sizeof(double));
+    if (!team->bounds || !team->threads || !team->args || !team->slots || !team->block)
+    {
+        free(team->bounds);
+        free(team->threads);
+        free(team->args);
+        free(team->slots);
+        free(team->block);
+        free(team);
+        return NULL;
+    }
+
+    team_partition(team);
+    memset(team->slots, 0, n_threads * sizeof(par_slot));
+    atomic_init(&team->count, n_threads);
+    atomic_init(&team->sense, 0);
+    atomic_init(&team->sleepers, 0);
+    pthread_mutex_init(&team->lock, NULL);
+    pthread_cond_init(&team->cond, NULL);
+
+    // A thread 0 é quem chama as funções do time; as demais são criadas aqui
+    for (int k = 1; k < n_threads; ++k)
+    {
+        team->args[k].team = team;
+        team->args[k].tid = k;
+        if (pthread_create(&team->threads[k], NULL, par_worker_main, &team->args[k]) != 0)
+        { // O time fica só com as threads já criadas: nenhuma passou da primeira barreira
+            team->n_threads = k;
+            team_partition(team);
+            atomic_fetch_sub(&team->count, n_threads - k);
+            break;
+        }
+    }
+    team_run(team, job_first_touch);
+    return team;
+}
+
+void rk_par_destroy(rk_par_team *team)
+{
+    if (!team)
+        return;
+    team->stop = 1;
+    team_barrier(team, 0);
+    for (int k = 1; k < team->n_threads; ++k)
+        pthread_join(team->threads[k], NULL);
+
+    pthread_mutex_destroy(&team->lock);
+    pthread_cond_destroy(&team->cond);
+    free(team->bounds);
+    free(team->threads);
+    free(team->args);
+    free(team->slots);
+    free(team->block);
+    free(team);
+}
+
+int rk_par_num_threads(const rk_par_team *team)
+{
+    return team->n_threads;
+}
+
+void rk_par_range(const rk_par_team *team, int tid, int *begin, int *end)
+{
+    *begin = team->bounds[tid];
+    *end = team->bounds[tid + 1];
+}
+
+/**
+ * @brief Parte da thread tid num passo RK4: as mesmas operações de rk4_single_step_system_ws,
+ *        restritas à faixa [b, e). Termina com uma barreira, então y_out está completo no retorno.
+ */
+static void par_rk4(rk_par_team *team, int tid, double t, const double y_in[], double h,
+                    double y_out[])
+{
+    int b = team->bounds[tid], e = team->bounds[tid + 1];
+    double *k1 = par_buf(team, PAR_K1), *k2 = par_buf(team, PAR_K2);
+    double *k3 = par_buf(team, PAR_K3), *k4 = par_buf(team, PAR_K4);
+    double *ya = par_buf(team, PAR_YA), *yb = par_buf(team, PAR_YB);
+    rk_par_rhs f = team->f;
+    void *ctx = team->ctx;
+
+    // Os estados intermediários alternam entre ya e yb: ao escrever um, ninguém mais lê
+    // o outro, então basta uma barreira por estágio
+    f(t, y_in, k1, b, e, ctx);
+    FOR_OWNED(team, b, e, i)
+        ya[i] = y_in[i] + (h / 2.0) * k1[i];
+    team_barrier(team, tid);
+
+    f(t + h / 2.0, ya, k2, b, e, ctx);
+    FOR_OWNED(team, b, e, i)
+        yb[i] = y_in[i] + (h / 2.0) * k2[i];
+    team_barrier(team, tid);
+
+    f(t + h / 2.0, yb, k3, b, e, ctx);
+    FOR_OWNED(team, b, e, i)
+        ya[i] = y_in[i] + h * k3[i];
+    team_barrier(team, tid);
+
+    f(t + h, ya, k4, b, e, ctx);
+    FOR_OWNED(team, b, e, i)
+        y_out[i] = y_in[i] + (h / 6.0) * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+    team_barrier(team, tid);
+}
+
+static void job_rk4_step(rk_par_team *team, int tid)
+{
+    par_rk4(team, tid, team->t, team->y_in, team->h, team->y_out);
+}
+
+void rk_par_rk4_step(rk_par_team *team, double t, const double y_in[], double h,
+                     rk_par_rhs f, void *ctx, double y_out[])
+{
+    team->f = f;
+    team->ctx = ctx;
+    team->t = t;
+    team->h = h;
+    team->y_in = y_in;
+    team->y_out = y_out;
+    team_run(team, job_rk4_step);
+}
+
+static void job_doubling_step(rk_par_team *team, int tid)
+{
+    int b = team->bounds[tid], e = team->bounds[tid + 1];
+    double *y1 = par_buf(team, PAR_Y1);
+    double *y2_half1 = par_buf(team, PAR_Y2_HALF1);
+    double *y2 = par_buf(team, PAR_Y2);
+    double *y = team->y_out;
+    double t = team->t, h = team->h, h_half = h / 2.0;
+
+    par_rk4(team, tid, t, y, h, y1);
+    par_rk4(team, tid, t, y, h_half, y2_half1);
+    par_rk4(team, tid, t + h_half, y2_half1, h_half, y2);
+
+    // O mesmo critério de rk_adaptive_one_step (par_rk4 termina com barreira, então y1 e y2
+    // já estão completos)
+    double error_estimate;
+    int accepted;
+    if (team->pi_control)
+    {
+        // Norma de rk_error_norm: soma dos quadrados na faixa, depois cada thread combina
+        // os parciais de todas (na ordem das threads, então todas chegam ao mesmo valor)
+        const rk_error_control *c = rk_get_error_control();
+        const double *atol = c->atol, *rtol = c->rtol;
+        double tol = team->tol, local = 0.0;
+        for (int fld = 0; fld < team->n_fields; ++fld)
+        {
+            size_t off = (size_t)fld * team->n_units;
+            #pragma omp simd reduction(+ : local)
+            for (size_t i = off + b; i < off + e; ++i)
+            {
+                double a = atol ? atol[i] : tol;
+                double r = rtol ? rtol[i] : tol;
+                double q = (y2[i] - y1[i]) / 15.0 / (a + r * fmax(fabs(y[i]), fabs(y2[i])));
+                local += q * q;
+            }
+        }
+        team->slots[tid].partial = local;
+        team_barrier(team, tid);
+
+        double sum = 0.0;
+        for (int k = 0; k < team->n_threads; ++k)
+            sum += team->slots[k].partial;
+        error_estimate = sqrt(sum / team->n_eq);
+        accepted = error_estimate <= 1.0 || h <= team->h_min * 1.0001;
+    }
+    else
+    {
+        error_estimate = fabs(y2[0] - y1[0]) / 15.0;
+        accepted = error_estimate <= team->tol || h <= team->h_min * 1.0001;
+    }
+    if (accepted)
+    {
+        FOR_OWNED(team, b, e, i)
+            y[i] = y2[i] + (y2[i] - y1[i]) / 15.0;
+    }
+    if (tid == 0)
+    {
+        team->accepted = accepted;
+        team->error_estimate = error_estimate;
+    }
+}
+
+int rk_par_adaptive_one_step(rk_par_team *team, double *t_current, double y_current[],
+                             double *h_current, rk_par_rhs f, void *ctx,
+                             double tol, double h_min, double h_max)
+{
+    double h = *h_current;
+    double safety_factor = 0.9;
+
+    team->f = f;
+    team->ctx = ctx;
+    team->t = *t_current;
+    team->h = h;
+    team->tol = tol;
+    team->h_min = h_min;
+    team->y_out = y_current;
+    team->pi_control = rk_get_error_control()->mode == RK_CONTROL_PI;
+    team_run(team, job_doubling_step);
+
+    if (team->pi_control)
+    {
+        // O controlador recomeça se o passo não continua a integração anterior
+        if (!team->ctl_valid || team->ctl_f != f || team->ctl_ctx != ctx || team->ctl_t != *t_current)
+        {
+            rk_control_state_reset(&team->ctl);
+            team->ctl_valid = 1;
+            team->ctl_f = f;
+            team->ctl_ctx = ctx;
+        }
+        double factor = rk_control_factor(&team->ctl, team->error_estimate, 4, team->accepted);
+        if (team->accepted)
+        {
+            *t_current += h;
+            *h_current = fmin(fmax(h * factor, h_min), h_max);
+        }
+        else
+        {
+            *h_current = fmax(h * factor, h_min);
+        }
+        team->ctl_t = *t_current;
+        return team->accepted;
+    }
+
+    // Legado: mesma atualização de h de rk_adaptive_one_step
+    double h_new;
+    if (team->error_estimate == 0.0)
+        h_new = h * 2.0;
+    else
+        h_new = h * safety_factor * pow(tol / team->error_estimate, 0.20);
+
+    if (team->accepted)
+    {
+        *t_current += h;
+        *h_current = fmin(fmax(h_new, h_min), h_max);
+        return 1;
+    }
+    *h_current = fmax(h_new, h_min);
+    return 0;
+}
+
+int rk_par_integrate(rk_par_team *team, double t0, double t_final, const double y0[],
+                     rk_par_rhs f, void *ctx, double tol, double h_initial,
+                     traj_sink *sink, double y_final_out[], rk_stats *stats)
+{
+    double t = t0;
+    double *y = par_buf(team, PAR_Y);
+    double h = h_initial;
+    double h_max = (t_final - t0) / 10.0;
+    double h_min = rk_default_h_min(tol, h_max);
+    int accepted_steps = 0;
+
+    if (stats)
+        rk_stats_reset(stats);
+
+    memcpy(y, y0, team->n_eq * sizeof(double));
+    team->ctl_valid = 0; // O controlador PI começa do zero em cada integração
+
+    if (sink)
+    {
+        RK_CYCLES_BEGIN(c_out);
+        sink_write(sink, t, y);
+        RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
+    }
+
+    while (t < t_final)
+    {
+        if (t + h > t_final)
+            h = t_final - t;
+        if (h <= 1e-12)
+            break;
+
+        double t_before_step = t;
+        (void)t_before_step; // Só usado por RK_STATS_ACCEPT
+        RK_CYCLES_BEGIN(c_step);
+        int status = rk_par_adaptive_one_step(team, &t, y, &h, f, ctx, tol, h_min, h_max);
+        RK_CYCLES_END(stats, RK_PHASE_STEP, c_step);
+        RK_STATS_EVALS(stats, 12);
+
+        if (status == 1)
+        {
+            accepted_steps++;
+            RK_STATS_ACCEPT(stats, t - t_before_step);
+            if (sink)
+            {
+                RK_CYCLES_BEGIN(c_out);
+                sink_write(sink, t, y);
+                RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
+            }
+        }
+        else
+        {
+            RK_STATS_REJECT(stats);
+        }
+    }
+    if (y_final_out)
+        memcpy(y_final_out, y, team->n_eq * sizeof(double));
+    return accepted_steps;
+}
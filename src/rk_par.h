@@ -0,0 +1,80 @@
+#ifndef RK_PAR_H
+#define RK_PAR_H
+
+#include "sink.h"
+#include "rk_stats.h"
+
+/*
+ * Passos Runge-Kutta com o próprio vetor de estado dividido entre threads, para sistemas
+ * com centenas de milhares de equações em que uma única trajetória é o gargalo.
+ *
+ * O time é persistente (SPMD): as threads são criadas uma vez e cada uma é dona de uma
+ * faixa contígua de unidades [begin, end), com fronteiras em múltiplos de 8 (uma linha
+ * de cache por campo quando n_units também é múltiplo de 8). Todos os vetores
+ * do time são tocados primeiro pela thread dona de cada faixa, então em máquinas NUMA as
+ * páginas ficam no nó de quem as usa. Em cada estágio a thread combina os estágios e
+ * avalia a derivada só na sua faixa; entre estágios há uma barreira leve (espera ativa
+ * curta, depois dorme), já que a derivada de uma faixa pode ler o estado das vizinhas.
+ *
+ * O estado é organizado como n_fields vetores de n_units elementos (structure-of-arrays,
+ * n_eq = n_fields * n_units): a unidade i corresponde às equações i, n_units + i, ...
+ * Para a cadeia de pêndulos, unidade = sítio e n_fields = 2 (theta e omega).
+ */
+
+typedef struct rk_par_team rk_par_team;
+
+/**
+ * Derivada de uma faixa: escreve dydt nas equações das unidades [begin, end) de todos
+ * os campos, podendo ler qualquer posição de y. É chamada em paralelo para faixas
+ * disjuntas, então não pode escrever fora da sua; com begin == end (threads sem unidades,
+ * já que as faixas são arredondadas para múltiplos de RK_PAR_GRAIN) não pode escrever nada.
+ */
+typedef void (*rk_par_rhs)(double t, const double y[], double dydt[], int begin, int end, void *ctx);
+
+/**
+ * @brief Cria o time e os vetores temporários para n_fields * n_units equações.
+ * @param n_threads Número de threads (incluindo quem chama); <= 0 usa o número de núcleos.
+ *        Se o sistema não criar todas, o time fica com as que criou (rk_par_num_threads).
+ * @return O time, ou NULL em caso de falha.
+ */
+rk_par_team *rk_par_create(int n_threads, int n_units, int n_fields);
+void rk_par_destroy(rk_par_team *team);
+
+int rk_par_num_threads(const rk_par_team *team);
+
+/**
+ * @brief Faixa de unidades [*begin, *end) da thread tid.
+ */
+void rk_par_range(const rk_par_team *team, int tid, int *begin, int *end);
+
+/**
+ * @brief Um passo RK4 (mesmas operações de rk4_single_step_system, resultado bit a bit igual).
+ *        y_in e y_out podem ser o mesmo vetor.
+ */
+void rk_par_rk4_step(rk_par_team *team, double t, const double y_in[], double h,
+                     rk_par_rhs f, void *ctx, double y_out[]);
+
+/**
+ * @brief Passo adaptativo com RK4 de passo dobrado e o controle de erro de rk_set_error_control,
+ *        como rk_adaptive_one_step: no modo legado, |erro em y[0]| com controlador I; no PI,
+ *        a norma de rk_error_norm (soma dos quadrados reduzida entre as threads) e
+ *        rk_control_factor. Para um sistema grande só o PI controla todas as componentes.
+ *        No PI a soma é feita em outra ordem que a serial, então os passos só coincidem com
+ *        os de rk_adaptive_one_step a menos de arredondamento.
+ * @return 1 se o passo foi aceito, 0 se foi rejeitado (e h_current foi reduzido).
+ */
+int rk_par_adaptive_one_step(rk_par_team *team, double *t_current, double y_current[],
+                             double *h_current, rk_par_rhs f, void *ctx,
+                             double tol, double h_min, double h_max);
+
+/**
+ * @brief Integração adaptativa de t0 a t_final com rk_par_adaptive_one_step
+ *        (mesma interface e limites de passo de RungeKutta_system_adaptive_h, mas h_initial
+ *        tem de ser > 0: rk_initial_step não aceita derivadas por faixa).
+ * @return Número de passos aceitos.
+ */
+int rk_par_integrate(rk_par_team *team, double t0, double t_final, const double y0[],
+                     rk_par_rhs f, void *ctx, double tol, double h_initial,
+                     traj_sink *sink, double y_final_out[], rk_stats *stats);
+
+#endif
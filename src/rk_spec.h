@@ -0,0 +1,105 @@
+#ifndef RK_SPEC_H
+#define RK_SPEC_H
+
+#include <math.h>
+
+#include "rk.h"
+
+/*
+ * Steppers especializados em tempo de compilação.
+ *
+ * rk4_single_step_system e rk_adaptive_one_step recebem f por ponteiro e dimensionam
+ * os vetores com n_eq em tempo de execução, o que impede inlining da derivada,
+ * desenrolamento dos laços e manter o estado em registradores. As macros abaixo geram,
+ * para uma derivada "static inline" e uma dimensão fixa N, versões "static inline" dos
+ * mesmos métodos. As operações seguem exatamente a ordem das versões genéricas, então
+ * (sem -ffast-math) os resultados são idênticos bit a bit.
+ *
+ * A derivada deve ter a forma:  static inline void RHS(double t, const double y[], double dydt[])
+ *
+ * Exemplo:
+ *   RK_DEFINE_RK4_STEPPER(rk4_meu, 2, f_meu_inline)
+ *   RK_DEFINE_DOUBLING_STEPPER(rk_adapt_meu, rk4_meu, 2)
+ */
+
+/**
+ * Gera: static inline void NAME(double t, const double y_in[], double h, double y_out[])
+ * (RK4 clássico, mesma interface de rk4_single_step_system sem n_eq e f).
+ */
+#define RK_DEFINE_RK4_STEPPER(NAME, N, RHS)                                                  \
+    static inline void NAME(double t, const double y_in[], double h, double y_out[])         \
+    {                                                                                        \
+        double k1[N], k2[N], k3[N], k4[N], y_temp[N];                                        \
+        int i;                                                                               \
+        RHS(t, y_in, k1);                                                                    \
+        for (i = 0; i < (N); ++i)                                                            \
+            y_temp[i] = y_in[i] + (h / 2.0) * k1[i];                                         \
+        RHS(t + h / 2.0, y_temp, k2);                                                        \
+        for (i = 0; i < (N); ++i)                                                            \
+            y_temp[i] = y_in[i] + (h / 2.0) * k2[i];                                         \
+        RHS(t + h / 2.0, y_temp, k3);                                                        \
+        for (i = 0; i < (N); ++i)                                                            \
+            y_temp[i] = y_in[i] + h * k3[i];                                                 \
+        RHS(t + h, y_temp, k4);                                                              \
+        for (i = 0; i < (N); ++i)                                                            \
+            y_out[i] = y_in[i] + (h / 6.0) * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);    \
+    }
+
+/**
+ * Gera: static inline int NAME(double *t_current, double y_current[], double *h_current,
+ *                              double tol, double h_min, double h_max, rk_control_state *ctl)
+ * (RK4 com passo dobrado, mesma lógica de rk_adaptive_one_step, incluindo o controle de
+ * erro selecionado; ctl guarda o estado do controlador PI entre os passos da integração
+ * e RK4NAME deve ter sido gerado por RK_DEFINE_RK4_STEPPER com a mesma dimensão N).
+ */
+#define RK_DEFINE_DOUBLING_STEPPER(NAME, RK4NAME, N)                                         \
+    static inline int NAME(double *t_current, double y_current[], double *h_current,         \
+                           double tol, double h_min, double h_max, rk_control_state *ctl)    \
+    {                                                                                        \
+        double y1[N], y2_half1[N], y2[N];                                                    \
+        double h = *h_current;                                                               \
+        double h_half = h / 2.0;                                                             \
+        double safety_factor = 0.9;                                                          \
+        double h_new;                                                                        \
+        int i;                                                                               \
+        RK4NAME(*t_current, y_current, h, y1);                                               \
+        RK4NAME(*t_current, y_current, h_half, y2_half1);                                    \
+        RK4NAME(*t_current + h_half, y2_half1, h_half, y2);                                  \
+        if (rk_get_error_control()->mode == RK_CONTROL_PI)                                   \
+        {                                                                                    \
+            double err[N];                                                                   \
+            for (i = 0; i < (N); ++i)                                                        \
+                err[i] = (y2[i] - y1[i]) / 15.0;                                             \
+            double error_norm = rk_error_norm((N), err, y_current, y2, tol);                 \
+            int accepted = error_norm <= 1.0 || h <= h_min * 1.0001;                         \
+            double factor = rk_control_factor(ctl, error_norm, 4, accepted);                 \
+            if (!accepted)                                                                   \
+            {                                                                                \
+                *h_current = fmax(h * factor, h_min);                                        \
+                return 0;                                                                    \
+            }                                                                                \
+            *t_current += h;                                                                 \
+            for (i = 0; i < (N); ++i)                                                        \
+                y_current[i] = y2[i] + (y2[i] - y1[i]) / 15.0;                               \
+            *h_current = fmin(fmax(h * factor, h_min), h_max);                               \
+            return 1;                                                                        \
+        }                                                                                    \
+        double error_estimate = fabs(y2[0] - y1[0]) / 15.0;                                  \
+        if (error_estimate <= tol || h <= h_min * 1.0001)                                    \
+        {                                                                                    \
+            *t_current += h;                                                                 \
+            for (i = 0; i < (N); ++i)                                                        \
+                y_current[i] = y2[i] + (y2[i] - y1[i]) / 15.0;                               \
+            if (error_estimate == 0.0)                                                       \
+                h_new = h * 2.0;                                                             \
+            else                                                                             \
+                h_new = h * safety_factor * pow(tol / error_estimate, 0.20);                 \
+            *h_current = fmin(fmax(h_new, h_min), h_max);                                    \
+            return 1;                                                                        \
+        }                                                                                    \
+        h_new = h * safety_factor * pow(tol / error_estimate, 0.20);                         \
+        *h_current = fmax(h_new, h_min);                                                     \
+        return 0;                                                                            \
+    }
+
+#endif
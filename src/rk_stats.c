@@ -0,0 +1,77 @@
+#include <math.h>
+#include <string.h>
+
+#include "rk_stats.h"
+
+void rk_stats_reset(rk_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->h_min = INFINITY;
+}
+
+double rk_stats_mean_h(const rk_stats *stats)
+{
+    return stats->accepted_steps ? stats->h_sum / (double)stats->accepted_steps : 0.0;
+}
+
+void rk_stats_merge(rk_stats *dst, const rk_stats *src)
+{
+    int k;
+    dst->accepted_steps += src->accepted_steps;
+    dst->rejected_steps += src->rejected_steps;
+    dst->rhs_evals += src->rhs_evals;
+    dst->h_min = fmin(dst->h_min, src->h_min);
+    dst->h_max = fmax(dst->h_max, src->h_max);
+    dst->h_sum += src->h_sum;
+    for (k = 0; k < RK_STATS_HIST_BINS; ++k)
+        dst->h_histogram[k] += src->h_histogram[k];
+    for (k = 0; k < RK_PHASE_COUNT; ++k)
+        dst->cycles[k] += src->cycles[k];
+}
+
+void rk_stats_record_steps(rk_stats *stats, double h, long count)
+{
+    int e;
+    if (count <= 0)
+        return;
+    stats->accepted_steps += count;
+    stats->h_sum += h * (double)count;
+    if (h < stats->h_min)
+        stats->h_min = h;
+    if (h > stats->h_max)
+        stats->h_max = h;
+
+    // h = m * 2^e com 0.5 <= m < 1, ou seja, floor(log2(h)) = e - 1
+    frexp(h, &e);
+    int bin = e - 1 + RK_STATS_HIST_OFFSET;
+    if (bin < 0)
+        bin = 0;
+    if (bin >= RK_STATS_HIST_BINS)
+        bin = RK_STATS_HIST_BINS - 1;
+    stats->h_histogram[bin] += count;
+}
+
+void rk_stats_print(FILE *fp, const char *label, const rk_stats *stats)
+{
+    static const char *const phase_names[RK_PHASE_COUNT] = { "step", "event", "output" };
+    int k;
+
+    fprintf(fp, "%s: aceitos=%ld, rejeitados=%ld, avaliacoes_f=%ld", label,
+            stats->accepted_steps, stats->rejected_steps, stats->rhs_evals);
+    if (stats->accepted_steps)
+        fprintf(fp, ", h_min=%.3e, h_max=%.3e, h_medio=%.3e",
+                stats->h_min, stats->h_max, rk_stats_mean_h(stats));
+    fprintf(fp, "\n");
+
+    for (k = 0; k < RK_STATS_HIST_BINS; ++k)
+    {
+        if (stats->h_histogram[k])
+            fprintf(fp, "  h em [2^%d, 2^%d): %ld\n", k - RK_STATS_HIST_OFFSET,
+                    k + 1 - RK_STATS_HIST_OFFSET, stats->h_histogram[k]);
+    }
+    for (k = 0; k < RK_PHASE_COUNT; ++k)
+    {
+        if (stats->cycles[k])
+            fprintf(fp, "  ciclos[%s] = %llu\n", phase_names[k], stats->cycles[k]);
+    }
+}
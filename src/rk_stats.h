@@ -0,0 +1,96 @@
+#ifndef RK_STATS_H
+#define RK_STATS_H
+
+#include <stdio.h>
+
+/*
+ * Estatísticas dos integradores. Todas as funções de integração recebem um
+ * rk_stats* opcional (NULL = não coletar), que é zerado no início da chamada e
+ * preenchido ao longo dela; use rk_stats_merge para acumular várias chamadas.
+ *
+ * A coleta só é compilada com -DRK_ENABLE_STATS (make STATS=1, o padrão); sem ela
+ * as macros RK_STATS_* viram ((void)0) e o caminho quente não paga nada.
+ * Com -DRK_ENABLE_CYCLES (make CYCLES=1, x86) também são contados ciclos por fase.
+ */
+
+// Histograma de h em potências de 2: a faixa k conta os passos aceitos com
+// 2^(k - RK_STATS_HIST_OFFSET) <= h < 2^(k + 1 - RK_STATS_HIST_OFFSET) (as pontas acumulam o resto).
+#define RK_STATS_HIST_BINS 32
+#define RK_STATS_HIST_OFFSET 28
+
+typedef enum
+{
+    RK_PHASE_STEP = 0, // Passos do integrador (aceitos e rejeitados)
+    RK_PHASE_EVENT,    // Localização dos cruzamentos
+    RK_PHASE_OUTPUT,   // Gravação no sink
+    RK_PHASE_COUNT
+} rk_phase;
+
+typedef struct
+{
+    long accepted_steps;
+    long rejected_steps;
+    long rhs_evals;
+    double h_min; // Sobre os passos aceitos
+    double h_max;
+    double h_sum;
+    long h_histogram[RK_STATS_HIST_BINS];
+    unsigned long long cycles[RK_PHASE_COUNT];
+} rk_stats;
+
+// Zera os contadores (h_min começa em +infinito).
+void rk_stats_reset(rk_stats *stats);
+double rk_stats_mean_h(const rk_stats *stats);
+
+// Acumula src em dst (ex.: somar as estatísticas de vários ângulos).
+void rk_stats_merge(rk_stats *dst, const rk_stats *src);
+
+void rk_stats_print(FILE *fp, const char *label, const rk_stats *stats);
+
+// Registra count passos aceitos de tamanho h (uso interno das macros).
+void rk_stats_record_steps(rk_stats *stats, double h, long count);
+
+#ifdef RK_ENABLE_STATS
+#define RK_STATS_ENABLED 1
+#define RK_STATS_ACCEPT(s, h) RK_STATS_STEPS(s, h, 1)
+#define RK_STATS_STEPS(s, h, count)             \
+    do                                          \
+    {                                           \
+        if (s)                                  \
+            rk_stats_record_steps(s, h, count); \
+    } while (0)
+#define RK_STATS_REJECT(s)           \
+    do                               \
+    {                                \
+        if (s)                       \
+            (s)->rejected_steps++;   \
+    } while (0)
+#define RK_STATS_EVALS(s, n)         \
+    do                               \
+    {                                \
+        if (s)                       \
+            (s)->rhs_evals += (n);   \
+    } while (0)
+#else
+#define RK_STATS_ENABLED 0
+#define RK_STATS_ACCEPT(s, h) ((void)0)
+#define RK_STATS_STEPS(s, h, count) ((void)0)
+#define RK_STATS_REJECT(s) ((void)0)
+#define RK_STATS_EVALS(s, n) ((void)0)
+#endif
+
+#if defined(RK_ENABLE_STATS) && defined(RK_ENABLE_CYCLES)
+#include <x86intrin.h>
+#define RK_CYCLES_BEGIN(var) unsigned long long var = __rdtsc()
+#define RK_CYCLES_END(s, phase, var)                 \
+    do                                               \
+    {                                                \
+        if (s)                                       \
+            (s)->cycles[phase] += __rdtsc() - (var); \
+    } while (0)
+#else
+#define RK_CYCLES_BEGIN(var) ((void)0)
+#define RK_CYCLES_END(s, phase, var) ((void)0)
+#endif
+
+#endif
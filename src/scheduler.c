@@ -0,0 +1,335 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+
+/*
+ * A deque 0 pertence à thread externa que usa o pool (normalmente a main); as
+ * deques 1..n-1 pertencem às threads criadas por sched_create. Cada deque é um
+ * buffer circular protegido por mutex: o dono opera no fundo, ladrões no topo.
+ */
+
+typedef struct
+{
+    sched_task_fn fn;
+    void *arg;
+    int index;
+    sched_group *group;
+} sched_task;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    sched_task *tasks;
+    long capacity;
+    long top;    // Tarefa mais antiga (lado do roubo)
+    long bottom; // Uma posição após a tarefa mais nova (lado do dono)
+} sched_deque;
+
+struct sched_group
+{
+    sched_pool *pool;
+    atomic_int pending;
+};
+
+typedef struct
+{
+    sched_pool *pool;
+    int id;
+} worker_arg;
+
+struct sched_pool
+{
+    int n_threads;
+    pthread_t *threads;
+    worker_arg *args;
+    sched_deque *deques;
+    atomic_int queued; // Tarefas em todas as deques, para as threads ociosas dormirem
+    atomic_int stop;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+};
+
+static _Thread_local sched_pool *worker_pool = NULL;
+static _Thread_local int worker_id = 0;
+static _Thread_local unsigned worker_seed = 12345u;
+
+static int current_worker(const sched_pool *pool)
+{
+    return (worker_pool == pool) ? worker_id : 0;
+}
+
+// Retorna 0 se faltou memória.
+static int deque_init(sched_deque *dq)
+{
+    dq->capacity = 64;
+    dq->tasks = malloc(dq->capacity * sizeof(sched_task));
+    dq->top = 0;
+    dq->bottom = 0;
+    if (!dq->tasks)
+        return 0;
+    pthread_mutex_init(&dq->lock, NULL);
+    return 1;
+}
+
+static void deque_free(sched_deque *dq)
+{
+    pthread_mutex_destroy(&dq->lock);
+    free(dq->tasks);
+}
+
+static void deque_push(sched_deque *dq, sched_task task)
+{
+    pthread_mutex_lock(&dq->lock);
+    long count = dq->bottom - dq->top;
+    if (count == dq->capacity)
+    { // Dobra a capacidade preservando a ordem
+        sched_task *grown = malloc(2 * dq->capacity * sizeof(sched_task));
+        if (!grown)
+        { // Sem como agendar a tarefa: continuar perderia trabalho do grupo em silêncio
+            fprintf(stderr, "sched: sem memória para %ld tarefas na fila\n", 2 * dq->capacity);
+            abort();
+        }
+        for (long i = 0; i < count; ++i)
+            grown[i] = dq->tasks[(dq->top + i) % dq->capacity];
+        free(dq->tasks);
+        dq->tasks = grown;
+        dq->capacity *= 2;
+        dq->top = 0;
+        dq->bottom = count;
+    }
+    dq->tasks[dq->bottom % dq->capacity] = task;
+    dq->bottom++;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+static int deque_pop(sched_deque *dq, sched_task *task)
+{
+    int found = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top)
+    {
+        dq->bottom--;
+        *task = dq->tasks[dq->bottom % dq->capacity];
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+static int deque_steal(sched_deque *dq, sched_task *task)
+{
+    int found = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top)
+    {
+        *task = dq->tasks[dq->top % dq->capacity];
+        dq->top++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+// Procura trabalho: primeiro na própria deque, depois rouba de uma vítima aleatória.
+static int find_task(sched_pool *pool, int self, sched_task *task)
+{
+    if (deque_pop(&pool->deques[self], task))
+        goto found;
+
+    int n = pool->n_threads;
+    worker_seed = worker_seed * 1103515245u + 12345u;
+    int start = (int)((worker_seed >> 16) % (unsigned)n);
+    for (int k = 0; k < n; ++k)
+    {
+        int victim = (start + k) % n;
+        if (victim != self && deque_steal(&pool->deques[victim], task))
+            goto found;
+    }
+    return 0;
+
+found:
+    atomic_fetch_sub(&pool->queued, 1);
+    return 1;
+}
+
+static void run_task(const sched_task *task)
+{
+    task->fn(task->arg, task->index);
+    atomic_fetch_sub(&task->group->pending, 1);
+}
+
+static void *worker_main(void *p)
+{
+    worker_arg *wa = (worker_arg *)p;
+    sched_pool *pool = wa->pool;
+    worker_pool = pool;
+    worker_id = wa->id;
+    worker_seed = 2654435761u * (unsigned)(wa->id + 1);
+
+    while (!atomic_load(&pool->stop))
+    {
+        sched_task task;
+        if (find_task(pool, worker_id, &task))
+        {
+            run_task(&task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->idle_lock);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop))
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return NULL;
+}
+
+/*
+ * Encerra as threads 1..n_started-1, libera os n_deques primeiros deques e o pool. Usada
+ * por sched_destroy e para desfazer uma criação que falhou no meio.
+ */
+static void pool_teardown(sched_pool *pool, int n_started, int n_deques)
+{
+    pthread_mutex_lock(&pool->idle_lock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (int i = 1; i < n_started; ++i)
+        pthread_join(pool->threads[i], NULL);
+    for (int i = 0; i < n_deques; ++i)
+        deque_free(&pool->deques[i]);
+
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool->args);
+    free(pool);
+}
+
+sched_pool *sched_create(int n_threads)
+{
+    if (n_threads <= 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (n > 0) ? (int)n : 1;
+    }
+
+    sched_pool *pool = calloc(1, sizeof(sched_pool));
+    if (!pool)
+        return NULL;
+    pool->n_threads = n_threads;
+    pool->deques = malloc(n_threads * sizeof(sched_deque));
+    pool->threads = malloc(n_threads * sizeof(pthread_t));
+    pool->args = malloc(n_threads * sizeof(worker_arg));
+    if (!pool->deques || !pool->threads || !pool->args)
+    {
+        free(pool->deques);
+        free(pool->threads);
+        free(pool->args);
+        free(pool);
+        return NULL;
+    }
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->stop, 0);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+
+    int n_deques = 0;
+    while (n_deques < n_threads && deque_init(&pool->deques[n_deques]))
+        n_deques++;
+    if (n_deques < n_threads)
+    {
+        pool_teardown(pool, 1, n_deques);
+        return NULL;
+    }
+
+    // A thread 0 é quem chama sched_wait; as demais são criadas aqui
+    for (int i = 1; i < n_threads; ++i)
+    {
+        pool->args[i].pool = pool;
+        pool->args[i].id = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0)
+        {
+            pool_teardown(pool, i, n_threads);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void sched_destroy(sched_pool *pool)
+{
+    if (!pool)
+        return;
+    pool_teardown(pool, pool->n_threads, pool->n_threads);
+}
+
+int sched_num_threads(const sched_pool *pool)
+{
+    return pool->n_threads;
+}
+
+sched_group *sched_group_create(sched_pool *pool)
+{
+    sched_group *group = malloc(sizeof(sched_group));
+    if (!group)
+        return NULL;
+    group->pool = pool;
+    atomic_init(&group->pending, 0);
+    return group;
+}
+
+void sched_group_destroy(sched_group *group)
+{
+    free(group);
+}
+
+void sched_spawn(sched_group *group, sched_task_fn fn, void *arg, int index)
+{
+    sched_pool *pool = group->pool;
+    sched_task task = {fn, arg, index, group};
+
+    atomic_fetch_add(&group->pending, 1);
+    deque_push(&pool->deques[current_worker(pool)], task);
+    atomic_fetch_add(&pool->queued, 1);
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_signal(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+void sched_wait(sched_group *group)
+{
+    sched_pool *pool = group->pool;
+    int self = current_worker(pool);
+
+    while (atomic_load(&group->pending) > 0)
+    {
+        sched_task task;
+        if (find_task(pool, self, &task))
+            run_task(&task);
+        else
+            sched_yield(); // O restante do grupo está em execução em outras threads
+    }
+}
+
+void sched_parallel_for(sched_pool *pool, int n, sched_task_fn fn, void *arg)
+{
+    sched_group *group = sched_group_create(pool);
+    if (!group)
+    {
+        fprintf(stderr, "sched: sem memória para o grupo de %d tarefas\n", n);
+        abort();
+    }
+    // Agendadas em ordem inversa: o dono executa LIFO, então começa pelo índice 0
+    for (int i = n - 1; i >= 0; --i)
+        sched_spawn(group, fn, arg, i);
+    sched_wait(group);
+    sched_group_destroy(group);
+}
@@ -0,0 +1,61 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/*
+ * Escalonador de tarefas com pool persistente de threads e roubo de trabalho.
+ * Cada thread tem sua própria deque: novas tarefas entram no fundo da deque de
+ * quem as cria e são executadas em ordem LIFO; threads ociosas roubam do topo
+ * das deques alheias. Isso equilibra tarefas de custo muito diferente (theta0 = 3.0
+ * custa muito mais que 0.1) sem uma divisão estática do trabalho.
+ *
+ * Dependências são expressas com grupos: uma tarefa pode criar subtarefas no mesmo
+ * grupo (ou em outro) e sched_wait só retorna quando todo o grupo terminou.
+ * A ordem dos resultados é responsabilidade de quem chama: cada tarefa recebe seu
+ * índice e escreve no seu próprio slot, e a saída é gerada depois, em ordem.
+ */
+
+typedef struct sched_pool sched_pool;
+typedef struct sched_group sched_group;
+
+// Corpo de uma tarefa: arg é compartilhado, index identifica a tarefa.
+typedef void (*sched_task_fn)(void *arg, int index);
+
+/**
+ * @brief Cria o pool com n_threads threads (incluindo a thread que chama sched_wait).
+ * @param n_threads Número de threads; <= 0 usa o número de núcleos disponíveis.
+ * @return O pool, ou NULL em caso de falha.
+ */
+sched_pool *sched_create(int n_threads);
+
+/**
+ * @brief Encerra as threads do pool e libera a memória. Não pode haver tarefas pendentes.
+ */
+void sched_destroy(sched_pool *pool);
+
+int sched_num_threads(const sched_pool *pool);
+
+/**
+ * @brief Cria/libera um grupo de tarefas (alocado no heap).
+ * @return O grupo, ou NULL se faltou memória.
+ */
+sched_group *sched_group_create(sched_pool *pool);
+void sched_group_destroy(sched_group *group);
+
+/**
+ * @brief Agenda fn(arg, index) no grupo. Pode ser chamada de dentro de outra tarefa.
+ *        Se faltar memória para crescer a fila, imprime uma mensagem e aborta.
+ */
+void sched_spawn(sched_group *group, sched_task_fn fn, void *arg, int index);
+
+/**
+ * @brief Espera todas as tarefas do grupo; a thread que espera também executa tarefas.
+ */
+void sched_wait(sched_group *group);
+
+/**
+ * @brief Atalho: executa fn(arg, i) para i em [0, n) e espera o término.
+ *        Se faltar memória para o grupo ou para a fila, imprime uma mensagem e aborta.
+ */
+void sched_parallel_for(sched_pool *pool, int n, sched_task_fn fn, void *arg);
+
+#endif
@@ -0,0 +1,770 @@
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "pendulo.h"
+#include "rk.h"
+#include "timing.h"
+#include "bench_harness.h"
+
+// Consultas enfileiradas para os workers antes de quem lê esperar (contrapressão).
+#define SERVER_QUEUE_CAPACITY 1024
+// Jobs de uma sessão lidos e ainda não gravados. É também a capacidade da fila de
+// resultados da sessão, então um worker nunca espera por ela: quem espera é quem lê.
+#define SERVER_SESSION_MAX_PENDING 1024
+#define SERVER_ID_LEN 64
+#define SERVER_MAX_PERIODS 1000000
+// Intervalo com que o laço de accept confere se deve parar.
+#define SERVER_POLL_MS 200
+
+/* ------------------------------------------------------------ fila bloqueante */
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    void **items;
+    int capacity;
+    int head;
+    int count;
+    int closed;
+} job_queue;
+
+static int queue_init(job_queue *q, int capacity)
+{
+    q->items = malloc(capacity * sizeof(void *));
+    if (!q->items)
+        return 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    q->capacity = capacity;
+    q->head = q->count = q->closed = 0;
+    return 1;
+}
+
+static void queue_destroy(job_queue *q)
+{
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->items);
+}
+
+static void queue_push(job_queue *q, void *item)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    q->items[(q->head + q->count) % q->capacity] = item;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Retira o item mais antigo; com wait = 0 não bloqueia. NULL: vazia (e fechada, se wait).
+static void *queue_pop(job_queue *q, int wait)
+{
+    void *item = NULL;
+    pthread_mutex_lock(&q->lock);
+    while (wait && q->count == 0 && !q->closed)
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    if (q->count > 0)
+    {
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+static void queue_close(job_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* ------------------------------------------------------------------ tipos */
+
+typedef enum
+{
+    JOB_QUERY = 0,
+    JOB_STATS,
+    JOB_ERROR,
+    JOB_SHUTDOWN
+} job_kind;
+
+#define METHOD_ADAPTIVE (-1)
+
+typedef struct server_session server_session;
+
+typedef struct
+{
+    server_session *session;
+    job_kind kind;
+    char id[SERVER_ID_LEN];
+    char error[96];
+    double t_received;
+    // Consulta
+    int method; // pendulo_fixed_method ou METHOD_ADAPTIVE
+    double theta0, h, tol, h0;
+    int periods;
+    // Resultado
+    int ok;
+    double period;
+    int steps;
+    rk_stats stats;
+} server_job;
+
+typedef struct
+{
+    const server_config *cfg;
+    job_queue jobs;
+    pthread_t *workers;
+    int n_workers;
+    atomic_int stop;
+    // Sessões abertas no socket
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    int active_sessions;
+} server;
+
+struct server_session
+{
+    server *srv;
+    FILE *in, *out;
+    job_queue results;
+    pthread_t writer;
+    // Jobs lidos e ainda não gravados (nos workers ou na fila de resultados)
+    pthread_mutex_t lock;
+    pthread_cond_t has_room;
+    pthread_cond_t drained;
+    long pending;
+    // Só a thread de escrita mexe daqui para baixo
+    double t_start;
+    double t_last;
+    double *latency_us;
+    long n_latency, cap_latency;
+    long errors;
+};
+
+/* ------------------------------------------------------------------ parse */
+
+// Próximo token da linha; separadores são espaços, '=', ':', ',', '{' e '}'. Um token entre
+// aspas vai até a aspa seguinte.
+static char *next_token(char **cursor)
+{
+    char *p = *cursor;
+    while (*p && strchr(" \t\r\n=:,{}", *p))
+        p++;
+    if (!*p)
+        return NULL;
+    char *start = p;
+    if (*p == '"')
+    {
+        start = ++p;
+        while (*p && *p != '"')
+            p++;
+    }
+    else
+    {
+        while (*p && !strchr(" \t\r\n=:,{}\"", *p))
+            p++;
+    }
+    if (*p)
+        *p++ = '\0';
+    *cursor = p;
+    return start;
+}
+
+static int parse_double(const char *s, double *out)
+{
+    char *end;
+    errno = 0;
+    *out = strtod(s, &end);
+    return end != s && *end == '\0' && errno == 0 && isfinite(*out);
+}
+
+static int parse_method(const char *name, int *method)
+{
+    if (strcmp(name, "adaptive") == 0)
+    {
+        *method = METHOD_ADAPTIVE;
+        return 1;
+    }
+    for (int m = 0; m < PENDULO_FIXED_COUNT; ++m)
+    {
+        if (strcmp(name, pendulo_fixed_method_name((pendulo_fixed_method)m)) == 0)
+        {
+            *method = m;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Id devolvido nos resultados: sem aspas, barras invertidas ou caracteres de controle
+// (no CSV, um id com vírgula sai entre aspas; ver csv_id).
+static void copy_id(char dst[SERVER_ID_LEN], const char *src)
+{
+    int i;
+    for (i = 0; i < SERVER_ID_LEN - 1 && src[i]; ++i)
+        dst[i] = (src[i] == '"' || src[i] == '\\' || (unsigned char)src[i] < 0x20) ? '_' : src[i];
+    dst[i] = '\0';
+}
+
+static server_job *job_error(server_job *job, const char *message)
+{
+    job->kind = JOB_ERROR;
+    snprintf(job->error, sizeof(job->error), "%s", message);
+    return job;
+}
+
+/**
+ * @brief Converte uma linha num job (a linha é modificada).
+ * @return O job, ou NULL para linhas vazias, comentários ou falta de memória.
+ */
+static server_job *parse_line(server_session *s, char *line, double t_received)
+{
+    char *cursor = line;
+    char *key = next_token(&cursor);
+    if (!key || key[0] == '#')
+        return NULL;
+
+    server_job *job = calloc(1, sizeof(server_job));
+    if (!job)
+        return NULL;
+    job->session = s;
+    job->t_received = t_received;
+    if (strcmp(key, "stats") == 0 && !next_token(&cursor))
+    {
+        job->kind = JOB_STATS;
+        return job;
+    }
+    if (strcmp(key, "shutdown") == 0 && !next_token(&cursor))
+    {
+        job->kind = JOB_SHUTDOWN;
+        return job;
+    }
+
+    int have_theta0 = 0, have_h = 0, have_tol = 0, have_method = 0;
+    job->kind = JOB_QUERY;
+    job->tol = 1e-7;
+    job->periods = 1;
+    for (; key; key = next_token(&cursor))
+    {
+        char *value = next_token(&cursor);
+        double v;
+        if (!value)
+            return job_error(job, "chave sem valor");
+        if (strcmp(key, "id") == 0)
+        {
+            copy_id(job->id, value);
+            continue;
+        }
+        if (strcmp(key, "method") == 0)
+        {
+            if (!parse_method(value, &job->method))
+                return job_error(job, "metodo desconhecido");
+            have_method = 1;
+            continue;
+        }
+        if (!parse_double(value, &v))
+            return job_error(job, "valor numerico invalido");
+        if (strcmp(key, "theta0") == 0)
+        {
+            job->theta0 = v;
+            have_theta0 = 1;
+        }
+        else if (strcmp(key, "h") == 0)
+        {
+            job->h = v;
+            have_h = 1;
+        }
+        else if (strcmp(key, "tol") == 0)
+        {
+            job->tol = v;
+            have_tol = 1;
+        }
+        else if (strcmp(key, "h0") == 0)
+            job->h0 = v;
+        else if (strcmp(key, "periods") == 0)
+            job->periods = (v >= 1 && v <= SERVER_MAX_PERIODS && v == floor(v)) ? (int)v : 0;
+        else
+            return job_error(job, "chave desconhecida");
+    }
+
+    if (!have_method)
+        job->method = (have_h && !have_tol) ? PENDULO_FIXED_RK4 : METHOD_ADAPTIVE;
+    // Acima de pi o pêndulo gira sem inverter o movimento e o detector não terminaria
+    if (!have_theta0 || job->theta0 == 0.0 || fabs(job->theta0) >= M_PI)
+        return job_error(job, "theta0 deve estar em (-pi, pi) e ser diferente de zero");
+    if (job->periods == 0)
+        return job_error(job, "periods deve ser inteiro entre 1 e 1000000");
+    if (job->method != METHOD_ADAPTIVE && !(job->h > 0.0))
+        return job_error(job, "metodo de passo fixo exige h > 0");
+    if (job->method == METHOD_ADAPTIVE && !(job->tol > 0.0))
+        return job_error(job, "tol deve ser positiva");
+    return job;
+}
+
+/* ---------------------------------------------------------------- workers */
+
+// Não bloqueia: a fila de resultados comporta todos os jobs pendentes da sessão.
+static void job_done(server_job *job)
+{
+    queue_push(&job->session->results, job);
+}
+
+// Chamada por quem lê antes de entregar um job: espera enquanto a sessão tiver
+// SERVER_SESSION_MAX_PENDING jobs sem gravar (um cliente que não lê os resultados só trava
+// a própria sessão, nunca os workers).
+static void session_reserve(server_session *s)
+{
+    pthread_mutex_lock(&s->lock);
+    while (s->pending >= SERVER_SESSION_MAX_PENDING)
+        pthread_cond_wait(&s->has_room, &s->lock);
+    s->pending++;
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Chamada pela thread de escrita depois de gravar um job.
+static void session_release(server_session *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->pending--;
+    pthread_cond_signal(&s->has_room);
+    if (s->pending == 0)
+        pthread_cond_signal(&s->drained);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void *worker_main(void *arg)
+{
+    server *srv = (server *)arg;
+    period_cache *cache = srv->cfg->cache;
+    server_job *job;
+
+    while ((job = queue_pop(&srv->jobs, 1)) != NULL)
+    {
+        if (job->method == METHOD_ADAPTIVE)
+            job->ok = period_cache_adaptive(cache, job->theta0, job->tol, job->h0, job->periods,
+                                            &job->period, &job->steps, &job->stats);
+        else
+            job->ok = period_cache_fixed(cache, (pendulo_fixed_method)job->method, job->theta0, job->h,
+                                         job->periods, &job->period, &job->steps, &job->stats);
+        job_done(job);
+    }
+    return NULL;
+}
+
+/* ----------------------------------------------------------------- escrita */
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void session_summary(const server_session *s, server_summary *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->queries = s->n_latency;
+    out->errors = s->errors;
+    out->elapsed_s = s->t_last - s->t_start;
+    if (s->n_latency == 0)
+        return;
+    double *sorted = malloc(s->n_latency * sizeof(double));
+    if (!sorted)
+        return;
+    memcpy(sorted, s->latency_us, s->n_latency * sizeof(double));
+    qsort(sorted, s->n_latency, sizeof(double), compare_double);
+    out->p50_us = bench_percentile(sorted, (int)s->n_latency, 50.0);
+    out->p90_us = bench_percentile(sorted, (int)s->n_latency, 90.0);
+    out->p99_us = bench_percentile(sorted, (int)s->n_latency, 99.0);
+    out->max_us = sorted[s->n_latency - 1];
+    free(sorted);
+}
+
+static void record_latency(server_session *s, double latency_us)
+{
+    if (s->n_latency == s->cap_latency)
+    {
+        long cap = s->cap_latency ? 2 * s->cap_latency : 1024;
+        double *grown = realloc(s->latency_us, cap * sizeof(double));
+        if (!grown)
+            return;
+        s->latency_us = grown;
+        s->cap_latency = cap;
+    }
+    s->latency_us[s->n_latency++] = latency_us;
+}
+
+// Campo id do CSV: entre aspas se tiver vírgula (copy_id já removeu as aspas).
+static const char *csv_id(const server_job *job, char buf[SERVER_ID_LEN + 2])
+{
+    if (!strchr(job->id, ','))
+        return job->id;
+    snprintf(buf, SERVER_ID_LEN + 2, "\"%s\"", job->id);
+    return buf;
+}
+
+static const char *job_method_name(const server_job *job)
+{
+    return job->method == METHOD_ADAPTIVE ? "adaptive" : pendulo_fixed_method_name((pendulo_fixed_method)job->method);
+}
+
+static void write_job(server_session *s, server_job *job)
+{
+    FILE *out = s->out;
+    int csv = s->srv->cfg->format == SERVER_FORMAT_CSV;
+    char id_buf[SERVER_ID_LEN + 2];
+    double now = timing_now();
+    double latency_us = (now - job->t_received) * 1e6;
+    s->t_last = now;
+
+    if (job->kind == JOB_STATS)
+    {
+        server_summary sum;
+        session_summary(s, &sum);
+        if (csv)
+            fprintf(out, "# stats queries=%ld errors=%ld p50_us=%.1f p90_us=%.1f p99_us=%.1f max_us=%.1f\n",
+                    sum.queries, sum.errors, sum.p50_us, sum.p90_us, sum.p99_us, sum.max_us);
+        else
+            fprintf(out, "{\"stats\":{\"queries\":%ld,\"errors\":%ld,\"p50_us\":%.1f,\"p90_us\":%.1f,"
+                         "\"p99_us\":%.1f,\"max_us\":%.1f}}\n",
+                    sum.queries, sum.errors, sum.p50_us, sum.p90_us, sum.p99_us, sum.max_us);
+        return;
+    }
+    if (job->kind == JOB_ERROR || !job->ok)
+    {
+        s->errors++;
+        const char *message = job->kind == JOB_ERROR ? job->error : "falha na integracao";
+        if (csv)
+            fprintf(out, "%s,,,,,,,,,,,%s\n", csv_id(job, id_buf), message);
+        else
+            fprintf(out, "{\"id\":\"%s\",\"error\":\"%s\"}\n", job->id, message);
+        return;
+    }
+
+    record_latency(s, latency_us);
+    double param = job->method == METHOD_ADAPTIVE ? job->tol : job->h;
+    double error = fabs(job->period - exact_period(job->theta0));
+    if (csv)
+        fprintf(out, "%s,%.17g,%s,%.6g,%d,%.15f,%d,%ld,%ld,%.3e,%.1f,\n", csv_id(job, id_buf), job->theta0,
+                job_method_name(job), param, job->periods, job->period, job->steps,
+                job->stats.rejected_steps, job->stats.rhs_evals, error, latency_us);
+    else
+        fprintf(out, "{\"id\":\"%s\",\"theta0\":%.17g,\"method\":\"%s\",\"param\":%.6g,\"periods\":%d,"
+                     "\"period\":%.15f,\"steps\":%d,\"rejected\":%ld,\"rhs_evals\":%ld,"
+                     "\"error_vs_exact\":%.3e,\"latency_us\":%.1f}\n",
+                job->id, job->theta0, job_method_name(job), param, job->periods, job->period, job->steps,
+                job->stats.rejected_steps, job->stats.rhs_evals, error, latency_us);
+}
+
+// Grava os resultados em lotes: tudo o que já estiver pronto, depois um fflush.
+static void *writer_main(void *arg)
+{
+    server_session *s = (server_session *)arg;
+    server_job *job;
+
+    if (s->srv->cfg->format == SERVER_FORMAT_CSV)
+    {
+        fprintf(s->out, "id,theta0,method,param,periods,period,steps,rejected,rhs_evals,error_vs_exact,latency_us,error\n");
+        fflush(s->out);
+    }
+    while ((job = queue_pop(&s->results, 1)) != NULL)
+    {
+        do
+        {
+            write_job(s, job);
+            free(job);
+            session_release(s);
+        } while ((job = queue_pop(&s->results, 0)) != NULL);
+        fflush(s->out);
+    }
+    return NULL;
+}
+
+/* ----------------------------------------------------------------- sessões */
+
+static int session_run(server *srv, FILE *in, FILE *out, server_summary *summary_out)
+{
+    server_session s;
+    char *line = NULL;
+    size_t line_cap = 0;
+
+    memset(&s, 0, sizeof(s));
+    s.srv = srv;
+    s.in = in;
+    s.out = out;
+    if (!queue_init(&s.results, SERVER_SESSION_MAX_PENDING))
+        return 0;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.has_room, NULL);
+    pthread_cond_init(&s.drained, NULL);
+    s.t_start = s.t_last = timing_now();
+    if (pthread_create(&s.writer, NULL, writer_main, &s) != 0)
+    {
+        pthread_mutex_destroy(&s.lock);
+        pthread_cond_destroy(&s.has_room);
+        pthread_cond_destroy(&s.drained);
+        queue_destroy(&s.results);
+        return 0;
+    }
+
+    int first = 1;
+    while (!atomic_load(&srv->stop) && getline(&line, &line_cap, in) >= 0)
+    {
+        double t = timing_now();
+        if (first)
+        {
+            s.t_start = s.t_last = t;
+            first = 0;
+        }
+        server_job *job = parse_line(&s, line, t);
+        if (!job)
+            continue;
+        if (job->kind == JOB_SHUTDOWN)
+        {
+            free(job);
+            atomic_store(&srv->stop, 1);
+            break;
+        }
+        session_reserve(&s);
+        if (job->kind == JOB_QUERY)
+            queue_push(&srv->jobs, job);
+        else
+            queue_push(&s.results, job);
+    }
+    free(line);
+
+    // Espera todos os jobs desta sessão serem gravados antes de fechar a escrita
+    pthread_mutex_lock(&s.lock);
+    while (s.pending > 0)
+        pthread_cond_wait(&s.drained, &s.lock);
+    pthread_mutex_unlock(&s.lock);
+    queue_close(&s.results);
+    pthread_join(s.writer, NULL);
+
+    server_summary sum;
+    session_summary(&s, &sum);
+    if (!srv->cfg->quiet)
+        fprintf(stderr, "server: %ld consultas (%ld invalidas) em %.3f s, %.0f consultas/s; "
+                        "latencia p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n",
+                sum.queries, sum.errors, sum.elapsed_s, sum.elapsed_s > 0.0 ? sum.queries / sum.elapsed_s : 0.0,
+                sum.p50_us, sum.p90_us, sum.p99_us, sum.max_us);
+    if (summary_out)
+        *summary_out = sum;
+
+    free(s.latency_us);
+    pthread_mutex_destroy(&s.lock);
+    pthread_cond_destroy(&s.has_room);
+    pthread_cond_destroy(&s.drained);
+    queue_destroy(&s.results);
+    return 1;
+}
+
+/* ---------------------------------------------------------------- servidor */
+
+static int server_start(server *srv, const server_config *cfg)
+{
+    memset(srv, 0, sizeof(*srv));
+    srv->cfg = cfg;
+    srv->n_workers = cfg->n_workers > 0 ? cfg->n_workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (srv->n_workers < 1)
+        srv->n_workers = 1;
+    atomic_init(&srv->stop, 0);
+    pthread_mutex_init(&srv->lock, NULL);
+    pthread_cond_init(&srv->idle, NULL);
+    if (!queue_init(&srv->jobs, SERVER_QUEUE_CAPACITY))
+        return 0;
+    srv->workers = malloc(srv->n_workers * sizeof(pthread_t));
+    if (!srv->workers)
+    {
+        queue_destroy(&srv->jobs);
+        return 0;
+    }
+    for (int i = 0; i < srv->n_workers; ++i)
+    {
+        if (pthread_create(&srv->workers[i], NULL, worker_main, srv) != 0)
+        {
+            srv->n_workers = i;
+            queue_close(&srv->jobs);
+            for (int k = 0; k < i; ++k)
+                pthread_join(srv->workers[k], NULL);
+            free(srv->workers);
+            queue_destroy(&srv->jobs);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void server_stop(server *srv)
+{
+    queue_close(&srv->jobs);
+    for (int i = 0; i < srv->n_workers; ++i)
+        pthread_join(srv->workers[i], NULL);
+    free(srv->workers);
+    queue_destroy(&srv->jobs);
+    pthread_mutex_destroy(&srv->lock);
+    pthread_cond_destroy(&srv->idle);
+}
+
+int server_run_stream(const server_config *cfg, FILE *in, FILE *out, server_summary *summary_out)
+{
+    server srv;
+    if (!server_start(&srv, cfg))
+        return 0;
+    int ok = session_run(&srv, in, out, summary_out);
+    server_stop(&srv);
+    return ok;
+}
+
+typedef struct
+{
+    server *srv;
+    int fd;
+} connection;
+
+static void *connection_main(void *arg)
+{
+    connection *c = (connection *)arg;
+    server *srv = c->srv;
+    FILE *in = fdopen(c->fd, "r");
+    int out_fd = dup(c->fd);
+    FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+
+    if (in && out)
+        session_run(srv, in, out, NULL);
+    if (out)
+        fclose(out);
+    else if (out_fd >= 0)
+        close(out_fd);
+    if (in)
+        fclose(in);
+    else
+        close(c->fd);
+    free(c);
+
+    pthread_mutex_lock(&srv->lock);
+    if (--srv->active_sessions == 0)
+        pthread_cond_signal(&srv->idle);
+    pthread_mutex_unlock(&srv->lock);
+    return NULL;
+}
+
+static volatile sig_atomic_t stop_signal = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    stop_signal = 1;
+}
+
+int server_run(const server_config *cfg)
+{
+    if (!cfg->socket_path)
+        return server_run_stream(cfg, stdin, stdout, NULL);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(cfg->socket_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "server: caminho do socket longo demais\n");
+        return 0;
+    }
+    strcpy(addr.sun_path, cfg->socket_path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        perror("server: socket");
+        return 0;
+    }
+    unlink(cfg->socket_path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0)
+    {
+        perror("server: bind/listen");
+        close(listen_fd);
+        return 0;
+    }
+
+    server srv;
+    if (!server_start(&srv, cfg))
+    {
+        close(listen_fd);
+        unlink(cfg->socket_path);
+        return 0;
+    }
+
+    // Um cliente que fecha a conexão não pode derrubar o servidor
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    if (!cfg->quiet)
+        fprintf(stderr, "server: ouvindo em %s com %d workers\n", cfg->socket_path, srv.n_workers);
+
+    while (!stop_signal && !atomic_load(&srv.stop))
+    {
+        struct pollfd pfd = { listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, SERVER_POLL_MS) <= 0)
+            continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        connection *c = malloc(sizeof(connection));
+        pthread_t thread;
+        if (!c)
+        {
+            close(fd);
+            continue;
+        }
+        c->srv = &srv;
+        c->fd = fd;
+        pthread_mutex_lock(&srv.lock);
+        srv.active_sessions++;
+        pthread_mutex_unlock(&srv.lock);
+        if (pthread_create(&thread, NULL, connection_main, c) != 0)
+        {
+            close(fd);
+            free(c);
+            pthread_mutex_lock(&srv.lock);
+            srv.active_sessions--;
+            pthread_mutex_unlock(&srv.lock);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    close(listen_fd);
+    unlink(cfg->socket_path);
+
+    // As sessões abertas terminam quando seus clientes fecham a conexão
+    atomic_store(&srv.stop, 1);
+    pthread_mutex_lock(&srv.lock);
+    while (srv.active_sessions > 0)
+        pthread_cond_wait(&srv.idle, &srv.lock);
+    pthread_mutex_unlock(&srv.lock);
+    server_stop(&srv);
+    return 1;
+}
@@ -0,0 +1,75 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+
+#include "period_cache.h"
+
+/*
+ * Modo servidor: um processo de longa duração que lê consultas de período, uma por linha,
+ * da entrada padrão ou de um socket Unix, e devolve um resultado por linha (NDJSON ou CSV).
+ *
+ * Cada linha é um conjunto de pares chave/valor, no formato chave=valor ou como um objeto
+ * JSON plano:
+ *   theta0=1.0 method=rk4 h=0.001 periods=10 id=a7
+ *   {"id": 3, "theta0": 2.0, "method": "adaptive", "tol": 1e-8}
+ * Chaves: theta0 (obrigatória); method = adaptive (padrão) ou um método de passo fixo
+ * (rk4, verlet, yoshida4, suzuki4, yoshida6; h obrigatório); tol (padrão 1e-7) e h0
+ * (padrão 0 = estimado) do adaptativo; periods (padrão 1); id (devolvido no resultado).
+ * Sem method, uma linha com h e sem tol usa rk4. Linhas vazias e começadas por '#' são
+ * ignoradas; "stats" devolve os percentis de latência até ali e "shutdown" encerra o
+ * servidor (no socket, depois que as conexões abertas terminarem).
+ *
+ * As etapas formam um pipeline: quem lê a conexão só faz o parse e enfileira; workers
+ * integram (pelo cache de períodos, se houver); uma thread de escrita por conexão formata
+ * os resultados e grava em lotes, com um fflush por lote. Os resultados saem na ordem em
+ * que ficam prontos, com o id da consulta. Os workers são threads próprias e não o pool de
+ * scheduler.h, cujas tarefas só começam quando alguém espera o grupo. A contrapressão fica
+ * em quem lê: cada conexão tem um limite de consultas lidas e ainda não gravadas, então um
+ * cliente que não lê os resultados para de ser lido, sem travar os workers nem as outras
+ * conexões. No CSV, um id com vírgula sai entre aspas.
+ *
+ * A latência de cada consulta vai da leitura da linha até a gravação do resultado.
+ */
+
+typedef enum
+{
+    SERVER_FORMAT_NDJSON = 0,
+    SERVER_FORMAT_CSV
+} server_format;
+
+typedef struct
+{
+    int n_workers;           // Threads de integração; <= 0 usa o número de núcleos
+    server_format format;
+    const char *socket_path; // Socket Unix; NULL lê a entrada padrão
+    period_cache *cache;     // Cache de períodos compartilhado (pode ser NULL)
+    int quiet;               // 1: sem o resumo de cada sessão em stderr
+} server_config;
+
+#define SERVER_CONFIG_DEFAULT {0, SERVER_FORMAT_NDJSON, NULL, NULL, 0}
+
+// Resumo de uma sessão (uma conexão ou a entrada padrão).
+typedef struct
+{
+    long queries;
+    long errors;      // Linhas inválidas
+    double elapsed_s; // Da primeira leitura ao último resultado gravado
+    double p50_us, p90_us, p99_us, max_us;
+} server_summary;
+
+/**
+ * @brief Executa o servidor até o fim da entrada padrão, ou no socket até "shutdown",
+ *        SIGINT ou SIGTERM.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int server_run(const server_config *cfg);
+
+/**
+ * @brief Atende uma única sessão lendo de in e gravando em out, até o fim de in ou "shutdown".
+ * @param summary_out Resumo da sessão (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int server_run_stream(const server_config *cfg, FILE *in, FILE *out, server_summary *summary_out);
+
+#endif
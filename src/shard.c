@@ -0,0 +1,248 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shard.h"
+
+int shard_parse(const char *text, shard_spec *spec)
+{
+    int index, count, used;
+    if (sscanf(text, "%d/%d%n", &index, &count, &used) != 2 || text[used] != '\0')
+        return 0;
+    if (count < 1 || index < 0 || index >= count)
+        return 0;
+    spec->index = index;
+    spec->count = count;
+    return 1;
+}
+
+long shard_job_count(const shard_spec *spec, long n_jobs)
+{
+    return n_jobs > spec->index ? (n_jobs - spec->index + spec->count - 1) / spec->count : 0;
+}
+
+uint64_t shard_hash(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+int shard_part_open(shard_part *part, const char *path, const char *sweep, uint64_t config,
+                    const shard_spec *spec, long n_jobs, int n_values, const char *columns)
+{
+    memset(part, 0, sizeof(*part));
+    if (n_values < 1 || n_values > SHARD_MAX_VALUES || strlen(sweep) >= SHARD_NAME_MAX)
+        return 0;
+    if (snprintf(part->path, sizeof(part->path), "%s", path) >= (int)sizeof(part->path) ||
+        snprintf(part->tmp_path, sizeof(part->tmp_path), "%s.tmp", path) >= (int)sizeof(part->tmp_path))
+        return 0;
+    part->fp = fopen(part->tmp_path, "w");
+    if (!part->fp)
+        return 0;
+    part->n_values = n_values;
+
+    fprintf(part->fp, "# pendulo-shard %d\n", SHARD_FORMAT_VERSION);
+    fprintf(part->fp, "sweep %s\n", sweep);
+    fprintf(part->fp, "config %016" PRIx64 "\n", config);
+    fprintf(part->fp, "shard %d %d\n", spec->index, spec->count);
+    fprintf(part->fp, "jobs %ld\n", n_jobs);
+    fprintf(part->fp, "columns %s\n", columns);
+    return 1;
+}
+
+void shard_part_write(shard_part *part, long job, const double values[])
+{
+    fprintf(part->fp, "%ld", job);
+    for (int k = 0; k < part->n_values; ++k)
+        fprintf(part->fp, " %.17g", values[k]);
+    fputc('\n', part->fp);
+    part->n_records++;
+}
+
+int shard_part_close(shard_part *part)
+{
+    if (!part->fp)
+        return 0;
+    fprintf(part->fp, "end %ld\n", part->n_records);
+    int ok = !ferror(part->fp);
+    if (fclose(part->fp) != 0)
+        ok = 0;
+    part->fp = NULL;
+    if (!ok || rename(part->tmp_path, part->path) != 0)
+    {
+        remove(part->tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+// Lê a próxima linha; 0 no fim do arquivo ou se a linha não couber no buffer.
+static int read_line(FILE *fp, char *line, size_t size)
+{
+    if (!fgets(line, (int)size, fp))
+        return 0;
+    size_t len = strlen(line);
+    if (len == 0 || line[len - 1] != '\n')
+        return 0;
+    line[len - 1] = '\0';
+    return 1;
+}
+
+/*
+ * Lê um arquivo parcial para dentro de merged. shard_seen marca os shards já lidos (para
+ * detectar repetidos) e present os jobs já preenchidos. Devolve 1 se o arquivo é válido.
+ */
+static int merge_part(const char *path, const char *sweep, uint64_t config, shard_merged *merged,
+                      unsigned char **shard_seen, unsigned char *present)
+{
+    char line[64 + 32 * SHARD_MAX_VALUES];
+    char name[SHARD_NAME_MAX];
+    int version, index, count, used;
+    uint64_t part_config;
+    long n_jobs, n_records = 0, end_records = -1;
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        perror(path);
+        return 0;
+    }
+
+#define PART_ERROR(...)                                                                                          \
+    do                                                                                                           \
+    {                                                                                                            \
+        fprintf(stderr, "%s: ", path);                                                                           \
+        fprintf(stderr, __VA_ARGS__);                                                                            \
+        fputc('\n', stderr);                                                                                     \
+        fclose(fp);                                                                                              \
+        return 0;                                                                                                \
+    } while (0)
+
+    if (!read_line(fp, line, sizeof(line)) || sscanf(line, "# pendulo-shard %d", &version) != 1)
+        PART_ERROR("nao e um arquivo parcial de shard");
+    if (version != SHARD_FORMAT_VERSION)
+        PART_ERROR("versao %d do formato (esperada %d)", version, SHARD_FORMAT_VERSION);
+    if (!read_line(fp, line, sizeof(line)) || sscanf(line, "sweep %63s", name) != 1)
+        PART_ERROR("cabecalho invalido (sweep)");
+    if (strcmp(name, sweep) != 0)
+        PART_ERROR("varredura '%s' (esperada '%s')", name, sweep);
+    if (!read_line(fp, line, sizeof(line)) || sscanf(line, "config %" SCNx64, &part_config) != 1)
+        PART_ERROR("cabecalho invalido (config)");
+    if (part_config != config)
+        PART_ERROR("configuracao %016" PRIx64 " diferente da atual (%016" PRIx64 ")", part_config, config);
+    if (!read_line(fp, line, sizeof(line)) || sscanf(line, "shard %d %d", &index, &count) != 2 || count < 1 ||
+        index < 0 || index >= count)
+        PART_ERROR("cabecalho invalido (shard)");
+    if (!read_line(fp, line, sizeof(line)) || sscanf(line, "jobs %ld", &n_jobs) != 1)
+        PART_ERROR("cabecalho invalido (jobs)");
+    if (n_jobs != merged->n_jobs)
+        PART_ERROR("%ld jobs (esperados %ld)", n_jobs, merged->n_jobs);
+    if (!read_line(fp, line, sizeof(line)) || strncmp(line, "columns ", 8) != 0)
+        PART_ERROR("cabecalho invalido (columns)");
+    int n_columns = 1;
+    for (const char *c = line + 8; *c; ++c)
+        n_columns += *c == ',';
+    if (n_columns != merged->n_values)
+        PART_ERROR("%d colunas (esperadas %d)", n_columns, merged->n_values);
+
+    if (merged->count == 0)
+    {
+        merged->count = count;
+        *shard_seen = calloc(count, 1);
+        if (!*shard_seen)
+            PART_ERROR("sem memoria");
+    }
+    else if (count != merged->count)
+        PART_ERROR("shard %d/%d, mas os outros arquivos sao de %d shards", index, count, merged->count);
+    if ((*shard_seen)[index])
+        PART_ERROR("shard %d/%d repetido", index, count);
+    (*shard_seen)[index] = 1;
+
+    shard_spec spec = { index, count };
+    while (read_line(fp, line, sizeof(line)))
+    {
+        if (sscanf(line, "end %ld", &end_records) == 1)
+            break;
+        long job;
+        const char *p = line;
+        if (sscanf(p, "%ld%n", &job, &used) != 1)
+            PART_ERROR("registro invalido: %s", line);
+        if (job < 0 || job >= merged->n_jobs || !shard_owns(&spec, job))
+            PART_ERROR("job %ld nao pertence ao shard %d/%d", job, index, count);
+        if (present[job])
+            PART_ERROR("job %ld repetido", job);
+        p += used;
+        double *values = merged->values + job * merged->n_values;
+        for (int k = 0; k < merged->n_values; ++k)
+        {
+            char *end;
+            values[k] = strtod(p, &end);
+            if (end == p)
+                PART_ERROR("registro invalido: %s", line);
+            p = end;
+        }
+        if (*p != '\0')
+            PART_ERROR("registro invalido: %s", line);
+        present[job] = 1;
+        n_records++;
+    }
+    if (end_records < 0)
+        PART_ERROR("arquivo incompleto (sem a linha end)");
+    if (end_records != n_records || n_records != shard_job_count(&spec, merged->n_jobs))
+        PART_ERROR("%ld registros (esperados %ld)", n_records, shard_job_count(&spec, merged->n_jobs));
+#undef PART_ERROR
+
+    fclose(fp);
+    return 1;
+}
+
+int shard_merge(const char *const paths[], int n_paths, const char *sweep, uint64_t config, long n_jobs,
+                int n_values, shard_merged *merged)
+{
+    memset(merged, 0, sizeof(*merged));
+    if (n_values < 1 || n_values > SHARD_MAX_VALUES || n_jobs < 0)
+        return 0;
+    merged->n_jobs = n_jobs;
+    merged->n_values = n_values;
+    merged->values = malloc((size_t)(n_jobs > 0 ? n_jobs : 1) * n_values * sizeof(double));
+    unsigned char *present = calloc(n_jobs > 0 ? n_jobs : 1, 1);
+    unsigned char *shard_seen = NULL;
+    int ok = merged->values && present;
+
+    for (int i = 0; ok && i < n_paths; ++i)
+        ok = merge_part(paths[i], sweep, config, merged, &shard_seen, present);
+
+    if (ok && merged->count == 0)
+    {
+        fprintf(stderr, "shard: nenhum arquivo parcial\n");
+        ok = 0;
+    }
+    for (int s = 0; ok && s < merged->count; ++s)
+    {
+        if (!shard_seen[s])
+        {
+            fprintf(stderr, "shard: falta o arquivo do shard %d/%d\n", s, merged->count);
+            ok = 0;
+        }
+    }
+    // Com todos os shards presentes e cada um completo, todos os jobs foram lidos
+    for (long job = 0; ok && job < n_jobs; ++job)
+        ok = present[job];
+
+    free(present);
+    free(shard_seen);
+    if (!ok)
+        shard_merged_free(merged);
+    return ok;
+}
+
+void shard_merged_free(shard_merged *merged)
+{
+    free(merged->values);
+    memset(merged, 0, sizeof(*merged));
+}
@@ -0,0 +1,113 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Execução de uma varredura em vários processos (shards), possivelmente em máquinas diferentes.
+ *
+ * Uma varredura é um espaço de jobs numerados 0..n_jobs-1. O shard i de n executa os jobs
+ * com job % n == i (intercalados, para que as partes caras da grade se dividam entre os
+ * shards) e grava um arquivo parcial com um registro por job. A junção lê os parciais,
+ * confere que todos vêm da mesma varredura, com a mesma configuração e o mesmo n, e que cada
+ * job aparece exatamente uma vez; os valores ficam indexados pelo job, então a saída é
+ * montada na ordem canônica independentemente da ordem dos arquivos e de quem terminou antes.
+ *
+ * Arquivo parcial (texto, uma diretiva por linha):
+ *   # pendulo-shard 1
+ *   sweep analise_completa
+ *   config 5f0c29e1d3a48b77      impressão digital da configuração (shard_hash), em hexadecimal
+ *   shard 1 4                    índice e número de shards
+ *   jobs 20                      tamanho do espaço de jobs
+ *   columns period,steps,rejected,rhs_evals
+ *   1 6.3130599... 644 0 3860    job e valores em %.17g (a junção recupera os doubles exatos)
+ *   5 ...
+ *   end 5                        número de registros; sem esta linha o shard não terminou
+ * O arquivo é gravado num temporário renomeado no fim, então um shard interrompido não deixa
+ * um parcial com cara de completo.
+ */
+
+#define SHARD_FORMAT_VERSION 1
+#define SHARD_MAX_VALUES 16
+#define SHARD_NAME_MAX 64
+
+typedef struct
+{
+    int index; // 0 <= index < count
+    int count;
+} shard_spec;
+
+// Um único shard com todos os jobs.
+#define SHARD_SPEC_ALL {0, 1}
+
+/**
+ * @brief Lê um shard no formato "i/n".
+ * @return 1 em caso de sucesso, 0 se o texto for inválido (n < 1 ou i fora de [0, n)).
+ */
+int shard_parse(const char *text, shard_spec *spec);
+
+// 1 se o job pertence ao shard.
+static inline int shard_owns(const shard_spec *spec, long job)
+{
+    return job % spec->count == spec->index;
+}
+
+// Número de jobs do shard num espaço de n_jobs; o k-ésimo deles é index + k * count.
+long shard_job_count(const shard_spec *spec, long n_jobs);
+
+// FNV-1a sobre os bytes de um valor, para a impressão digital da configuração.
+#define SHARD_HASH_INIT 14695981039346656037ull
+uint64_t shard_hash(uint64_t hash, const void *data, size_t size);
+
+// Arquivo parcial sendo gravado.
+typedef struct
+{
+    FILE *fp;
+    char path[1024];
+    char tmp_path[1024];
+    int n_values;
+    long n_records;
+} shard_part;
+
+/**
+ * @brief Abre o arquivo parcial do shard e grava o cabeçalho.
+ * @param sweep Nome da varredura (sem espaços).
+ * @param config Impressão digital da configuração que produz os valores.
+ * @param columns Nomes das n_values colunas, separados por vírgula.
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int shard_part_open(shard_part *part, const char *path, const char *sweep, uint64_t config,
+                    const shard_spec *spec, long n_jobs, int n_values, const char *columns);
+
+// Grava o registro de um job (n_values valores).
+void shard_part_write(shard_part *part, long job, const double values[]);
+
+/**
+ * @brief Grava o fim do arquivo e o renomeia para o caminho final.
+ * @return 1 se o arquivo completo foi gravado, 0 em caso de falha (o temporário é removido).
+ */
+int shard_part_close(shard_part *part);
+
+// Resultado da junção: os valores de todos os jobs, na ordem dos jobs.
+typedef struct
+{
+    int count;      // Número de shards
+    long n_jobs;
+    int n_values;
+    double *values; // [n_jobs * n_values]
+} shard_merged;
+
+/**
+ * @brief Junta os arquivos parciais de uma varredura. Os problemas encontrados (varredura ou
+ *        configuração diferente, shard repetido ou ausente, job repetido, ausente ou de outro
+ *        shard, arquivo incompleto) são descritos em stderr.
+ * @param sweep, config, n_jobs, n_values O que os parciais devem conter.
+ * @return 1 se todos os jobs foram lidos, 0 caso contrário (merged fica vazio).
+ */
+int shard_merge(const char *const paths[], int n_paths, const char *sweep, uint64_t config, long n_jobs,
+                int n_values, shard_merged *merged);
+void shard_merged_free(shard_merged *merged);
+
+#endif
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Executa a análise comparativa em N processos locais (shards) e junta os arquivos parciais
+# em output/analise_completa.csv, igual ao gerado por ./main num só processo (ver shard.h).
+#
+# Uso: ./shards.sh [N] [threads por processo]
+#   N: número de shards (padrão: número de núcleos); threads: padrão 1
+# Em várias máquinas: rode "./main --shard i/N" em cada uma, copie os parciais para output/
+# e junte com "./main --merge output/analise_completa.csv output/analise_completa.part-*".
+
+n=${1:-$(nproc)}
+threads=${2:-1}
+bin=./main
+
+if [ ! -x "$bin" ]; then
+    echo "shards.sh: $bin nao encontrado (compile com make main)" >&2
+    exit 1
+fi
+
+pids=""
+parts=""
+i=0
+while [ "$i" -lt "$n" ]; do
+    rm -f "output/analise_completa.part-$i-of-$n"
+    "$bin" --shard "$i/$n" -t "$threads" &
+    pids="$pids $!"
+    parts="$parts output/analise_completa.part-$i-of-$n"
+    i=$((i + 1))
+done
+
+failed=0
+for pid in $pids; do
+    wait "$pid" || failed=1
+done
+if [ "$failed" -ne 0 ]; then
+    echo "shards.sh: pelo menos um shard falhou" >&2
+    exit 1
+fi
+
+"$bin" --merge output/analise_completa.csv $parts
@@ -0,0 +1,428 @@
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sink.h"
+#include "timing.h"
+
+int sink_close(traj_sink *sink)
+{
+    return sink ? sink->close(sink) : 1;
+}
+
+/* ---------------------------------------------------------------- CSV */
+
+typedef struct
+{
+    traj_sink base;
+    FILE *fp;
+    char format[32];
+    char separator;
+} csv_sink;
+
+static void csv_write(traj_sink *sink, double t, const double y[])
+{
+    csv_sink *s = (csv_sink *)sink;
+    fprintf(s->fp, s->format, t);
+    for (int i = 0; i < sink->n_cols - 1; ++i)
+    {
+        fputc(s->separator, s->fp);
+        fprintf(s->fp, s->format, y[i]);
+    }
+    fputc('\n', s->fp);
+}
+
+static int csv_close(traj_sink *sink)
+{
+    int ok = !ferror(((csv_sink *)sink)->fp);
+    free(sink);
+    return ok;
+}
+
+traj_sink *sink_csv_create(FILE *fp, int n_cols, const char *value_format, char separator)
+{
+    if (!fp || n_cols < 1 || strlen(value_format) >= sizeof(((csv_sink *)0)->format))
+        return NULL;
+    csv_sink *s = malloc(sizeof(csv_sink));
+    if (!s)
+        return NULL;
+    s->base.n_cols = n_cols;
+    s->base.write = csv_write;
+    s->base.close = csv_close;
+    s->fp = fp;
+    strcpy(s->format, value_format);
+    s->separator = separator;
+    return &s->base;
+}
+
+/* -------------------------------------------------------------- arena */
+
+// Amostras por bloco da arena; cada bloco guarda suas colunas contíguas.
+#define ARENA_CHUNK_ROWS 4096
+
+typedef struct arena_chunk
+{
+    struct arena_chunk *next;
+    double data[]; // n_cols * ARENA_CHUNK_ROWS, coluna a coluna
+} arena_chunk;
+
+typedef struct
+{
+    traj_sink base;
+    arena_chunk *head;
+    arena_chunk *tail;
+    arena_chunk **index; // Acesso direto ao k-ésimo bloco
+    size_t n_chunks;
+    size_t index_capacity;
+    size_t n_rows;
+    int failed; // Alguma amostra foi descartada por falta de memória
+} arena_sink;
+
+static void arena_write(traj_sink *sink, double t, const double y[])
+{
+    arena_sink *s = (arena_sink *)sink;
+    size_t slot = s->n_rows % ARENA_CHUNK_ROWS;
+
+    if (slot == 0)
+    { // Bloco cheio (ou nenhum ainda): aloca o próximo sem mover os anteriores
+        arena_chunk *chunk = malloc(sizeof(arena_chunk) + sink->n_cols * ARENA_CHUNK_ROWS * sizeof(double));
+        if (!chunk)
+        {
+            s->failed = 1;
+            return;
+        }
+        chunk->next = NULL;
+        if (s->n_chunks == s->index_capacity)
+        {
+            size_t cap = s->index_capacity ? 2 * s->index_capacity : 16;
+            arena_chunk **grown = realloc(s->index, cap * sizeof(arena_chunk *));
+            if (!grown)
+            {
+                free(chunk);
+                s->failed = 1;
+                return;
+            }
+            s->index = grown;
+            s->index_capacity = cap;
+        }
+        s->index[s->n_chunks++] = chunk;
+        if (s->tail)
+            s->tail->next = chunk;
+        else
+            s->head = chunk;
+        s->tail = chunk;
+    }
+
+    double *base = s->tail->data;
+    base[slot] = t;
+    for (int c = 1; c < sink->n_cols; ++c)
+        base[c * ARENA_CHUNK_ROWS + slot] = y[c - 1];
+    s->n_rows++;
+}
+
+static void arena_free(arena_sink *s)
+{
+    arena_chunk *chunk = s->head;
+    while (chunk)
+    {
+        arena_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(s->index);
+}
+
+static int arena_close(traj_sink *sink)
+{
+    int ok = !((arena_sink *)sink)->failed;
+    arena_free((arena_sink *)sink);
+    free(sink);
+    return ok;
+}
+
+static int arena_init(arena_sink *s, int n_cols)
+{
+    if (n_cols < 1)
+        return 0;
+    memset(s, 0, sizeof(*s));
+    s->base.n_cols = n_cols;
+    s->base.write = arena_write;
+    s->base.close = arena_close;
+    return 1;
+}
+
+traj_sink *sink_arena_create(int n_cols)
+{
+    arena_sink *s = malloc(sizeof(arena_sink));
+    if (!s || !arena_init(s, n_cols))
+    {
+        free(s);
+        return NULL;
+    }
+    return &s->base;
+}
+
+size_t sink_arena_rows(const traj_sink *sink)
+{
+    return ((const arena_sink *)sink)->n_rows;
+}
+
+double sink_arena_get(const traj_sink *sink, size_t row, int col)
+{
+    const arena_sink *s = (const arena_sink *)sink;
+    const arena_chunk *chunk = s->index[row / ARENA_CHUNK_ROWS];
+    return chunk->data[col * ARENA_CHUNK_ROWS + row % ARENA_CHUNK_ROWS];
+}
+
+void sink_arena_column(const traj_sink *sink, int col, double out[])
+{
+    const arena_sink *s = (const arena_sink *)sink;
+    size_t remaining = s->n_rows;
+    for (size_t k = 0; k < s->n_chunks; ++k)
+    {
+        size_t rows = remaining < ARENA_CHUNK_ROWS ? remaining : ARENA_CHUNK_ROWS;
+        memcpy(out + k * ARENA_CHUNK_ROWS, s->index[k]->data + col * ARENA_CHUNK_ROWS, rows * sizeof(double));
+        remaining -= rows;
+    }
+}
+
+/* ----------------------------------------------------- binário colunar */
+
+typedef struct
+{
+    arena_sink arena; // Primeiro membro: as funções da arena valem para este sink
+    FILE *fp;
+    char (*names)[SINK_BINARY_NAME_LEN];
+} binary_sink;
+
+static int binary_close(traj_sink *sink)
+{
+    binary_sink *s = (binary_sink *)sink;
+    arena_sink *a = &s->arena;
+    int n_cols = sink->n_cols;
+    int ok = !a->failed;
+
+    char magic[8] = SINK_BINARY_MAGIC;
+    uint32_t version = SINK_BINARY_VERSION;
+    uint32_t cols = (uint32_t)n_cols;
+    uint64_t rows = (uint64_t)a->n_rows;
+    uint64_t header_size = 32 + (uint64_t)n_cols * SINK_BINARY_NAME_LEN;
+    uint64_t data_offset = (header_size + 63) / 64 * 64;
+
+    ok = ok && fwrite(magic, 1, 8, s->fp) == 8;
+    ok = ok && fwrite(&version, sizeof(version), 1, s->fp) == 1;
+    ok = ok && fwrite(&cols, sizeof(cols), 1, s->fp) == 1;
+    ok = ok && fwrite(&rows, sizeof(rows), 1, s->fp) == 1;
+    ok = ok && fwrite(&data_offset, sizeof(data_offset), 1, s->fp) == 1;
+    ok = ok && fwrite(s->names, SINK_BINARY_NAME_LEN, n_cols, s->fp) == (size_t)n_cols;
+    for (uint64_t pad = header_size; ok && pad < data_offset; ++pad)
+        ok = fputc(0, s->fp) != EOF;
+
+    // Cada coluna é gravada inteira, bloco a bloco da arena
+    for (int c = 0; ok && c < n_cols; ++c)
+    {
+        size_t remaining = a->n_rows;
+        for (size_t k = 0; ok && k < a->n_chunks; ++k)
+        {
+            size_t n = remaining < ARENA_CHUNK_ROWS ? remaining : ARENA_CHUNK_ROWS;
+            ok = fwrite(a->index[k]->data + c * ARENA_CHUNK_ROWS, sizeof(double), n, s->fp) == n;
+            remaining -= n;
+        }
+    }
+
+    if (fclose(s->fp) != 0)
+        ok = 0;
+    free(s->names);
+    arena_free(a);
+    free(s);
+    return ok;
+}
+
+traj_sink *sink_binary_create(const char *path, int n_cols, const char *const col_names[])
+{
+    binary_sink *s = malloc(sizeof(binary_sink));
+    if (!s || !arena_init(&s->arena, n_cols))
+    {
+        free(s);
+        return NULL;
+    }
+    s->names = calloc(n_cols, SINK_BINARY_NAME_LEN);
+    s->fp = fopen(path, "wb");
+    if (!s->names || !s->fp)
+    {
+        if (s->fp)
+            fclose(s->fp);
+        free(s->names);
+        free(s);
+        return NULL;
+    }
+    for (int c = 0; c < n_cols; ++c)
+    {
+        if (col_names && col_names[c])
+            strncpy(s->names[c], col_names[c], SINK_BINARY_NAME_LEN - 1);
+        else
+            snprintf(s->names[c], SINK_BINARY_NAME_LEN, "c%d", c);
+    }
+    s->arena.base.close = binary_close;
+    return &s->arena.base;
+}
+
+/* ---------------------------------------------------------- assíncrono */
+
+/*
+ * Os blocos são usados em ordem circular. O produtor só escreve em head e o
+ * consumidor só em tail; os semáforos contam blocos livres e blocos prontos, então
+ * sem_post nunca bloqueia e o produtor só espera em sem_wait(free) com o anel cheio.
+ */
+typedef struct
+{
+    traj_sink base;
+    traj_sink *inner;
+    size_t block_rows;
+    int n_blocks;
+    double *blocks;      // n_blocks * block_rows * n_cols, amostra a amostra
+    size_t *block_fill;  // Amostras válidas em cada bloco
+    atomic_size_t head;  // Próximo bloco a ser preenchido (produtor)
+    atomic_size_t tail;  // Próximo bloco a ser gravado (consumidor)
+    size_t fill;         // Amostras no bloco atual
+    atomic_int done;
+    sem_t free_blocks;
+    sem_t ready_blocks;
+    pthread_t writer;
+    sink_async_stats stats;
+    sink_async_stats *stats_out;
+} async_sink;
+
+static double *async_block(async_sink *s, size_t index)
+{
+    return s->blocks + (index % s->n_blocks) * s->block_rows * s->base.n_cols;
+}
+
+static void *async_writer_main(void *p)
+{
+    async_sink *s = (async_sink *)p;
+    int n_cols = s->base.n_cols;
+
+    for (;;)
+    {
+        while (sem_wait(&s->ready_blocks) != 0 && errno == EINTR)
+            ;
+        size_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&s->head, memory_order_acquire) && atomic_load(&s->done))
+            break;
+
+        const double *block = async_block(s, tail);
+        size_t rows = s->block_fill[tail % s->n_blocks];
+        for (size_t r = 0; r < rows; ++r)
+        {
+            const double *row = block + r * n_cols;
+            sink_write(s->inner, row[0], row + 1);
+        }
+        atomic_store_explicit(&s->tail, tail + 1, memory_order_release);
+        sem_post(&s->free_blocks);
+    }
+    return NULL;
+}
+
+// Entrega o bloco atual ao escritor e reserva o próximo (esperando se o anel estiver cheio).
+static void async_publish(async_sink *s)
+{
+    size_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    s->block_fill[head % s->n_blocks] = s->fill;
+    atomic_store_explicit(&s->head, head + 1, memory_order_release);
+    sem_post(&s->ready_blocks);
+    s->stats.blocks++;
+    s->fill = 0;
+
+    if (sem_trywait(&s->free_blocks) != 0)
+    {
+        double t0 = timing_now();
+        while (sem_wait(&s->free_blocks) != 0 && errno == EINTR)
+            ;
+        s->stats.stall_seconds += timing_now() - t0;
+        s->stats.stalls++;
+    }
+}
+
+static void async_write(traj_sink *sink, double t, const double y[])
+{
+    async_sink *s = (async_sink *)sink;
+    int n_cols = sink->n_cols;
+    double *row = async_block(s, atomic_load_explicit(&s->head, memory_order_relaxed)) + s->fill * n_cols;
+
+    row[0] = t;
+    for (int c = 1; c < n_cols; ++c)
+        row[c] = y[c - 1];
+    s->stats.samples++;
+
+    if (++s->fill == s->block_rows)
+        async_publish(s);
+}
+
+static int async_close(traj_sink *sink)
+{
+    async_sink *s = (async_sink *)sink;
+
+    if (s->fill > 0)
+        async_publish(s);
+    atomic_store(&s->done, 1);
+    sem_post(&s->ready_blocks); // Acorda o escritor para ele ver o fim
+    pthread_join(s->writer, NULL);
+
+    int ok = sink_close(s->inner);
+    if (s->stats_out)
+        *s->stats_out = s->stats;
+    sem_destroy(&s->free_blocks);
+    sem_destroy(&s->ready_blocks);
+    free(s->blocks);
+    free(s->block_fill);
+    free(s);
+    return ok;
+}
+
+traj_sink *sink_async_create(traj_sink *inner, size_t block_rows, int n_blocks,
+                             sink_async_stats *stats_out)
+{
+    if (!inner || block_rows == 0 || n_blocks < 2)
+        return NULL;
+
+    async_sink *s = calloc(1, sizeof(async_sink));
+    if (!s)
+        return NULL;
+    s->base.n_cols = inner->n_cols;
+    s->base.write = async_write;
+    s->base.close = async_close;
+    s->inner = inner;
+    s->block_rows = block_rows;
+    s->n_blocks = n_blocks;
+    s->blocks = malloc((size_t)n_blocks * block_rows * inner->n_cols * sizeof(double));
+    s->block_fill = calloc(n_blocks, sizeof(size_t));
+    s->stats_out = stats_out;
+    atomic_init(&s->head, 0);
+    atomic_init(&s->tail, 0);
+    atomic_init(&s->done, 0);
+    if (!s->blocks || !s->block_fill)
+        goto fail;
+
+    // O primeiro bloco já fica reservado para o produtor
+    sem_init(&s->free_blocks, 0, n_blocks - 1);
+    sem_init(&s->ready_blocks, 0, 0);
+    if (pthread_create(&s->writer, NULL, async_writer_main, s) != 0)
+    {
+        sem_destroy(&s->free_blocks);
+        sem_destroy(&s->ready_blocks);
+        goto fail;
+    }
+    return &s->base;
+
+fail:
+    free(s->blocks);
+    free(s->block_fill);
+    free(s);
+    return NULL;
+}
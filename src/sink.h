@@ -0,0 +1,121 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Destino das amostras de trajetória gravadas pelos integradores.
+ * Cada amostra tem n_cols colunas: t seguido das n_cols-1 primeiras componentes de y
+ * (os detectores de período usam n_cols = 2, ou seja, t e theta).
+ *
+ * Backends:
+ *   - CSV: texto formatado num FILE* (o formato antigo, agora opcional);
+ *   - arena: buffer em memória, alocado em blocos de tamanho fixo sem realocação;
+ *   - binário colunar: arena gravada em disco ao fechar, com um cabeçalho pequeno e
+ *     as colunas contíguas em float64, legível com np.memmap.
+ */
+
+typedef struct traj_sink traj_sink;
+
+struct traj_sink
+{
+    int n_cols;
+    void (*write)(traj_sink *sink, double t, const double y[]);
+    int (*close)(traj_sink *sink); // 1 se todas as amostras foram gravadas
+};
+
+/**
+ * @brief Grava uma amostra (t, y[0], ..., y[n_cols-2]).
+ */
+static inline void sink_write(traj_sink *sink, double t, const double y[])
+{
+    sink->write(sink, t, y);
+}
+
+/**
+ * @brief Finaliza o sink (grava o arquivo, se houver) e libera a memória. Aceita NULL.
+ * @return 1 se todas as amostras foram gravadas; 0 se alguma se perdeu (sem memória na
+ *         arena, erro de escrita no arquivo ou no FILE* do sink CSV).
+ */
+int sink_close(traj_sink *sink);
+
+/**
+ * @brief Sink CSV. O FILE* continua sendo do chamador (não é fechado por sink_close).
+ * @param fp Arquivo de saída.
+ * @param n_cols Número de colunas por amostra.
+ * @param value_format Formato printf de cada valor (ex.: "%.8f").
+ * @param separator Separador entre colunas (ex.: ',' ou ' ').
+ */
+traj_sink *sink_csv_create(FILE *fp, int n_cols, const char *value_format, char separator);
+
+/**
+ * @brief Sink em memória. Os dados ficam disponíveis até sink_close. Se faltar memória para
+ *        um bloco, as amostras seguintes são descartadas e sink_close devolve 0.
+ */
+traj_sink *sink_arena_create(int n_cols);
+
+size_t sink_arena_rows(const traj_sink *sink);
+
+/**
+ * @brief Valor da coluna col na amostra row.
+ */
+double sink_arena_get(const traj_sink *sink, size_t row, int col);
+
+/**
+ * @brief Copia uma coluna inteira para out (sink_arena_rows valores).
+ */
+void sink_arena_column(const traj_sink *sink, int col, double out[]);
+
+/*
+ * Formato binário colunar (little-endian):
+ *   0  char[8]   magic "PENDTRJ\0"
+ *   8  uint32    versão (SINK_BINARY_VERSION)
+ *   12 uint32    n_cols
+ *   16 uint64    n_rows
+ *   24 uint64    data_offset (múltiplo de 64)
+ *   32 char[16]  nome de cada coluna (n_cols entradas, completadas com '\0')
+ *   data_offset  n_cols blocos de n_rows float64 (coluna 0 inteira, depois a 1, ...)
+ *
+ * Leitura em Python:
+ *   hdr = np.fromfile(path, dtype=np.uint64, count=4)
+ *   data = np.memmap(path, dtype='<f8', mode='r', offset=int(hdr[3]), shape=(n_cols, n_rows))
+ */
+#define SINK_BINARY_MAGIC "PENDTRJ"
+#define SINK_BINARY_VERSION 1
+#define SINK_BINARY_NAME_LEN 16
+
+/**
+ * @brief Sink binário colunar: acumula numa arena e grava o arquivo em sink_close.
+ * @param path Caminho do arquivo.
+ * @param n_cols Número de colunas por amostra.
+ * @param col_names Nome de cada coluna (até 15 caracteres; pode ser NULL).
+ * @return O sink, ou NULL se o arquivo não puder ser criado.
+ */
+traj_sink *sink_binary_create(const char *path, int n_cols, const char *const col_names[]);
+
+// Estatísticas de um sink assíncrono, preenchidas em sink_close.
+typedef struct
+{
+    size_t samples;       // Amostras gravadas
+    size_t blocks;        // Blocos entregues à thread de escrita
+    size_t stalls;        // Vezes em que o integrador esperou por um bloco livre
+    double stall_seconds; // Tempo total que o integrador ficou bloqueado
+} sink_async_stats;
+
+/**
+ * @brief Sink assíncrono: o integrador preenche blocos de tamanho fixo que passam por um
+ *        anel single-producer/single-consumer para uma thread de escrita, que os repassa
+ *        ao sink interno. O integrador só espera quando todos os blocos estão ocupados.
+ *        Deve ser usado por uma única thread produtora.
+ * @param inner Sink que faz a escrita de fato (passa a pertencer ao sink assíncrono; se a
+ *        criação falhar, continua sendo do chamador, que pode usá-lo diretamente).
+ * @param block_rows Amostras por bloco.
+ * @param n_blocks Número de blocos no anel (>= 2; 2 = double buffering).
+ * @param stats_out Recebe as estatísticas ao fechar (pode ser NULL).
+ * @return O sink, ou NULL em caso de falha (inner não é fechado).
+ */
+traj_sink *sink_async_create(traj_sink *inner, size_t block_rows, int n_blocks,
+                             sink_async_stats *stats_out);
+
+#endif
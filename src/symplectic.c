@@ -0,0 +1,26 @@
+#include "symplectic.h"
+
+// Triplo salto: w1 = 1 / (2 - 2^(1/3)), w0 = -2^(1/3) / (2 - 2^(1/3)).
+#define YOSHIDA4_W1 1.3512071919596578
+#define YOSHIDA4_W0 -1.7024143839193153
+
+// Suzuki: p = 1 / (4 - 4^(1/3)), pesos (p, p, 1 - 4p, p, p).
+#define SUZUKI4_P 0.41449077179437571
+#define SUZUKI4_C -0.65796308717750284
+
+// Yoshida (1990), solução A; w0 = 1 - 2 (w1 + w2 + w3).
+#define YOSHIDA6_W1 -1.17767998417887
+#define YOSHIDA6_W2 0.235573213359357
+#define YOSHIDA6_W3 0.784513610477560
+#define YOSHIDA6_W0 1.315186320683906
+
+const sympl_scheme sympl_verlet = {"verlet", 2, 1, {1.0}};
+
+const sympl_scheme sympl_yoshida4 = {"yoshida4", 4, 3, {YOSHIDA4_W1, YOSHIDA4_W0, YOSHIDA4_W1}};
+
+const sympl_scheme sympl_suzuki4 = {"suzuki4", 4, 5, {SUZUKI4_P, SUZUKI4_P, SUZUKI4_C, SUZUKI4_P, SUZUKI4_P}};
+
+const sympl_scheme sympl_yoshida6 = {
+    "yoshida6", 6, 7,
+    {YOSHIDA6_W3, YOSHIDA6_W2, YOSHIDA6_W1, YOSHIDA6_W0, YOSHIDA6_W1, YOSHIDA6_W2, YOSHIDA6_W3},
+};
@@ -0,0 +1,58 @@
+#ifndef SYMPLECTIC_H
+#define SYMPLECTIC_H
+
+/*
+ * Integradores simpléticos de passo fixo para sistemas separáveis
+ * q' = p, p' = a(q) (hamiltoniano H = p^2/2 + V(q), como o pêndulo).
+ *
+ * Todos os esquemas são composições do Störmer-Verlet (velocity Verlet: meio
+ * impulso, deriva, meio impulso) com pesos w_i: um passo h aplica Verlet com
+ * w_1 h, w_2 h, ..., w_s h. Métodos simpléticos preservam um hamiltoniano modificado,
+ * então o erro de energia fica limitado (oscila) em vez de crescer com o tempo
+ * como no RK4, e passos grandes continuam utilizáveis em horizontes muito longos.
+ *
+ * A aceleração no fim de um estágio é a do início do seguinte (e do próximo passo),
+ * então cada passo custa s avaliações de a(q), mais uma no início da integração.
+ */
+
+#define SYMPL_MAX_STAGES 7
+
+typedef struct
+{
+    const char *name;
+    int order;
+    int stages;
+    double w[SYMPL_MAX_STAGES]; // Pesos da composição (somam 1)
+} sympl_scheme;
+
+extern const sympl_scheme sympl_verlet;   // 2ª ordem, 1 avaliação por passo
+extern const sympl_scheme sympl_yoshida4; // 4ª ordem, triplo salto de Yoshida/Forest-Ruth (3)
+extern const sympl_scheme sympl_suzuki4;  // 4ª ordem, composição de Suzuki em 5 estágios (5)
+extern const sympl_scheme sympl_yoshida6; // 6ª ordem, solução A de Yoshida (7)
+
+/**
+ * Gera: static inline void NAME(const sympl_scheme *scheme, double q[], double p[],
+ *                               double a[], double h)
+ * para dimensão fixa N e aceleração "static inline void ACCEL(const double q[], double a[])".
+ * Na entrada a[] deve conter ACCEL(q); na saída contém a aceleração no novo q.
+ */
+#define SYMPL_DEFINE_STEPPER(NAME, N, ACCEL)                                                 \
+    static inline void NAME(const sympl_scheme *scheme, double q[], double p[],              \
+                            double a[], double h)                                            \
+    {                                                                                        \
+        int i, k;                                                                            \
+        for (k = 0; k < scheme->stages; ++k)                                                 \
+        {                                                                                    \
+            double hk = scheme->w[k] * h;                                                    \
+            for (i = 0; i < (N); ++i)                                                        \
+            {                                                                                \
+                p[i] += (hk / 2.0) * a[i];                                                   \
+                q[i] += hk * p[i];                                                           \
+            }                                                                                \
+            ACCEL(q, a);                                                                     \
+            for (i = 0; i < (N); ++i)                                                        \
+                p[i] += (hk / 2.0) * a[i];                                                   \
+        }                                                                                    \
+    }
+
+#endif
@@ -0,0 +1,229 @@
+#include <math.h>
+
+#include "taylor.h"
+#include "pendulo.h"
+#include "rk.h"
+
+// Termos k_begin + 1..order de theta e omega; os anteriores, e s/c até k_begin - 1, já estão calculados.
+static void coeffs_extend(double th[], double om[], double s[], double c[], int k_begin, int order)
+{
+    int j, k;
+    for (k = k_begin; k < order; ++k)
+    {
+        if (k > 0)
+        { // Série de sin(theta(t)) e cos(theta(t)) até o termo k
+            double acc_s = 0.0, acc_c = 0.0;
+            for (j = 1; j <= k; ++j)
+            {
+                acc_s += j * th[j] * c[k - j];
+                acc_c += j * th[j] * s[k - j];
+            }
+            s[k] = acc_s / k;
+            c[k] = -acc_c / k;
+        }
+        th[k + 1] = om[k] / (k + 1);
+        om[k + 1] = -(G / L) * s[k] / (k + 1);
+    }
+}
+
+void taylor_pendulo_coeffs(double theta, double omega, int order, double th[], double om[])
+{
+    double s[TAYLOR_MAX_ORDER + 1], c[TAYLOR_MAX_ORDER + 1];
+
+    th[0] = theta;
+    om[0] = omega;
+    s[0] = sin(theta);
+    c[0] = cos(theta);
+    coeffs_extend(th, om, s, c, 0, order);
+}
+
+double taylor_eval(const double c[], int order, double tau)
+{
+    double acc = c[order];
+    for (int k = order - 1; k >= 0; --k)
+        acc = acc * tau + c[k];
+    return acc;
+}
+
+int taylor_order_for_tol(double tol)
+{
+    int order = (int)ceil(-0.5 * log(tol) + 1.0);
+    if (order < 10)
+        order = 10;
+    if (order > 30)
+        order = 30;
+    return order;
+}
+
+double taylor_step_size(const double th[], const double om[], int order, double tol)
+{
+    double h = INFINITY;
+    for (int j = order - 1; j <= order; ++j)
+    {
+        double norm = fmax(fabs(th[j]), fabs(om[j]));
+        if (norm > 0.0)
+            h = fmin(h, pow(tol / norm, 1.0 / j));
+    }
+    // Fator de segurança de Jorba e Zou
+    return h * exp(-0.7 / (order - 1));
+}
+
+double taylor_step_cost(int order)
+{
+    return TAYLOR_STEP_OVERHEAD + 2.0 * order * order + 4.0 * order;
+}
+
+// log max(|th[k]|, |om[k]|), ou -INFINITY se os dois coeficientes são nulos.
+static double coeff_log_norm(const double th[], const double om[], int k)
+{
+    double norm = fmax(fabs(th[k]), fabs(om[k]));
+    return norm > 0.0 ? log(norm) : -INFINITY;
+}
+
+/**
+ * @brief Escolhe a ordem do passo a partir de (theta, omega) e calcula os coeficientes até ela.
+ *        Parte de hint - 1 (a ordem muda pouco de um passo para o seguinte) e estende a série
+ *        um termo por vez enquanto alguma das TAYLOR_ORDER_LOOKAHEAD ordens seguintes ainda
+ *        pode baixar o custo por unidade de tempo. Os candidatos são comparados em escala log,
+ *        com o h de taylor_step_size, sem um pow por candidato.
+ * @param log_cost log(taylor_step_cost(p)) para p = 0..TAYLOR_MAX_ORDER.
+ * @return A ordem escolhida; *h_out recebe o passo dela (já limitado a h_max).
+ */
+static int select_order(double theta, double omega, double log_tol, double log_h_max, int hint,
+                        const double log_cost[], double th[], double om[], double *h_out)
+{
+    double s[TAYLOR_MAX_ORDER + 1], c[TAYLOR_MAX_ORDER + 1];
+    int first = hint - 1;
+    if (first < TAYLOR_MIN_ORDER)
+        first = TAYLOR_MIN_ORDER;
+
+    th[0] = theta;
+    om[0] = omega;
+    s[0] = sin(theta);
+    c[0] = cos(theta);
+    coeffs_extend(th, om, s, c, 0, first);
+
+    double log_norm_prev = coeff_log_norm(th, om, first - 1);
+    int best = 0;
+    double log_h_best = 0.0, log_rate_best = INFINITY;
+    for (int p = first; p <= TAYLOR_MAX_ORDER && (best == 0 || p <= best + TAYLOR_ORDER_LOOKAHEAD); ++p)
+    {
+        if (p > first)
+            coeffs_extend(th, om, s, c, p - 1, p);
+        double log_norm = coeff_log_norm(th, om, p);
+        double log_h = fmin((log_tol - log_norm_prev) / (p - 1), (log_tol - log_norm) / p);
+        log_h = fmin(log_h - 0.7 / (p - 1), log_h_max); // Fator de segurança de Jorba e Zou
+        if (log_cost[p] - log_h < log_rate_best)
+        {
+            best = p;
+            log_h_best = log_h;
+            log_rate_best = log_cost[p] - log_h;
+        }
+        log_norm_prev = log_norm;
+    }
+    *h_out = exp(log_h_best);
+    return best;
+}
+
+// omega(t0 + tau) no polinômio do passo, para o método de Brent.
+typedef struct
+{
+    const double *om;
+    int order;
+} taylor_event_ctx;
+
+static double taylor_omega_event(double tau, void *ctx)
+{
+    taylor_event_ctx *ev = (taylor_event_ctx *)ctx;
+    return taylor_eval(ev->om, ev->order, tau);
+}
+
+int detect_period_taylor(double theta0, double tol, int order, int num_periods,
+                         double *T_num_out, int *steps_out, traj_sink *sink, rk_stats *stats)
+{
+    double th[TAYLOR_MAX_ORDER + 1], om[TAYLOR_MAX_ORDER + 1];
+    double t = 0.0;
+    double y[2] = { theta0, 0.0 };
+    double h_max = analytic_period() / 4.0; // Um passo nunca cobre dois cruzamentos
+    int steps = 0;
+    int zero_crossings = 0;
+    double total_time = 0.0;
+
+    if (tol <= 0.0 || num_periods <= 0)
+        return 0;
+    // Ordem variável: escolhida a cada passo, partindo da sugerida pela tolerância
+    int variable = order <= 0;
+    double log_cost[TAYLOR_MAX_ORDER + 1];
+    if (variable)
+    {
+        order = taylor_order_for_tol(tol);
+        for (int p = 0; p <= TAYLOR_MAX_ORDER; ++p)
+            log_cost[p] = log(taylor_step_cost(p));
+    }
+    if (order < TAYLOR_MIN_ORDER)
+        order = TAYLOR_MIN_ORDER;
+    if (order > TAYLOR_MAX_ORDER)
+        order = TAYLOR_MAX_ORDER;
+
+    if (stats)
+        rk_stats_reset(stats);
+
+    if (sink)
+    {
+        RK_CYCLES_BEGIN(c_out);
+        sink_write(sink, t, y);
+        RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
+    }
+
+    while (zero_crossings < 2 * num_periods)
+    {
+        RK_CYCLES_BEGIN(c_step);
+        double h;
+        if (variable)
+        {
+            order = select_order(y[0], y[1], log(tol), log(h_max), order, log_cost, th, om, &h);
+        }
+        else
+        {
+            taylor_pendulo_coeffs(y[0], y[1], order, th, om);
+            h = fmin(taylor_step_size(th, om, order, tol), h_max);
+        }
+        double y_next[2] = { taylor_eval(th, order, h), taylor_eval(om, order, h) };
+        RK_CYCLES_END(stats, RK_PHASE_STEP, c_step);
+        RK_STATS_EVALS(stats, 1);
+        RK_STATS_ACCEPT(stats, h);
+        steps++;
+
+        if (sink)
+        {
+            RK_CYCLES_BEGIN(c_out);
+            sink_write(sink, t + h, y_next);
+            RK_CYCLES_END(stats, RK_PHASE_OUTPUT, c_out);
+        }
+
+        // Cruzamento de omega localizado no próprio polinômio do passo
+        if (y[1] * y_next[1] <= 0 && t > 0)
+        {
+            zero_crossings++;
+            if (zero_crossings == 2 * num_periods)
+            {
+                RK_CYCLES_BEGIN(c_event);
+                taylor_event_ctx ev = { om, order };
+                double tau;
+                if (!rk_brent_root(taylor_omega_event, &ev, 0.0, h, y[1], y_next[1],
+                                   1e-15 * (1.0 + fabs(t)), &tau))
+                    tau = h * fabs(y[1]) / (fabs(y[1]) + fabs(y_next[1]));
+                total_time = t + tau;
+                RK_CYCLES_END(stats, RK_PHASE_EVENT, c_event);
+            }
+        }
+
+        t += h;
+        y[0] = y_next[0];
+        y[1] = y_next[1];
+    }
+
+    *steps_out = steps;
+    *T_num_out = (2.0 * total_time) / (double)(2 * num_periods);
+    return 1;
+}
@@ -0,0 +1,81 @@
+#ifndef TAYLOR_H
+#define TAYLOR_H
+
+#include "sink.h"
+#include "rk_stats.h"
+
+/*
+ * Integrador de Taylor de ordem alta para o pêndulo.
+ *
+ * Os coeficientes da série de theta(t0 + tau) e omega(t0 + tau) saem de recorrências
+ * (diferenciação automática): com s = sin(theta) e c = cos(theta),
+ *   theta_{k+1} = omega_k / (k+1),   omega_{k+1} = -(G/L) s_k / (k+1),
+ *   s_k =  (1/k) sum_{j=1..k} j theta_j c_{k-j},
+ *   c_k = -(1/k) sum_{j=1..k} j theta_j s_{k-j},
+ * o que custa um seno e um cosseno por passo mais O(ordem^2) operações.
+ * O próprio polinômio é a saída densa do passo, então os cruzamentos de omega são
+ * localizados nele sem avaliações extras.
+ *
+ * Com ordem variável, a ordem de cada passo é a que minimiza o custo estimado por unidade
+ * de tempo, taylor_step_cost(p) / h_p, com h_p tirado do decaimento dos coeficientes
+ * (taylor_step_size): perto dos pontos de retorno, onde a série decai mais rápido, a ordem cai.
+ */
+
+#define TAYLOR_MIN_ORDER 4
+#define TAYLOR_MAX_ORDER 40
+
+// Ordens além da melhor encontrada que a seleção experimenta antes de parar.
+#define TAYLOR_ORDER_LOOKAHEAD 2
+
+// Custo fixo de um passo em multiplicações-somas (seno, cosseno, tamanho do passo, avaliação e
+// cruzamento), para taylor_step_cost; calibrado com a tabela de ordem fixa de bench_taylor.
+#define TAYLOR_STEP_OVERHEAD 200.0
+
+/**
+ * @brief Coeficientes de Taylor de theta e omega em torno do estado (theta, omega).
+ * @param order Ordem da série (<= TAYLOR_MAX_ORDER).
+ * @param th Recebe os coeficientes theta_0..theta_order.
+ * @param om Recebe os coeficientes omega_0..omega_order.
+ */
+void taylor_pendulo_coeffs(double theta, double omega, int order, double th[], double om[]);
+
+/**
+ * @brief Avalia o polinômio sum_{k=0..order} c[k] tau^k (Horner).
+ */
+double taylor_eval(const double c[], int order, double tau);
+
+/**
+ * @brief Ordem sugerida para a tolerância: ~ -ln(tol)/2 + 1, limitada a [10, 30].
+ */
+int taylor_order_for_tol(double tol);
+
+/**
+ * @brief Passo para que os dois últimos termos da série fiquem abaixo de tol
+ *        (critério de Jorba e Zou).
+ */
+double taylor_step_size(const double th[], const double om[], int order, double tol);
+
+/**
+ * @brief Custo estimado de um passo de ordem order: TAYLOR_STEP_OVERHEAD mais a recorrência
+ *        (~2 order^2) e a avaliação dos dois polinômios.
+ */
+double taylor_step_cost(int order);
+
+/**
+ * @brief Detecta o período numérico com o integrador de Taylor.
+ * @param theta0 Ângulo inicial.
+ * @param tol Tolerância absoluta por passo.
+ * @param order Ordem fixa da série; <= 0 usa ordem variável (escolhida a cada passo,
+ *              começando por taylor_order_for_tol).
+ * @param num_periods Número de períodos a simular.
+ * @param T_num_out Ponteiro para armazenar o período médio final.
+ * @param steps_out Ponteiro para armazenar o número total de passos.
+ * @param sink Destino das amostras (t, theta[, omega]) de cada passo (pode ser NULL).
+ * @param stats Estatísticas da integração; rhs_evals conta um par seno/cosseno por passo
+ *              (pode ser NULL).
+ * @return 1 em caso de sucesso, 0 em caso de falha.
+ */
+int detect_period_taylor(double theta0, double tol, int order, int num_periods,
+                         double *T_num_out, int *steps_out, traj_sink *sink, rk_stats *stats);
+
+#endif
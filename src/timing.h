@@ -0,0 +1,17 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <time.h>
+
+/**
+ * @brief Tempo de parede em segundos a partir de um relógio monotônico.
+ *        Diferente de clock(), não mede tempo de CPU e não sofre ajustes do relógio do sistema.
+ */
+static inline double timing_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+#include <math.h>
+
+/*
+ * Funções matemáticas "static inline" sem desvios, escritas para que o
+ * compilador consiga vetorizá-las dentro de laços `#pragma omp simd`
+ * (a `sin` da libm é uma chamada opaca e impede a vetorização).
+ *
+ * Seno e cosseno têm três níveis de precisão (além da libm), escolhidos com vm_accuracy:
+ *   vm_sin_accurate / vm_cos_accurate  <= 1 ulp
+ *   vm_sin / vm_cos                    <= 4 ulp
+ *   vm_sin_fast / vm_cos_fast          ~1e-11 absoluto
+ * Todas valem para |x| < 1e5 e são bem mais baratas que a libm em laços vetorizados.
+ */
+
+typedef enum
+{
+    VM_ACC_LIBM = 0, // sin/cos da libm (escalar)
+    VM_ACC_1ULP,
+    VM_ACC_4ULP,
+    VM_ACC_FAST,
+    VM_ACC_COUNT
+} vm_accuracy;
+
+// Constante pi dividida em três partes (Cody-Waite): k * VM_PI_A é exato
+// para |k| < 2^20, então a redução de argumento não perde precisão.
+#define VM_PI_A 3.14159265346825122834e+00
+#define VM_PI_B 1.21542010126079319532e-10
+#define VM_PI_C 4.04453249759190126308e-21
+
+// As funções de 1 ulp são grandes demais para a heurística de inline do GCC, e uma
+// chamada que não é embutida impede a vetorização do laço.
+#define VM_ALWAYS_INLINE __attribute__((always_inline))
+
+// Somar e subtrair 1.5*2^52 arredonda para o inteiro mais próximo sem floor(),
+// que o GCC só vetoriza com -fno-trapping-math.
+#define VM_ROUND_MAGIC 6755399441055744.0
+
+/**
+ * @brief Seno com erro de até 4 ulp para |x| moderado (|x| < 1e5).
+ *        Reduz x para r em [-pi/2, pi/2] com x = r + k*pi e avalia a série
+ *        de Taylor de sin(r) até r^25 (truncamento < 1e-22).
+ */
+static inline double vm_sin(double x)
+{
+    double k = (x * M_1_PI + VM_ROUND_MAGIC) - VM_ROUND_MAGIC;
+    double r = ((x - k * VM_PI_A) - k * VM_PI_B) - k * VM_PI_C;
+    double r2 = r * r;
+
+    double p = 1.0 / 15511210043330985984000000.0;
+    p = p * r2 - 1.0 / 25852016738884976640000.0;
+    p = p * r2 + 1.0 / 51090942171709440000.0;
+    p = p * r2 - 1.0 / 121645100408832000.0;
+    p = p * r2 + 1.0 / 355687428096000.0;
+    p = p * r2 - 1.0 / 1307674368000.0;
+    p = p * r2 + 1.0 / 6227020800.0;
+    p = p * r2 - 1.0 / 39916800.0;
+    p = p * r2 + 1.0 / 362880.0;
+    p = p * r2 - 1.0 / 5040.0;
+    p = p * r2 + 1.0 / 120.0;
+    p = p * r2 - 1.0 / 6.0;
+    double s = r + r * r2 * p;
+
+    // sin(r + k*pi) = (-1)^k sin(r); k/2 dista 0.5 do inteiro mais próximo se k for ímpar
+    double half = 0.5 * k;
+    double parity = 2.0 * fabs(half - ((half + VM_ROUND_MAGIC) - VM_ROUND_MAGIC));
+    return (1.0 - 2.0 * parity) * s;
+}
+
+/**
+ * @brief Cosseno com a mesma precisão de vm_sin: x = (k + 1/2) pi + r e
+ *        cos(x) = -(-1)^k sin(r), com a mesma série.
+ */
+static inline double vm_cos(double x)
+{
+    double k = (x * M_1_PI - 0.5 + VM_ROUND_MAGIC) - VM_ROUND_MAGIC;
+    double kh = k + 0.5; // kh * VM_PI_A continua exato para |k| < 2^19
+    double r = ((x - kh * VM_PI_A) - kh * VM_PI_B) - kh * VM_PI_C;
+    double r2 = r * r;
+
+    double p = 1.0 / 15511210043330985984000000.0;
+    p = p * r2 - 1.0 / 25852016738884976640000.0;
+    p = p * r2 + 1.0 / 51090942171709440000.0;
+    p = p * r2 - 1.0 / 121645100408832000.0;
+    p = p * r2 + 1.0 / 355687428096000.0;
+    p = p * r2 - 1.0 / 1307674368000.0;
+    p = p * r2 + 1.0 / 6227020800.0;
+    p = p * r2 - 1.0 / 39916800.0;
+    p = p * r2 + 1.0 / 362880.0;
+    p = p * r2 - 1.0 / 5040.0;
+    p = p * r2 + 1.0 / 120.0;
+    p = p * r2 - 1.0 / 6.0;
+    double s = r + r * r2 * p;
+
+    double half = 0.5 * k;
+    double parity = 2.0 * fabs(half - ((half + VM_ROUND_MAGIC) - VM_ROUND_MAGIC));
+    return (2.0 * parity - 1.0) * s;
+}
+
+/**
+ * @brief Seno rápido com erro absoluto ~1e-11: redução com só duas partes de pi e série
+ *        até r^15 (o termo seguinte é < 7e-12 em |r| <= pi/2).
+ */
+static inline double vm_sin_fast(double x)
+{
+    double k = (x * M_1_PI + VM_ROUND_MAGIC) - VM_ROUND_MAGIC;
+    double r = (x - k * VM_PI_A) - k * VM_PI_B;
+    double r2 = r * r;
+
+    double p = -1.0 / 1307674368000.0;
+    p = p * r2 + 1.0 / 6227020800.0;
+    p = p * r2 - 1.0 / 39916800.0;
+    p = p * r2 + 1.0 / 362880.0;
+    p = p * r2 - 1.0 / 5040.0;
+    p = p * r2 + 1.0 / 120.0;
+    p = p * r2 - 1.0 / 6.0;
+    double s = r + r * r2 * p;
+
+    double half = 0.5 * k;
+    double parity = 2.0 * fabs(half - ((half + VM_ROUND_MAGIC) - VM_ROUND_MAGIC));
+    return (1.0 - 2.0 * parity) * s;
+}
+
+static inline double vm_cos_fast(double x)
+{
+    double k = (x * M_1_PI - 0.5 + VM_ROUND_MAGIC) - VM_ROUND_MAGIC;
+    double kh = k + 0.5;
+    double r = (x - kh * VM_PI_A) - kh * VM_PI_B;
+    double r2 = r * r;
+
+    double p = -1.0 / 1307674368000.0;
+    p = p * r2 + 1.0 / 6227020800.0;
+    p = p * r2 - 1.0 / 39916800.0;
+    p = p * r2 + 1.0 / 362880.0;
+    p = p * r2 - 1.0 / 5040.0;
+    p = p * r2 + 1.0 / 120.0;
+    p = p * r2 - 1.0 / 6.0;
+    double s = r + r * r2 * p;
+
+    double half = 0.5 * k;
+    double parity = 2.0 * fabs(half - ((half + VM_ROUND_MAGIC) - VM_ROUND_MAGIC));
+    return (2.0 * parity - 1.0) * s;
+}
+
+/**
+ * @brief Núcleo de vm_sin_accurate/vm_cos_accurate: reduz x = k pi/2 + (r_hi + r_lo), com
+ *        |r| <= pi/4 e o resto em precisão dupla-dupla, e devolve sin(r) e cos(r) com
+ *        erro bem abaixo de meio ulp antes do arredondamento final (esquema da fdlibm).
+ * @return O quadrante k mod 4 (0, 1, 2 ou 3), em double para não sair dos registradores vetoriais.
+ */
+static inline VM_ALWAYS_INLINE double vm_sincos_kernel(double x, double *sin_r, double *cos_r)
+{
+    double k = (x * M_2_PI + VM_ROUND_MAGIC) - VM_ROUND_MAGIC;
+
+    // (x - k pi_a) é exato; o termo em pi_b entra com TwoSum para guardar o erro em r_lo
+    double a = x - k * (0.5 * VM_PI_A);
+    double b = -k * (0.5 * VM_PI_B);
+    double r1 = a + b;
+    double bv = r1 - a;
+    double e1 = (a - (r1 - bv)) + (b - bv);
+    double tail = e1 - k * (0.5 * VM_PI_C);
+    double r = r1 + tail;
+    double r_lo = (r1 - r) + tail;
+    double r2 = r * r;
+
+    // sin(r) = r + r^3 P(r^2), até r^17 (o termo seguinte é < 1e-19 relativo)
+    double p = 1.0 / 355687428096000.0;
+    p = p * r2 - 1.0 / 1307674368000.0;
+    p = p * r2 + 1.0 / 6227020800.0;
+    p = p * r2 - 1.0 / 39916800.0;
+    p = p * r2 + 1.0 / 362880.0;
+    p = p * r2 - 1.0 / 5040.0;
+    p = p * r2 + 1.0 / 120.0;
+    p = p * r2 - 1.0 / 6.0;
+    *sin_r = r + (r * r2 * p + r_lo * (1.0 - 0.5 * r2));
+
+    // cos(r) = 1 - r^2/2 + r^4 Q(r^2), até r^18; 1 - r^2/2 é somado com a parte perdida
+    double q = 1.0 / 6402373705728000.0;
+    q = q * r2 - 1.0 / 20922789888000.0;
+    q = q * r2 + 1.0 / 87178291200.0;
+    q = q * r2 - 1.0 / 479001600.0;
+    q = q * r2 + 1.0 / 3628800.0;
+    q = q * r2 - 1.0 / 40320.0;
+    q = q * r2 + 1.0 / 720.0;
+    q = q * r2 - 1.0 / 24.0;
+    double hr = 0.5 * r2;
+    double w = 1.0 - hr;
+    *cos_r = w + (((1.0 - w) - hr) + (r2 * r2 * -q - r * r_lo));
+
+    // floor(k/4) sem floor(): as frações de k/4 - 3/8 nunca empatam no arredondamento
+    double k4 = (0.25 * k - 0.375 + VM_ROUND_MAGIC) - VM_ROUND_MAGIC;
+    return k - 4.0 * k4;
+}
+
+/**
+ * @brief Seno com erro de até 1 ulp (|x| < 1e5).
+ */
+static inline VM_ALWAYS_INLINE double vm_sin_accurate(double x)
+{
+    double s, c;
+    double m = vm_sincos_kernel(x, &s, &c);
+    double v = (m == 1.0 || m == 3.0) ? c : s;
+    return (m >= 2.0) ? -v : v;
+}
+
+/**
+ * @brief Cosseno com erro de até 1 ulp (|x| < 1e5).
+ */
+static inline VM_ALWAYS_INLINE double vm_cos_accurate(double x)
+{
+    double s, c;
+    double m = vm_sincos_kernel(x, &s, &c); // cos(x) = sin(x + pi/2): quadrante m + 1
+    double v = (m == 0.0 || m == 2.0) ? c : s;
+    return (m == 1.0 || m == 2.0) ? -v : v;
+}
+
+static inline double vm_sin_acc(vm_accuracy acc, double x)
+{
+    switch (acc)
+    {
+    case VM_ACC_1ULP:
+        return vm_sin_accurate(x);
+    case VM_ACC_4ULP:
+        return vm_sin(x);
+    case VM_ACC_FAST:
+        return vm_sin_fast(x);
+    default:
+        return sin(x);
+    }
+}
+
+static inline double vm_cos_acc(vm_accuracy acc, double x)
+{
+    switch (acc)
+    {
+    case VM_ACC_1ULP:
+        return vm_cos_accurate(x);
+    case VM_ACC_4ULP:
+        return vm_cos(x);
+    case VM_ACC_FAST:
+        return vm_cos_fast(x);
+    default:
+        return cos(x);
+    }
+}
+
+static inline const char *vm_accuracy_name(vm_accuracy acc)
+{
+    switch (acc)
+    {
+    case VM_ACC_LIBM:
+        return "libm";
+    case VM_ACC_1ULP:
+        return "1ulp";
+    case VM_ACC_4ULP:
+        return "4ulp";
+    case VM_ACC_FAST:
+        return "fast";
+    default:
+        return "unknown";
+    }
+}
+
+#endif